@@ -0,0 +1,215 @@
+#include "Benchmark.h"
+#include "threading/BackgroundJobRunner.h"
+#include <functional>
+
+namespace {
+using Clock = std::chrono::steady_clock;
+
+struct JobTimes
+{
+  Clock::time_point Enqueued, Started, Finished, Finalized;
+};
+
+/// Does no work, only records when each step of its life happened.
+class LatencyJob : public threading::BackgroundJob
+{
+  public:
+  explicit LatencyJob(JobTimes* times)
+      : m_times(times)
+  {
+  }
+
+  void Run() final
+  {
+    m_times->Started  = Clock::now();
+    m_times->Finished = Clock::now();
+  }
+
+  void FinalizeInMainThread() final
+  {
+    m_times->Finalized = Clock::now();
+  }
+
+  private:
+  JobTimes* m_times;
+};
+
+/// A few microseconds of arithmetic, about the cost of a small job.
+class SpinJob : public threading::BackgroundJob
+{
+  public:
+  explicit SpinJob(uint32_t* finalized = nullptr)
+      : m_finalized(finalized)
+  {
+  }
+
+  void Run() final
+  {
+    uint32_t value = 1;
+    for (uint32_t i = 0; i < 2000; i++)
+    {
+      value = value * 1664525u + 1013904223u;
+    }
+    bench::DoNotOptimize(value);
+  }
+
+  void FinalizeInMainThread() final
+  {
+    (*m_finalized)++;
+  }
+
+  private:
+  uint32_t* m_finalized;
+};
+
+/// Worker counts to measure: powers of two up to the hardware thread count, then that count.
+core::Vector<uint32_t> GetWorkerCounts()
+{
+  const uint32_t         hardwareThreads = std::max(1u, std::thread::hardware_concurrency());
+  core::Vector<uint32_t> counts;
+  for (uint32_t count = 1; count < hardwareThreads; count *= 2)
+  {
+    counts.push_back(count);
+  }
+  counts.push_back(hardwareThreads);
+  return counts;
+}
+
+void PrintLatency(const char* label, const core::Vector<double>& microseconds)
+{
+  double total = 0, worst = 0;
+  for (double us : microseconds)
+  {
+    total += us;
+    worst = std::max(worst, us);
+  }
+  std::printf("  %-48s %10.1f us mean %10.1f us max\n", label, total / microseconds.size(), worst);
+}
+} // namespace
+
+BENCHMARK(BackgroundJobRunnerLatency)
+{
+  static constexpr uint32_t JobCount = 200;
+
+  threading::JobScheduler        scheduler(4);
+  threading::BackgroundJobRunner runner(scheduler);
+  core::Vector<JobTimes>         times(JobCount);
+  core::Vector<double>           toStart, toFinalize;
+
+  // One job at a time, so every job finds the workers idle. The main thread polls Run() the way
+  // a frame loop would, without sleeping.
+  for (JobTimes& job : times)
+  {
+    job.Enqueued = Clock::now();
+    runner.EnqueueBackgroundJob(new LatencyJob(&job));
+    while (job.Finalized == Clock::time_point())
+    {
+      runner.Run();
+    }
+
+    toStart.push_back(std::chrono::duration<double, std::micro>(job.Started - job.Enqueued).count());
+    toFinalize.push_back(
+        std::chrono::duration<double, std::micro>(job.Finalized - job.Finished).count());
+  }
+
+  PrintLatency("enqueue to start", toStart);
+  PrintLatency("run to finalize", toFinalize);
+}
+
+BENCHMARK(BackgroundJobRunnerThroughput)
+{
+  static constexpr uint32_t JobCount = 20000;
+
+  // The main thread enqueues every job up front, then finalizes them as they come back.
+  for (uint32_t workerCount : GetWorkerCounts())
+  {
+    threading::JobScheduler        scheduler(workerCount);
+    threading::BackgroundJobRunner runner(scheduler);
+
+    const auto label = core::string::CFormat("%u workers, enqueue and finalize", workerCount);
+    bench::Measure(label.c_str(), JobCount, [&]() {
+      uint32_t finalized = 0;
+      for (uint32_t i = 0; i < JobCount; i++)
+      {
+        runner.EnqueueBackgroundJob(new SpinJob(&finalized));
+      }
+      while (finalized < JobCount)
+      {
+        runner.Run();
+      }
+    });
+  }
+}
+
+BENCHMARK(JobSchedulerFanOutThroughput)
+{
+  static constexpr uint32_t Depth = 15;
+
+  // Tasks spawn their children from worker threads, which go to the lock-free worker deques.
+  for (uint32_t workerCount : GetWorkerCounts())
+  {
+    threading::JobScheduler scheduler(workerCount);
+    std::atomic<uint32_t>   leaves{ 0 };
+
+    std::function<void(uint32_t)> spawn = [&](uint32_t depth) {
+      SpinJob().Run();
+      if (depth == Depth)
+      {
+        leaves++;
+        return;
+      }
+      scheduler.SubmitFunction([&spawn, depth]() { spawn(depth + 1); });
+      scheduler.SubmitFunction([&spawn, depth]() { spawn(depth + 1); });
+    };
+
+    const auto label = core::string::CFormat("%u workers, fan-out tasks", workerCount);
+    bench::Measure(label.c_str(), (2u << Depth) - 1, [&]() {
+      leaves = 0;
+      scheduler.SubmitFunction([&spawn]() { spawn(0); });
+      while (leaves < (1u << Depth))
+      {
+        std::this_thread::yield();
+      }
+    });
+  }
+}
+
+BENCHMARK(BackgroundJobRunnerFinalization)
+{
+  static constexpr uint32_t JobCount = 2000;
+
+  // A zero time budget finalizes one job per call, like a runner that finalizes one job per
+  // frame. Frames counts the Run calls it takes to finalize every job.
+  for (const auto budgetTime : { std::chrono::microseconds(0), std::chrono::microseconds(2000) })
+  {
+    threading::JobScheduler        scheduler(2);
+    threading::BackgroundJobRunner runner(scheduler);
+    uint32_t                       finalized = 0;
+    for (uint32_t i = 0; i < JobCount; i++)
+    {
+      runner.EnqueueBackgroundJob(new SpinJob(&finalized));
+    }
+
+    threading::FinalizationBudget budget;
+    budget.Time = budgetTime;
+
+    uint32_t frames = 0, jobsInFrame = 0;
+    double   totalMicroseconds = 0, worstMicroseconds = 0;
+    while (finalized < JobCount)
+    {
+      const auto stats = runner.Run(budget);
+      if (stats.JobsFinalized == 0)
+      {
+        continue;
+      }
+      frames++;
+      jobsInFrame = std::max(jobsInFrame, stats.JobsFinalized);
+      totalMicroseconds += stats.TimeSpent.count();
+      worstMicroseconds = std::max(worstMicroseconds, double(stats.TimeSpent.count()));
+    }
+
+    std::printf("  %-48s %10u frames %6u jobs/frame max %8.1f us/frame mean %8.1f us max\n",
+                core::string::CFormat("%lld us budget", (long long)budgetTime.count()).c_str(),
+                frames, jobsInFrame, totalMicroseconds / frames, worstMicroseconds);
+  }
+}
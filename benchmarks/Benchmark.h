@@ -0,0 +1,66 @@
+#ifndef THEPROJECT2_BENCHMARKS_BENCHMARK_H
+#define THEPROJECT2_BENCHMARKS_BENCHMARK_H
+
+#include <chrono>
+#include <cstdio>
+#include <algorithm>
+#include <limits>
+
+namespace bench {
+using BenchmarkFunction = void (*)();
+
+struct BenchmarkEntry
+{
+  const char*       Name;
+  BenchmarkFunction Function;
+};
+
+inline core::Vector<BenchmarkEntry>& GetRegisteredBenchmarks()
+{
+  static core::Vector<BenchmarkEntry> benchmarks;
+  return benchmarks;
+}
+
+struct BenchmarkRegistrar
+{
+  BenchmarkRegistrar(const char* name, BenchmarkFunction function)
+  {
+    GetRegisteredBenchmarks().push_back({ name, function });
+  }
+};
+
+/// Keeps the optimizer from discarding values computed inside a measured loop.
+template <class T> inline void DoNotOptimize(const T& value)
+{
+  asm volatile("" : : "r,m"(value) : "memory");
+}
+
+/// Runs func `repetitions` times and prints the best time per item. `items` is the number of
+/// operations one call of func performs.
+template <class TFunc>
+double Measure(const char* label, uint64_t items, TFunc&& func, uint32_t repetitions = 5)
+{
+  double bestSeconds = std::numeric_limits<double>::max();
+
+  for (uint32_t i = 0; i < repetitions; i++)
+  {
+    auto start = std::chrono::steady_clock::now();
+    func();
+    auto end = std::chrono::steady_clock::now();
+
+    bestSeconds = std::min(bestSeconds, std::chrono::duration<double>(end - start).count());
+  }
+
+  const double nsPerItem = bestSeconds * 1e9 / items;
+  std::printf("  %-48s %10.3f ns/item %12.2f Mitems/s\n", label, nsPerItem,
+              items / bestSeconds / 1e6);
+  return nsPerItem;
+}
+} // namespace bench
+
+#define BENCHMARK(Name)                                                                            \
+  static void                    Name();                                                           \
+  static bench::BenchmarkRegistrar Name##Registrar(#Name, &Name);                                  \
+  static void                    Name()
+
+#endif // THEPROJECT2_BENCHMARKS_BENCHMARK_H
@@ -0,0 +1,171 @@
+#include "Benchmark.h"
+#include "voxel/ChunkMesher.h"
+#include "voxel/Morton.h"
+#include "voxel/VoxelMesh.h"
+#include "voxel/VoxelUtils.h"
+
+namespace {
+/// Chunk of rolling terrain in two materials, stored as runs of keys like WorldGenerator does.
+core::Vector<vox::VoxNode> MakeTerrainChunk()
+{
+  core::Vector<vox::VoxNode> nodes;
+  for (uint32_t key = 0; key < vox::VOXELS_IN_CHUNK; key++)
+  {
+    uint32_t x, y, z;
+    vox::decodeMK(key, x, y, z);
+    if (y > 12 + (x * 7 + z * 3) % 9)
+      continue;
+
+    const uint8_t texture = y < 10 ? 1 : 2;
+    if (!nodes.empty() && nodes.back().start + nodes.back().size == key &&
+        nodes.back().r == texture)
+      nodes.back().size++;
+    else
+      nodes.emplace_back(key, 1, texture, texture, texture);
+  }
+  return nodes;
+}
+
+/// Every other voxel solid, the worst case for face merging.
+core::Vector<vox::VoxNode> MakeCheckerChunk()
+{
+  core::Vector<vox::VoxNode> nodes;
+  for (uint32_t key = 0; key < vox::VOXELS_IN_CHUNK; key++)
+  {
+    uint32_t x, y, z;
+    vox::decodeMK(key, x, y, z);
+    if ((x + y + z) % 2 == 0)
+      nodes.emplace_back(key, 1, 1, 1, 1);
+  }
+  return nodes;
+}
+
+void MeasureMesher(const char* label, vox::ChunkMesher::EMode mode,
+                   core::Vector<vox::VoxNode>& nodes, uint32_t chunks)
+{
+  auto         mesher    = core::MakeUnique<vox::ChunkMesher>(mode);
+  const double nsPerItem = bench::Measure(label, chunks, [&]() {
+    for (uint32_t i = 0; i < chunks; i++)
+    {
+      vox::VoxelMesh mesh(nullptr);
+      mesher->BuildChunk(nodes.begin(), nodes.end(), &mesh);
+      bench::DoNotOptimize(mesh.Vertices.size());
+    }
+  });
+  std::printf("  %-48s %10.0f chunks/s\n", "", 1e9 / nsPerItem);
+}
+} // namespace
+
+BENCHMARK(ChunkMesherModes)
+{
+  using EMode  = vox::ChunkMesher::EMode;
+  auto terrain = MakeTerrainChunk();
+  auto checker = MakeCheckerChunk();
+
+  MeasureMesher("terrain chunk, Greedy", EMode::Greedy, terrain, 50);
+  MeasureMesher("terrain chunk, BinaryGreedy", EMode::BinaryGreedy, terrain, 50);
+  MeasureMesher("checkerboard chunk, Greedy", EMode::Greedy, checker, 2);
+  MeasureMesher("checkerboard chunk, BinaryGreedy", EMode::BinaryGreedy, checker, 2);
+}
+
+BENCHMARK(ChunkMesherVertexFormats)
+{
+  using EFormat = vox::VoxelMesh::EVertexFormat;
+  auto terrain  = MakeTerrainChunk();
+  auto mesher   = core::MakeUnique<vox::ChunkMesher>();
+
+  for (EFormat format : { EFormat::Float, EFormat::Packed })
+  {
+    const bool     packed = format == EFormat::Packed;
+    vox::VoxelMesh mesh(nullptr, format);
+    bench::Measure(packed ? "terrain chunk, packed vertices" : "terrain chunk, float vertices", 1,
+                   [&]() {
+                     mesh.Clear();
+                     mesher->BuildChunk(terrain.begin(), terrain.end(), &mesh);
+                   });
+
+    const size_t vertexBytes = mesh.PackedVertices.size() * sizeof(vox::PackedVoxelVertex) +
+                               mesh.Vertices.size() * sizeof(glm::vec3) * 3;
+    // Packed meshes keep no indices on the CPU, but each VAO still gets its own index buffer.
+    const size_t gpuIndexBytes =
+        packed ? vox::VoxelMesh::GetQuadIndexCapacity(mesh.GetQuadCount()) * 6 * sizeof(uint32_t)
+               : mesh.Indices.size() * sizeof(uint32_t);
+    std::printf("  %-48s %10zu vertex bytes %8zu index bytes %8zu GPU index bytes\n", "",
+                vertexBytes, mesh.Indices.size() * sizeof(uint32_t), gpuIndexBytes);
+  }
+}
+
+BENCHMARK(ChunkMesherOutputBuffers)
+{
+  using EFormat = vox::VoxelMesh::EVertexFormat;
+  auto           terrain = MakeTerrainChunk();
+  auto           mesher  = core::MakeUnique<vox::ChunkMesher>();
+  const uint32_t chunks  = 50;
+
+  bench::Measure("terrain chunk, fresh mesh per chunk", chunks, [&]() {
+    for (uint32_t i = 0; i < chunks; i++)
+    {
+      vox::VoxelMesh mesh(nullptr, EFormat::Packed);
+      mesher->BuildChunk(terrain.begin(), terrain.end(), &mesh);
+      bench::DoNotOptimize(mesh.PackedVertices.size());
+    }
+  });
+
+  vox::VoxelMesh scratch(nullptr, EFormat::Packed);
+  bench::Measure("terrain chunk, reused scratch + exact copy", chunks, [&]() {
+    for (uint32_t i = 0; i < chunks; i++)
+    {
+      vox::VoxelMesh mesh(nullptr, EFormat::Packed);
+      scratch.Clear();
+      mesher->BuildChunk(terrain.begin(), terrain.end(), &scratch);
+      mesh.AssignGeometry(scratch);
+      bench::DoNotOptimize(mesh.PackedVertices.size());
+    }
+  });
+}
+
+BENCHMARK(ChunkMesherSingleVoxelEdit)
+{
+  using EFormat = vox::VoxelMesh::EVertexFormat;
+  auto           terrain = MakeTerrainChunk();
+  auto           mesher  = core::MakeUnique<vox::ChunkMesher>();
+  const uint32_t edits   = 200;
+
+  vox::VoxelMesh mesh(nullptr, EFormat::Packed);
+  bench::Measure("terrain chunk, full remesh per edit", edits / 10, [&]() {
+    for (uint32_t i = 0; i < edits / 10; i++)
+    {
+      mesh.Clear();
+      mesher->BuildChunk(terrain.begin(), terrain.end(), &mesh);
+    }
+  });
+
+  // Digs and refills a voxel on the surface, each call patches the slices around it.
+  const vox::VoxNode node(0, 1, 2, 2, 2);
+  bench::Measure("terrain chunk, UpdateVoxel", edits, [&]() {
+    for (uint32_t i = 0; i < edits; i++)
+    {
+      const glm::ivec3 cell(i % 32, 12, (i * 7) % 32);
+      mesher->UpdateVoxel(&mesh, cell, i % 2 ? &node : nullptr);
+    }
+  });
+  bench::DoNotOptimize(mesh.PackedVertices.size());
+}
+
+BENCHMARK(ChunkMesherAmbientOcclusion)
+{
+  using EFormat = vox::VoxelMesh::EVertexFormat;
+  auto terrain  = MakeTerrainChunk();
+  auto mesher   = core::MakeUnique<vox::ChunkMesher>();
+
+  for (bool ambientOcclusion : { false, true })
+  {
+    vox::VoxelMesh mesh(nullptr, EFormat::Packed);
+    mesher->SetAmbientOcclusion(ambientOcclusion);
+    bench::Measure(ambientOcclusion ? "terrain chunk, AO" : "terrain chunk, no AO", 1, [&]() {
+      mesh.Clear();
+      mesher->BuildChunk(terrain.begin(), terrain.end(), &mesh);
+    });
+    std::printf("  %-48s %10u quads\n", "", mesh.GetQuadCount());
+  }
+}
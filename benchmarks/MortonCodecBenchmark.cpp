@@ -0,0 +1,124 @@
+#include "Benchmark.h"
+#include "voxel/Morton.h"
+#include "voxel/MortonBatch.h"
+#include <random>
+
+namespace {
+constexpr uint32_t KeyCount = 1u << 21u;
+
+struct CodecInput
+{
+  core::Vector<uint32_t> X, Y, Z, Keys;
+};
+
+CodecInput MakeSequentialInput()
+{
+  CodecInput input;
+  for (uint32_t i = 0; i < KeyCount; i++)
+  {
+    uint32_t x, y, z;
+    vox::morton::DecodeMagicBits(i, x, y, z);
+    input.X.push_back(x);
+    input.Y.push_back(y);
+    input.Z.push_back(z);
+    input.Keys.push_back(i);
+  }
+  return input;
+}
+
+CodecInput MakeRandomInput()
+{
+  CodecInput                              input;
+  std::mt19937                            rng(1234);
+  std::uniform_int_distribution<uint32_t> coord(0, 1023);
+
+  for (uint32_t i = 0; i < KeyCount; i++)
+  {
+    input.X.push_back(coord(rng));
+    input.Y.push_back(coord(rng));
+    input.Z.push_back(coord(rng));
+    input.Keys.push_back(vox::morton::EncodeMagicBits(input.X[i], input.Y[i], input.Z[i]));
+  }
+  return input;
+}
+
+template <class TEncode> void BenchmarkEncode(const char* label, const CodecInput& in, TEncode f)
+{
+  bench::Measure(label, KeyCount, [&]() {
+    uint32_t acc = 0;
+    for (uint32_t i = 0; i < KeyCount; i++)
+    {
+      acc ^= f(in.X[i], in.Y[i], in.Z[i]);
+    }
+    bench::DoNotOptimize(acc);
+  });
+}
+
+template <class TDecode> void BenchmarkDecode(const char* label, const CodecInput& in, TDecode f)
+{
+  bench::Measure(label, KeyCount, [&]() {
+    uint32_t acc = 0, x, y, z;
+    for (uint32_t i = 0; i < KeyCount; i++)
+    {
+      f(in.Keys[i], x, y, z);
+      acc ^= x + y + z;
+    }
+    bench::DoNotOptimize(acc);
+  });
+}
+
+void BenchmarkAllCodecs(const CodecInput& input)
+{
+  BenchmarkEncode("encode LookupTable", input, vox::morton::EncodeLUT);
+  BenchmarkEncode("encode MagicBits", input, vox::morton::EncodeMagicBits);
+#if VOX_MORTON_HAS_BMI2
+  if (vox::morton::IsCodecSupported(vox::morton::ECodec::BMI2))
+  {
+    BenchmarkEncode("encode BMI2", input, vox::morton::EncodeBMI2);
+  }
+#endif
+  BenchmarkEncode("encode encodeMK (dispatched)", input, vox::encodeMK);
+
+  BenchmarkDecode("decode MagicBits", input, vox::morton::DecodeMagicBits);
+#if VOX_MORTON_HAS_BMI2
+  if (vox::morton::IsCodecSupported(vox::morton::ECodec::BMI2))
+  {
+    BenchmarkDecode("decode BMI2", input, vox::morton::DecodeBMI2);
+  }
+#endif
+  BenchmarkDecode("decode decodeMK (dispatched)", input, vox::decodeMK);
+}
+} // namespace
+
+BENCHMARK(MortonCodecSequential)
+{
+  std::printf("  active codec: %s\n", vox::morton::GetCodecName(vox::morton::GetCodec()));
+  BenchmarkAllCodecs(MakeSequentialInput());
+}
+
+BENCHMARK(MortonCodecRandom)
+{
+  BenchmarkAllCodecs(MakeRandomInput());
+}
+
+BENCHMARK(MortonCodecBatched)
+{
+  std::printf("  AVX2 kernels: %s\n", vox::morton::IsAVX2Enabled() ? "yes" : "no");
+  auto                   input = MakeRandomInput();
+  core::Vector<uint32_t> keys(KeyCount), x(KeyCount), y(KeyCount), z(KeyCount);
+
+  bench::Measure("EncodeMany", KeyCount, [&]() {
+    vox::morton::EncodeMany(input.X.data(), input.Y.data(), input.Z.data(), keys.data(), KeyCount);
+    bench::DoNotOptimize(keys.data());
+  });
+
+  bench::Measure("DecodeMany", KeyCount, [&]() {
+    vox::morton::DecodeMany(input.Keys.data(), x.data(), y.data(), z.data(), KeyCount);
+    bench::DoNotOptimize(x.data());
+  });
+
+  bench::Measure("DecodeRange", KeyCount, [&]() {
+    vox::morton::DecodeRange(0, x.data(), y.data(), z.data(), KeyCount);
+    bench::DoNotOptimize(x.data());
+  });
+}
@@ -0,0 +1,135 @@
+#include "Benchmark.h"
+#include "voxel/MortonOctree.h"
+#include "voxel/VoxelUtils.h"
+
+namespace {
+/// Roughly one superchunk layer worth of solid ground, about 1M nodes.
+vox::MortonOctree MakeGroundOctree()
+{
+  vox::MortonOctree octree;
+  for (uint32_t z = 0; z < 256; z++)
+    for (uint32_t y = 0; y < 16; y++)
+      for (uint32_t x = 0; x < 256; x++)
+        octree.AddOrphanNode(vox::VoxNode(x, y, z));
+  octree.SortLeafNodes();
+  return octree;
+}
+
+/// A pasted structure: a 16x8x16 block above the ground.
+core::Vector<vox::VoxNode> MakeStructure()
+{
+  core::Vector<vox::VoxNode> nodes;
+  for (uint32_t z = 100; z < 116; z++)
+    for (uint32_t y = 16; y < 24; y++)
+      for (uint32_t x = 100; x < 116; x++)
+        nodes.emplace_back(x, y, z);
+  return nodes;
+}
+} // namespace
+
+BENCHMARK(MortonOctreeBulkEdits)
+{
+  const auto ground    = MakeGroundOctree();
+  const auto structure = MakeStructure();
+
+  bench::Measure("paste 2048 nodes, AddNode", structure.size(), [&]() {
+    auto octree = ground;
+    for (auto& node : structure)
+      octree.AddNode(node);
+    bench::DoNotOptimize(octree.GetNodes().size());
+  }, 3);
+
+  bench::Measure("paste 2048 nodes, AddNodes", structure.size(), [&]() {
+    auto octree = ground;
+    octree.AddNodes(structure);
+    bench::DoNotOptimize(octree.GetNodes().size());
+  }, 3);
+
+  bench::Measure("remove 16^3 crater, ApplyEdits", 16 * 16 * 16, [&]() {
+    auto                         octree = ground;
+    vox::MortonOctree::EditBatch batch;
+    for (uint32_t z = 50; z < 66; z++)
+      for (uint32_t y = 0; y < 16; y++)
+        for (uint32_t x = 50; x < 66; x++)
+          batch.Remove(x, y, z);
+    octree.ApplyEdits(core::Move(batch));
+    bench::DoNotOptimize(octree.GetNodes().size());
+  }, 3);
+}
+
+namespace {
+template <class TOctree> void BenchmarkLookups(const char* label, TOctree& octree)
+{
+  constexpr uint32_t LookupCount = 1u << 20;
+
+  bench::Measure(label, LookupCount, [&]() {
+    uint32_t hits = 0, key = 12345;
+    for (uint32_t i = 0; i < LookupCount; i++)
+    {
+      key = key * 1664525u + 1013904223u;
+      hits += octree.CheckNode(vox::encodeMK(key & 255, (key >> 8) & 31, (key >> 16) & 255));
+    }
+    bench::DoNotOptimize(hits);
+  });
+}
+} // namespace
+
+BENCHMARK(MortonOctreeStorageLookups)
+{
+  vox::MortonOctree    aos, indexed;
+  vox::MortonOctreeSoa soa;
+  for (uint32_t z = 0; z < 256; z++)
+    for (uint32_t y = 0; y < 16; y++)
+      for (uint32_t x = 0; x < 256; x++)
+      {
+        aos.AddOrphanNode(vox::VoxNode(x, y, z));
+        soa.AddOrphanNode(vox::VoxNode(x, y, z));
+        indexed.AddOrphanNode(vox::VoxNode(x, y, z));
+      }
+  aos.SortLeafNodes();
+  soa.SortLeafNodes();
+  indexed.SortLeafNodes();
+  indexed.EnableSearchIndex(true);
+
+  BenchmarkLookups("CheckNode, AoS nodes", aos);
+  BenchmarkLookups("CheckNode, SoA keys", soa);
+  BenchmarkLookups("CheckNode, B-tree search index", indexed);
+}
+
+BENCHMARK(MortonOctreeChunkRanges)
+{
+  // A 128^3 superchunk with ground up to y = 48, the layout WorldRenderer::BuildChunkV2 walks.
+  vox::MortonOctree octree;
+  for (uint32_t z = 0; z < 128; z++)
+    for (uint32_t y = 0; y < 48; y++)
+      for (uint32_t x = 0; x < 128; x++)
+        octree.AddOrphanNode(vox::VoxNode(x, y, z));
+  octree.SortLeafNodes();
+
+  auto& nodes = octree.GetNodes();
+
+  bench::Measure("walk 64 chunks, upper_bound", 64, [&]() {
+    size_t total = 0;
+    for (auto it = nodes.begin(); it != nodes.end();)
+    {
+      const auto next = vox::utils::NextChunk(it->start);
+      auto       end  = std::upper_bound(it, nodes.end(), next, [](uint32_t key, const vox::VoxNode& n) {
+        return key <= n.start;
+      });
+      total += end - it;
+      it = end;
+    }
+    bench::DoNotOptimize(total);
+  });
+
+  bench::Measure("walk 64 chunks, chunk directory", 64, [&]() {
+    size_t total = 0;
+    for (size_t chunk = 0; chunk < octree.GetChunkCount(); chunk++)
+    {
+      const auto range = octree.GetChunkRange(chunk);
+      if (range.liveCount != 0)
+        total += range.end - range.begin;
+    }
+    bench::DoNotOptimize(total);
+  });
+}
@@ -0,0 +1,91 @@
+#include "Benchmark.h"
+#include "voxel/MortonOctree.h"
+#include "voxel/MortonRange.h"
+#include <random>
+
+namespace {
+constexpr uint32_t WorldSize = 256;
+
+/// Half filled terrain-like octree: everything below a height field is solid.
+vox::MortonOctree MakeTerrainOctree()
+{
+  vox::MortonOctree octree;
+  for (uint32_t z = 0; z < WorldSize; z++)
+    for (uint32_t x = 0; x < WorldSize; x++)
+    {
+      const uint32_t height = WorldSize / 2 + (x * 7 + z * 3) % 16;
+      for (uint32_t y = 0; y < height; y++)
+        octree.AddOrphanNode(vox::VoxNode(x, y, z));
+    }
+  octree.SortLeafNodes();
+  return octree;
+}
+
+/// The scan CollisionManager::CheckCollision used: every node between the min and max key.
+uint32_t LinearScanCount(const vox::MortonOctree::Storage& nodes, uint32_t minKey, uint32_t maxKey)
+{
+  auto low = std::lower_bound(nodes.begin(), nodes.end(), vox::VoxNode(minKey));
+  auto hi  = std::upper_bound(nodes.begin(), nodes.end(), vox::VoxNode(maxKey));
+  return uint32_t(hi - low);
+}
+} // namespace
+
+BENCHMARK(MortonBoxQuery)
+{
+  auto  octree = MakeTerrainOctree();
+  auto& nodes  = octree.GetNodes();
+
+  std::printf("  %-8s %14s %14s %10s %10s\n", "box", "linear scan", "bigmin", "in box",
+              "intervals");
+  for (uint32_t size = 2; size <= 64; size *= 2)
+  {
+    const glm::uvec3 min(37, WorldSize / 2 - size / 2, 91);
+    const glm::uvec3 max = min + glm::uvec3(size - 1);
+    const uint32_t   minKey = vox::encodeMK(min.x, min.y, min.z);
+    const uint32_t   maxKey = vox::encodeMK(max.x, max.y, max.z);
+
+    uint32_t inBox    = 0;
+    uint32_t examined = octree.ForEachNodeInBox(min, max, [&](const vox::VoxNode&) {
+      inBox++;
+      return true;
+    });
+
+    const uint32_t boxMin[3] = { min.x, min.y, min.z }, boxMax[3] = { max.x, max.y, max.z };
+    core::Vector<vox::MortonInterval<uint32_t>> intervals;
+    vox::MortonBoxIntervals(boxMin, boxMax, intervals);
+
+    char label[16];
+    std::snprintf(label, sizeof(label), "%u^3", size);
+    std::printf("  %-8s %14u %14u %10u %10zu\n", label, LinearScanCount(nodes, minKey, maxKey),
+                examined, inBox, intervals.size());
+  }
+
+  std::mt19937                            rng(99);
+  std::uniform_int_distribution<uint32_t> coord(0, WorldSize - 17);
+  core::Vector<glm::uvec3>                boxes;
+  for (uint32_t i = 0; i < 4096; i++)
+    boxes.emplace_back(coord(rng), coord(rng), coord(rng));
+
+  bench::Measure("16^3 box, linear scan", boxes.size(), [&]() {
+    uint32_t acc = 0;
+    for (auto& b : boxes)
+    {
+      const uint32_t minKey = vox::encodeMK(b.x, b.y, b.z);
+      const uint32_t maxKey = vox::encodeMK(b.x + 15, b.y + 15, b.z + 15);
+      auto low = std::lower_bound(nodes.begin(), nodes.end(), vox::VoxNode(minKey));
+      for (; low != nodes.end() && low->start <= maxKey; ++low)
+        acc += vox::MortonInBox(low->start, minKey, maxKey);
+    }
+    bench::DoNotOptimize(acc);
+  });
+
+  bench::Measure("16^3 box, bigmin", boxes.size(), [&]() {
+    uint32_t acc = 0;
+    for (auto& b : boxes)
+      octree.ForEachNodeInBox(b, b + glm::uvec3(15), [&](const vox::VoxNode&) {
+        acc++;
+        return true;
+      });
+    bench::DoNotOptimize(acc);
+  });
+}
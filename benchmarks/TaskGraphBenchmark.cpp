@@ -0,0 +1,48 @@
+#include "Benchmark.h"
+#include "threading/TaskGraph.h"
+
+namespace {
+/// A few microseconds of arithmetic, standing in for one pipeline stage of one chunk.
+void Spin(uint32_t iterations)
+{
+  uint32_t value = 1;
+  for (uint32_t i = 0; i < iterations; i++)
+  {
+    value = value * 1664525u + 1013904223u;
+  }
+  bench::DoNotOptimize(value);
+}
+} // namespace
+
+BENCHMARK(TaskGraphPipeline)
+{
+  static constexpr uint32_t ChunkCount = 512;
+
+  threading::JobScheduler scheduler;
+  threading::TaskGraph    graph(scheduler);
+
+  // Generation, lighting and meshing of every chunk. The main thread either waits for each
+  // stage of all chunks before starting the next one, or builds the whole graph up front.
+  bench::Measure("stage by stage from the main thread", ChunkCount, [&]() {
+    for (uint32_t stage = 0; stage < 3; stage++)
+    {
+      core::Vector<threading::TaskHandle> tasks;
+      for (uint32_t chunk = 0; chunk < ChunkCount; chunk++)
+      {
+        tasks.push_back(graph.Run([]() { Spin(2000); }));
+      }
+      graph.WhenAll(tasks)->Wait();
+    }
+  });
+
+  bench::Measure("task graph", ChunkCount, [&]() {
+    core::Vector<threading::TaskHandle> meshed;
+    for (uint32_t chunk = 0; chunk < ChunkCount; chunk++)
+    {
+      auto generated = graph.Run([]() { Spin(2000); });
+      auto lit       = graph.Then(generated, []() { Spin(2000); });
+      meshed.push_back(graph.Then(lit, []() { Spin(2000); }));
+    }
+    graph.WhenAll(meshed)->Wait();
+  });
+}
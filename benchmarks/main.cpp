@@ -0,0 +1,21 @@
+#include "Benchmark.h"
+#include <cstring>
+
+/// Usage: TheProjectMain_bench [name filter]
+int main(int argc, char** argv)
+{
+  const char* filter = argc > 1 ? argv[1] : nullptr;
+
+  for (auto& benchmark : bench::GetRegisteredBenchmarks())
+  {
+    if (filter && std::strstr(benchmark.Name, filter) == nullptr)
+    {
+      continue;
+    }
+
+    std::printf("%s\n", benchmark.Name);
+    benchmark.Function();
+  }
+
+  return 0;
+}
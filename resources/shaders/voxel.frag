@@ -3,58 +3,13 @@
 #extension GL_ARB_explicit_uniform_location : enable
 
 in vec3 UV;
-
-in vec3 Position_worldspace;
-in vec3 Normal_cameraspace;
-in vec3 EyeDirection_cameraspace;
-in vec3 LightDirection_cameraspace;
+in vec3 Light;
 
 out vec3 color;
 
 layout(binding=0) uniform sampler2DArray textureSampler0;
 
-//uniform mat4 MV;
-uniform vec3 LightPosition_worldspace;
-uniform float LightPower = 50.0f;
-
 void main(){
-    vec3 LightColor = vec3(1,1,1);
-
-    vec3 texColor = texture( textureSampler0, UV ).rgb;
-
-    vec3 MaterialDiffuseColor = texColor;
-    vec3 MaterialAmbientColor = vec3(0.1,0.1,0.1) * MaterialDiffuseColor;
-    vec3 MaterialSpecularColor = vec3(0.05,0.05,0.05);
-
-    float distance = length( LightPosition_worldspace - Position_worldspace );
-
-    vec3 n = normalize( Normal_cameraspace );
-    // Direction of the light (from the fragment to the light)
-    vec3 l = normalize( LightDirection_cameraspace );
-    // Cosine of the angle between the normal and the light direction,
-    // clamped above 0
-    //  - light is at the vertical of the triangle -> 1
-    //  - light is perpendicular to the triangle -> 0
-    //  - light is behind the triangle -> 0
-    float cosTheta = clamp( dot( n,l ), 0,1 );
-
-    // Eye vector (towards the camera)
-    vec3 E = normalize(EyeDirection_cameraspace);
-    // Direction in which the triangle reflects the light
-    vec3 R = reflect(-l,n);
-    // Cosine of the angle between the Eye vector and the Reflect vector,
-    // clamped to 0
-    //  - Looking into the reflection -> 1
-    //  - Looking elsewhere -> < 1
-    float cosAlpha = clamp( dot( E,R ), 0,1 );
-
-
-    color =
-    // Ambient : simulates indirect lighting
-    MaterialAmbientColor +
-    // Diffuse : "color" of the object
-    MaterialDiffuseColor * LightColor * LightPower * cosTheta / (distance*distance) +
-    // Specular : reflective highlight, like a mirror
-    MaterialSpecularColor * LightColor * LightPower * pow(cosAlpha,5) / (distance*distance);
-
-}
\ No newline at end of file
+    // Light and ambient occlusion come interpolated from voxel.vert.
+    color = texture( textureSampler0, UV ).rgb * Light;
+}
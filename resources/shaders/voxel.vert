@@ -2,41 +2,48 @@
 #extension GL_ARB_shading_language_420pack : enable
 #extension GL_ARB_explicit_uniform_location : enable
 
-layout(location = 0) in vec3 uv_in;
-layout(location = 1) in vec3 pos_in;
-layout(location = 2) in vec3 normal_in;
+// PackedVoxelVertex: x, y, z (6 bits each), the normal index (3 bits) and the ambient occlusion
+// level (2 bits, 3 is unoccluded) in the first word, u, v (6 bits each) and the texture layer
+// (8 bits, from bit 16) in the second. Both words arrive as floats, they are below 2^24 and
+// convert back to integers exactly.
+layout(location = 0) in vec2 packed_words;
+
+const vec3 normals[6] = vec3[6](vec3(1, 0, 0), vec3(-1, 0, 0), vec3(0, 1, 0),
+                                vec3(0, -1, 0), vec3(0, 0, 1), vec3(0, 0, -1));
 
 out vec3 UV;
-out vec3 Position_worldspace;
-out vec3 Normal_cameraspace;
-out vec3 EyeDirection_cameraspace;
-out vec3 LightDirection_cameraspace;
+out vec3 Light;
 
 uniform mat4 MVP;
 uniform mat4 V;
 uniform mat4 M;
 uniform vec3 LightPosition_worldspace;
+uniform float LightPower = 50.0f;
 
 void main(){
-    vec4 mpos = vec4(pos_in,1);
-
-    gl_Position = MVP * mpos;
-
-    Position_worldspace = (M * vec4(pos_in,1)).xyz;
-
-    // Vector that goes from the vertex to the camera, in camera space.
-    // In camera space, the camera is at the origin (0,0,0).
-    vec3 vertexPosition_cameraspace = ( V * M * vec4(pos_in,1)).xyz;
-    EyeDirection_cameraspace = vec3(0,0,0) - vertexPosition_cameraspace;
-
-    // Vector that goes from the vertex to the light, in camera space. M is ommited because it's identity.
-    vec3 LightPosition_cameraspace = ( V * vec4(LightPosition_worldspace,1)).xyz;
-    LightDirection_cameraspace = LightPosition_cameraspace + EyeDirection_cameraspace;
-
-    // Normal of the the vertex, in camera space
-    Normal_cameraspace = ( V * M * vec4(normal_in,0)).xyz; // Only correct if ModelMatrix does not scale the model ! Use its inverse transpose if not.
-
-
+    uvec2 packed_in = uvec2(packed_words);
+    vec3 pos_in = vec3(packed_in.x & 63u, (packed_in.x >> 6) & 63u, (packed_in.x >> 12) & 63u);
+    vec3 normal_in = normals[(packed_in.x >> 18) & 7u];
+    float ao_in = float((packed_in.x >> 21) & 3u) / 3.0;
+    vec3 uv_in = vec3(packed_in.y & 63u, (packed_in.y >> 6) & 63u, (packed_in.y >> 16) & 255u);
+
+    gl_Position = MVP * vec4(pos_in,1);
+
+    // Lighting is evaluated per vertex: chunk quads are small next to the distance to the light,
+    // and the baked occlusion is interpolated across the quad anyway. M only translates, so the
+    // normal is the same in world space.
+    vec3 Position_worldspace = (M * vec4(pos_in,1)).xyz;
+    vec3 toLight = LightPosition_worldspace - Position_worldspace;
+    float distance = length(toLight);
+    float cosTheta = clamp(dot(normal_in, toLight / distance), 0, 1);
+
+    vec3 LightColor = vec3(1,1,1);
+    vec3 ambient = vec3(0.1,0.1,0.1);
+    vec3 diffuse = LightColor * LightPower * cosTheta / (distance*distance);
+
+    // Fully enclosed corners keep some light so creases do not turn black.
+    float occlusion = mix(0.35, 1.0, ao_in);
+    Light = (ambient + diffuse) * occlusion;
 
     UV = uv_in;
-}
\ No newline at end of file
+}
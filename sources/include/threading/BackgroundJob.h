@@ -1,5 +1,7 @@
 #ifndef THEPROJECTMAIN_BACKGROUNDJOB_H
 #define THEPROJECTMAIN_BACKGROUNDJOB_H
+#include <cstddef>
+
 namespace threading {
 class BackgroundJob
 {
@@ -7,6 +9,17 @@ class BackgroundJob
   virtual void Run() = 0;
   /// Override this to execute last steps in the main thread.
   virtual void FinalizeInMainThread() = 0;
+  /// Bytes FinalizeInMainThread uploads to the GPU, counted against FinalizationBudget::Bytes.
+  virtual size_t GetFinalizationBytes() const
+  {
+    return 0;
+  }
+  /// Checked on the worker right before Run. A cancelled job does not run, but is still handed to
+  /// FinalizeInMainThread, which has to check IsCancelled itself.
+  virtual bool IsCancelled() const
+  {
+    return false;
+  }
   virtual ~BackgroundJob()            = default;
 };
 
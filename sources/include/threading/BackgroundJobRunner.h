@@ -2,103 +2,247 @@
 #define THEPROJECTMAIN_BACKGROUNDJOBRUNNER_H
 
 #include "BackgroundJob.h"
+#include "JobScheduler.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <mutex>
-#include <thread>
 
 namespace threading {
 
-template <int ConcurrencyLevel = 4> class BackgroundJobRunner
+/// Limits the main-thread work of one BackgroundJobRunner::Run call. At least one job is
+/// finalized per call, even when it alone goes over the budget.
+struct FinalizationBudget
+{
+  std::chrono::microseconds Time{ 2000 };
+  /// Upload bytes, see BackgroundJob::GetFinalizationBytes. Zero means no limit.
+  size_t Bytes = 0;
+};
+
+struct FinalizationStats
+{
+  uint32_t JobsFinalized = 0;
+  /// Finished jobs left for the next call.
+  uint32_t                  JobsPending    = 0;
+  size_t                    BytesFinalized = 0;
+  std::chrono::microseconds TimeSpent{ 0 };
+};
+
+/// Runs jobs on the workers of a JobScheduler, then hands them to the main thread for
+/// FinalizeInMainThread. Several runners can share one scheduler. Queued jobs wait in a priority
+/// queue of the runner, every free worker takes the one with the lowest priority value.
+class BackgroundJobRunner
 {
   public:
-  BackgroundJobRunner()
+  explicit BackgroundJobRunner(JobScheduler& scheduler = JobScheduler::Get())
+      : m_scheduler(scheduler)
+      , m_state(core::MakeShared<SharedState>())
+  {
+  }
+
+  /// Waits for jobs that are already running. Jobs that did not start yet are dropped.
+  ~BackgroundJobRunner()
+  {
+    m_state->Shutdown = true;
+
+    std::unique_lock<std::mutex> lock(m_state->FinalizationQueueMutex);
+    m_state->JobFinished.wait(lock, [this]() { return m_state->RunningJobs.load() == 0; });
+  }
+
+  /// Jobs with the same priority run in the order they were queued.
+  void EnqueueBackgroundJob(BackgroundJob* backgroundJob, float priority = 0)
   {
-    m_killAllThreads = false;
-    for (int i = 0; i < ConcurrencyLevel; i++)
     {
-      m_threads[i] = std::thread(&ThreadRunner, this);
+      std::lock_guard<std::mutex> lock(m_state->PendingJobsMutex);
+      m_state->PendingJobs.push_back(
+          { priority, m_nextSequence++, core::UniquePtr<BackgroundJob>(backgroundJob) });
+      std::push_heap(m_state->PendingJobs.begin(), m_state->PendingJobs.end());
     }
+    m_scheduler.Submit(new RunJobTask(m_state));
   }
 
-  ~BackgroundJobRunner()
+  /// Assigns new priorities to the jobs that did not start yet, priorityOf(const BackgroundJob&)
+  /// returns the new value. Cancelled jobs are moved to finalization right away.
+  template <class TFunc> void Reprioritize(TFunc&& priorityOf)
+  {
+    core::Vector<core::UniquePtr<BackgroundJob>> cancelled;
+    {
+      std::lock_guard<std::mutex> lock(m_state->PendingJobsMutex);
+      auto& pending = m_state->PendingJobs;
+      for (size_t i = 0; i < pending.size();)
+      {
+        if (pending[i].Job->IsCancelled())
+        {
+          cancelled.push_back(core::Move(pending[i].Job));
+          pending[i] = core::Move(pending.back());
+          pending.pop_back();
+          continue;
+        }
+        pending[i].Priority = priorityOf(static_cast<const BackgroundJob&>(*pending[i].Job));
+        i++;
+      }
+      std::make_heap(pending.begin(), pending.end());
+    }
+
+    if (cancelled.empty() == false)
+    {
+      std::lock_guard<std::mutex> lock(m_state->FinalizationQueueMutex);
+      for (auto& job : cancelled)
+      {
+        m_state->FinalizationQueue.push(core::Move(job));
+      }
+    }
+  }
+
+  /// Jobs queued and not taken by a worker yet.
+  size_t GetPendingJobCount() const
   {
-    JoinAllRunners();
+    std::lock_guard<std::mutex> lock(m_state->PendingJobsMutex);
+    return m_state->PendingJobs.size();
   }
 
-  void EnqueueBackgroundJob(BackgroundJob* backgroundJob)
+  /// Jobs done running and not finalized yet. Main thread only, like Run.
+  size_t GetFinishedJobCount() const
   {
-    m_jobQueueMutex.lock();
-    m_backgroundJobQueue.push(core::UniquePtr<BackgroundJob>(backgroundJob));
-    m_jobQueueMutex.unlock();
+    std::lock_guard<std::mutex> lock(m_state->FinalizationQueueMutex);
+    return m_state->FinalizationQueue.size() + m_finalizationBacklog.size();
   }
 
-  void Run()
+  /// Finalizes finished jobs in the order they finished until the budget is used up. Call once
+  /// per frame from the main thread.
+  FinalizationStats Run(const FinalizationBudget& budget = FinalizationBudget())
   {
-    if (m_mainThreadFinalizationQueue.empty() == false)
+    using Clock = std::chrono::steady_clock;
+
+    FinalizationStats stats;
+    const auto        start = Clock::now();
+
+    for (;;)
     {
-      core::UniquePtr<BackgroundJob> backgroundJob = nullptr;
+      if (m_finalizationBacklog.empty())
+      {
+        // Takes everything the workers finished so far with one lock, instead of one per job.
+        std::lock_guard<std::mutex> lock(m_state->FinalizationQueueMutex);
+        std::swap(m_finalizationBacklog, m_state->FinalizationQueue);
+      }
+      if (m_finalizationBacklog.empty())
+      {
+        break;
+      }
 
-      m_mainThreadFinalizationQueueMutex.lock();
-      backgroundJob = core::Move(m_mainThreadFinalizationQueue.front());
-      m_mainThreadFinalizationQueue.pop();
-      m_mainThreadFinalizationQueueMutex.unlock();
+      BackgroundJob* backgroundJob = m_finalizationBacklog.front().get();
+      const size_t   bytes         = backgroundJob->GetFinalizationBytes();
+      if (stats.JobsFinalized > 0 &&
+          (Clock::now() - start >= budget.Time ||
+           (budget.Bytes != 0 && stats.BytesFinalized + bytes > budget.Bytes)))
+      {
+        break;
+      }
 
-      ASSERT(backgroundJob);
       backgroundJob->FinalizeInMainThread();
+      m_finalizationBacklog.pop();
+      stats.JobsFinalized++;
+      stats.BytesFinalized += bytes;
     }
+
+    stats.JobsPending = uint32_t(m_finalizationBacklog.size());
+    stats.TimeSpent   = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start);
+    return stats;
   }
 
   private:
-  static void ThreadRunner(BackgroundJobRunner* runner)
+  /// Owned by the runner and by its queued tasks, which may still sit in the scheduler after the
+  /// runner is gone.
+  struct PendingJob
+  {
+    float                          Priority;
+    uint64_t                       Sequence;
+    core::UniquePtr<BackgroundJob> Job;
+
+    /// std::push_heap keeps the largest element on top, so "less" means "runs later".
+    bool operator<(const PendingJob& other) const
+    {
+      if (Priority != other.Priority)
+      {
+        return Priority > other.Priority;
+      }
+      return Sequence > other.Sequence;
+    }
+  };
+
+  struct SharedState
   {
-    while (runner->m_killAllThreads == false)
+    std::mutex                                  PendingJobsMutex;
+    core::Vector<PendingJob>                    PendingJobs;
+    std::atomic<bool>                           Shutdown{ false };
+    std::atomic<uint32_t>                       RunningJobs{ 0 };
+    std::mutex                                  FinalizationQueueMutex;
+    std::condition_variable                     JobFinished;
+    core::Queue<core::UniquePtr<BackgroundJob>> FinalizationQueue;
+  };
+
+  /// Submitted once per queued job, runs whichever job has the lowest priority value by the time
+  /// a worker gets to it. Finds nothing when Reprioritize already moved a cancelled job out.
+  class RunJobTask : public SchedulerTask
+  {
+    public:
+    explicit RunJobTask(core::SharedPtr<SharedState> state)
+        : m_state(core::Move(state))
     {
-      core::UniquePtr<BackgroundJob> backgroundJobToRun = nullptr;
+    }
 
-      if (runner->m_jobQueueMutex.try_lock())
+    void Execute() final
+    {
+      // Pairs with the destructor, which sets Shutdown and then reads RunningJobs: either it
+      // waits for this job, or this job sees Shutdown and never starts.
+      m_state->RunningJobs++;
+      core::UniquePtr<BackgroundJob> job = nullptr;
+      if (m_state->Shutdown.load() == false)
       {
-        if (runner->m_backgroundJobQueue.empty() == false)
+        std::lock_guard<std::mutex> lock(m_state->PendingJobsMutex);
+        auto& pending = m_state->PendingJobs;
+        if (pending.empty() == false)
         {
-          backgroundJobToRun = core::Move(runner->m_backgroundJobQueue.front());
-          runner->m_backgroundJobQueue.pop();
+          std::pop_heap(pending.begin(), pending.end());
+          job = core::Move(pending.back().Job);
+          pending.pop_back();
         }
-        runner->m_jobQueueMutex.unlock();
       }
 
-      if (backgroundJobToRun)
+      if (job && job->IsCancelled() == false)
       {
-        backgroundJobToRun->Run();
+        job->Run();
+      }
 
-        runner->m_mainThreadFinalizationQueueMutex.lock();
-        runner->m_mainThreadFinalizationQueue.push(core::Move(backgroundJobToRun));
-        runner->m_mainThreadFinalizationQueueMutex.unlock();
+      bool wakeDestructor = false;
+      {
+        std::lock_guard<std::mutex> lock(m_state->FinalizationQueueMutex);
+        if (job)
+        {
+          m_state->FinalizationQueue.push(core::Move(job));
+        }
+        m_state->RunningJobs--;
+        wakeDestructor = m_state->Shutdown.load();
       }
-      else
+      if (wakeDestructor)
       {
-        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        m_state->JobFinished.notify_all();
       }
-    }
-  }
 
-  void JoinAllRunners()
-  {
-    m_killAllThreads = true;
-    for (int i = 0; i < ConcurrencyLevel; i++)
-    {
-      elog::LogInfo(core::string::format("Joining thread <{}>", i));
-      m_threads[i].join();
-      elog::LogInfo(core::string::format("Joined thread <{}>", i));
+      delete this;
     }
-  }
 
-  void UpdateJobs() {}
+    private:
+    core::SharedPtr<SharedState> m_state;
+  };
 
   private:
-  bool                                        m_killAllThreads;
-  core::Array<std::thread, ConcurrencyLevel>  m_threads;
-  std::mutex                                  m_jobQueueMutex;
-  std::mutex                                  m_mainThreadFinalizationQueueMutex;
-  core::Queue<core::UniquePtr<BackgroundJob>> m_backgroundJobQueue;
-  core::Queue<core::UniquePtr<BackgroundJob>> m_mainThreadFinalizationQueue;
+  JobScheduler&                                m_scheduler;
+  core::SharedPtr<SharedState>                 m_state;
+  /// Finished jobs taken from the shared queue and not finalized yet, main thread only.
+  core::Queue<core::UniquePtr<BackgroundJob>> m_finalizationBacklog;
+  uint64_t                                    m_nextSequence = 0;
 };
 
 } // namespace threading
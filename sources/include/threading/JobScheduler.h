@@ -0,0 +1,101 @@
+#ifndef THEPROJECTMAIN_JOBSCHEDULER_H
+#define THEPROJECTMAIN_JOBSCHEDULER_H
+
+#include "WorkStealingDeque.h"
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+namespace threading {
+
+/// Unit of work for the JobScheduler. Once Execute() is called the task owns itself, tasks that
+/// are never executed because the scheduler shut down are deleted by the scheduler.
+class SchedulerTask
+{
+  public:
+  virtual void Execute()   = 0;
+  virtual ~SchedulerTask() = default;
+};
+
+/// Work-stealing thread pool. Every worker owns a Chase-Lev deque: tasks submitted from a worker
+/// go to its own deque without locking, tasks submitted from other threads are spread round-robin
+/// over small per-worker inboxes. Idle workers steal from the others and block on a condition
+/// variable once there is nothing left anywhere.
+class JobScheduler
+{
+  public:
+  explicit JobScheduler(uint32_t workerCount = GetDefaultWorkerCount());
+  ~JobScheduler();
+
+  JobScheduler(const JobScheduler&)            = delete;
+  JobScheduler& operator=(const JobScheduler&) = delete;
+
+  /// Process-wide scheduler shared by meshing, world generation and I/O.
+  static JobScheduler& Get();
+
+  /// One worker per hardware thread, minus the main thread.
+  static uint32_t GetDefaultWorkerCount();
+
+  uint32_t GetWorkerCount() const
+  {
+    return uint32_t(m_workers.size());
+  }
+
+  void Submit(SchedulerTask* task);
+
+  /// Runs func() on a worker.
+  template <class TFunc> void SubmitFunction(TFunc&& func)
+  {
+    Submit(new FunctionTask<std::decay_t<TFunc>>(std::forward<TFunc>(func)));
+  }
+
+  private:
+  template <class TFunc> class FunctionTask : public SchedulerTask
+  {
+    public:
+    explicit FunctionTask(TFunc&& func)
+        : m_func(core::Move(func))
+    {
+    }
+
+    explicit FunctionTask(const TFunc& func)
+        : m_func(func)
+    {
+    }
+
+    void Execute() final
+    {
+      m_func();
+      delete this;
+    }
+
+    private:
+    TFunc m_func;
+  };
+
+  struct Worker
+  {
+    WorkStealingDeque<SchedulerTask> Deque;
+    std::mutex                       InboxMutex;
+    core::Vector<SchedulerTask*>     Inbox;
+    std::thread                      Thread;
+  };
+
+  void           WorkerLoop(uint32_t workerIndex);
+  SchedulerTask* FindTask(uint32_t workerIndex);
+  void           WakeWorker();
+
+  private:
+  core::Vector<core::UniquePtr<Worker>> m_workers;
+  std::atomic<uint32_t>                 m_nextInbox{ 0 };
+  /// Tasks submitted and not yet taken by a worker, workers only sleep while this is zero.
+  std::atomic<int64_t>                  m_queuedTasks{ 0 };
+  std::atomic<uint32_t>                 m_sleepingWorkers{ 0 };
+  std::atomic<bool>                     m_stop{ false };
+  std::mutex                            m_sleepMutex;
+  std::condition_variable               m_taskAvailable;
+};
+
+} // namespace threading
+#endif // THEPROJECTMAIN_JOBSCHEDULER_H
@@ -0,0 +1,176 @@
+#ifndef THEPROJECTMAIN_TASKGRAPH_H
+#define THEPROJECTMAIN_TASKGRAPH_H
+
+#include "BackgroundJobRunner.h"
+#include "JobScheduler.h"
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+
+namespace threading {
+
+/// One node of a TaskGraph. Starts once every task it depends on is done, then starts the tasks
+/// that depend on it.
+class Task : public std::enable_shared_from_this<Task>
+{
+  public:
+  Task(JobScheduler* scheduler, std::function<void()> func, uint32_t dependencyCount)
+      : m_scheduler(scheduler)
+      , m_func(core::Move(func))
+      , m_pendingDependencies(dependencyCount)
+  {
+  }
+
+  [[nodiscard]] bool IsDone() const
+  {
+    return m_done.load();
+  }
+
+  /// Blocks until the task is done. Not from a scheduler worker, it could wait for itself.
+  void Wait()
+  {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_doneCondition.wait(lock, [this]() { return m_done.load(); });
+  }
+
+  private:
+  friend class TaskGraph;
+
+  /// False when the task is already done, the continuation is then not kept.
+  bool AddContinuation(core::SharedPtr<Task> continuation)
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_done)
+    {
+      return false;
+    }
+    m_continuations.push_back(core::Move(continuation));
+    return true;
+  }
+
+  /// Fan-in: the last dependency to finish starts the task.
+  void DependencyDone()
+  {
+    if (--m_pendingDependencies == 0)
+    {
+      Start();
+    }
+  }
+
+  void Start()
+  {
+    if (m_func == nullptr)
+    {
+      // WhenAll has nothing to run, it is done as soon as its dependencies are.
+      Complete();
+      return;
+    }
+
+    m_scheduler->SubmitFunction([self = shared_from_this()]() {
+      self->m_func();
+      self->m_func = nullptr;
+      self->Complete();
+    });
+  }
+
+  void Complete()
+  {
+    core::Vector<core::SharedPtr<Task>> continuations;
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_done = true;
+      continuations.swap(m_continuations);
+    }
+    m_doneCondition.notify_all();
+
+    for (auto& continuation : continuations)
+    {
+      continuation->DependencyDone();
+    }
+  }
+
+  private:
+  JobScheduler*                       m_scheduler;
+  std::function<void()>               m_func;
+  std::atomic<uint32_t>               m_pendingDependencies;
+  std::atomic<bool>                   m_done{ false };
+  std::mutex                          m_mutex;
+  std::condition_variable             m_doneCondition;
+  core::Vector<core::SharedPtr<Task>> m_continuations;
+};
+
+using TaskHandle = core::SharedPtr<Task>;
+
+/// Builds chains and fan-ins of tasks that run on a JobScheduler without the main thread
+/// starting each step, e.g. generate a chunk and its six neighbors, then mesh it, then upload.
+/// Tasks can be added from any thread, including from inside other tasks.
+class TaskGraph
+{
+  public:
+  explicit TaskGraph(JobScheduler& scheduler = JobScheduler::Get())
+      : m_scheduler(scheduler)
+  {
+  }
+
+  /// Runs func on a worker right away.
+  TaskHandle Run(std::function<void()> func)
+  {
+    return RunAfter({}, core::Move(func));
+  }
+
+  /// Runs func on a worker once every task in dependencies is done.
+  TaskHandle RunAfter(const core::Vector<TaskHandle>& dependencies, std::function<void()> func)
+  {
+    return Link(dependencies, core::Move(func));
+  }
+
+  /// Continuation of a single task.
+  TaskHandle Then(const TaskHandle& task, std::function<void()> func)
+  {
+    return Link({ task }, core::Move(func));
+  }
+
+  /// Done once every task in tasks is done, to chain on or to Wait for.
+  TaskHandle WhenAll(const core::Vector<TaskHandle>& tasks)
+  {
+    return Link(tasks, nullptr);
+  }
+
+  /// Queues backgroundJob on runner once every task in dependencies is done. The job runs like
+  /// any other job of the runner and is finalized by its Run in the main thread. The returned
+  /// task is done once the job is queued, not once it ran.
+  TaskHandle EnqueueAfter(const core::Vector<TaskHandle>& dependencies, BackgroundJobRunner& runner,
+                          BackgroundJob* backgroundJob, float priority = 0)
+  {
+    // std::function has to be copyable, so the job is owned through a shared holder until then.
+    auto job = core::MakeShared<core::UniquePtr<BackgroundJob>>(backgroundJob);
+    return Link(dependencies, [&runner, job, priority]() {
+      runner.EnqueueBackgroundJob(job->release(), priority);
+    });
+  }
+
+  private:
+  TaskHandle Link(const core::Vector<TaskHandle>& dependencies, std::function<void()> func)
+  {
+    // One extra count, so the task can not start while dependencies are still being linked.
+    auto task = core::MakeShared<Task>(&m_scheduler, core::Move(func),
+                                       uint32_t(dependencies.size()) + 1);
+    for (const TaskHandle& dependency : dependencies)
+    {
+      if (dependency->AddContinuation(task) == false)
+      {
+        task->DependencyDone();
+      }
+    }
+    task->DependencyDone();
+    return task;
+  }
+
+  private:
+  JobScheduler& m_scheduler;
+};
+
+} // namespace threading
+#endif // THEPROJECTMAIN_TASKGRAPH_H
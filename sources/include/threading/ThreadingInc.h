@@ -2,4 +2,6 @@
 #define THEPROJECTMAIN_THREADINGINC_H
 #include "BackgroundJob.h"
 #include "BackgroundJobRunner.h"
+#include "JobScheduler.h"
+#include "TaskGraph.h"
 #endif // THEPROJECTMAIN_THREADINGINC_H
@@ -0,0 +1,152 @@
+#ifndef THEPROJECTMAIN_WORKSTEALINGDEQUE_H
+#define THEPROJECTMAIN_WORKSTEALINGDEQUE_H
+
+#include <atomic>
+#include <cstdint>
+
+namespace threading {
+
+/// Chase-Lev deque of pointers. The owning thread pushes and pops at the bottom without locking,
+/// any other thread may steal from the top. Memory orderings follow Lê et al., "Correct and
+/// Efficient Work-Stealing for Weak Memory Models" (2013).
+template <class T> class WorkStealingDeque
+{
+  public:
+  /// initialCapacity has to be a power of two.
+  explicit WorkStealingDeque(int64_t initialCapacity = 256)
+      : m_buffer(new Buffer(initialCapacity))
+  {
+  }
+
+  WorkStealingDeque(const WorkStealingDeque&)            = delete;
+  WorkStealingDeque& operator=(const WorkStealingDeque&) = delete;
+
+  ~WorkStealingDeque()
+  {
+    delete m_buffer.load(std::memory_order_relaxed);
+  }
+
+  /// Owner thread only.
+  void Push(T* item)
+  {
+    const int64_t bottom = m_bottom.load(std::memory_order_relaxed);
+    const int64_t top    = m_top.load(std::memory_order_acquire);
+    Buffer*       buffer = m_buffer.load(std::memory_order_relaxed);
+
+    if (bottom - top > buffer->Capacity - 1)
+    {
+      buffer = Grow(buffer, top, bottom);
+    }
+
+    // A release store instead of the paper's release fence, which thread sanitizers do not model.
+    buffer->Put(bottom, item);
+    m_bottom.store(bottom + 1, std::memory_order_release);
+  }
+
+  /// Owner thread only. Returns the most recently pushed item, or nullptr when empty.
+  T* Pop()
+  {
+    const int64_t bottom = m_bottom.load(std::memory_order_relaxed) - 1;
+    Buffer*       buffer = m_buffer.load(std::memory_order_relaxed);
+    m_bottom.store(bottom, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t top = m_top.load(std::memory_order_relaxed);
+
+    if (top > bottom)
+    {
+      m_bottom.store(bottom + 1, std::memory_order_relaxed);
+      return nullptr;
+    }
+
+    T* item = buffer->Get(bottom);
+    if (top == bottom)
+    {
+      // Last item, race the thieves for it.
+      if (!m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst,
+                                         std::memory_order_relaxed))
+      {
+        item = nullptr;
+      }
+      m_bottom.store(bottom + 1, std::memory_order_relaxed);
+    }
+    return item;
+  }
+
+  /// Any thread. Returns the oldest item, or nullptr when empty or when another thread won it.
+  T* Steal()
+  {
+    int64_t top = m_top.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    const int64_t bottom = m_bottom.load(std::memory_order_acquire);
+
+    if (top >= bottom)
+    {
+      return nullptr;
+    }
+
+    T* item = m_buffer.load(std::memory_order_acquire)->Get(top);
+    if (!m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst,
+                                       std::memory_order_relaxed))
+    {
+      return nullptr;
+    }
+    return item;
+  }
+
+  /// Approximate when other threads push, pop or steal at the same time.
+  bool IsEmpty() const
+  {
+    return m_bottom.load(std::memory_order_relaxed) <= m_top.load(std::memory_order_relaxed);
+  }
+
+  private:
+  struct Buffer
+  {
+    explicit Buffer(int64_t capacity)
+        : Capacity(capacity)
+        , Slots(new std::atomic<T*>[capacity])
+    {
+    }
+
+    ~Buffer()
+    {
+      delete[] Slots;
+      delete Previous;
+    }
+
+    T* Get(int64_t index) const
+    {
+      return Slots[index & (Capacity - 1)].load(std::memory_order_relaxed);
+    }
+
+    void Put(int64_t index, T* item)
+    {
+      Slots[index & (Capacity - 1)].store(item, std::memory_order_relaxed);
+    }
+
+    const int64_t    Capacity;
+    std::atomic<T*>* Slots;
+    /// Thieves may still read from the buffer this one replaced, so it is freed with the deque.
+    Buffer* Previous = nullptr;
+  };
+
+  Buffer* Grow(Buffer* buffer, int64_t top, int64_t bottom)
+  {
+    Buffer* grown = new Buffer(buffer->Capacity * 2);
+    for (int64_t i = top; i < bottom; i++)
+    {
+      grown->Put(i, buffer->Get(i));
+    }
+    grown->Previous = buffer;
+    m_buffer.store(grown, std::memory_order_release);
+    return grown;
+  }
+
+  private:
+  alignas(64) std::atomic<int64_t> m_top{ 0 };
+  alignas(64) std::atomic<int64_t> m_bottom{ 0 };
+  std::atomic<Buffer*> m_buffer;
+};
+
+} // namespace threading
+#endif // THEPROJECTMAIN_WORKSTEALINGDEQUE_H
@@ -16,6 +16,11 @@ inline void RemoveBit(uint8_t &b, uint8_t b2) { b &= ~b2; }
 
 inline void AddBit(uint32_t &b, uint32_t b2) { b |= b2; }
 
+/// Smallest power of two not less than v.
+inline uint64_t NextPowerOfTwo(uint64_t v) {
+  return v <= 1 ? 1 : uint64_t(1) << (64 - __builtin_clzll(v - 1));
+}
+
 template <class T>
 void swap(T& a, T&b){
   T tmp = a;
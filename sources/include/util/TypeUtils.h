@@ -5,4 +5,14 @@
   Type(const Type&)            = delete;                                                           \
   Type& operator=(const Type&) = delete
 
+namespace util {
+/// Wrapping a parameter type in TypeIdentityT excludes it from template argument deduction.
+template <class T> struct TypeIdentity
+{
+  using type = T;
+};
+
+template <class T> using TypeIdentityT = typename TypeIdentity<T>::type;
+} // namespace util
+
 #endif // THEPROJECTMAIN_TYPEUTILS_H
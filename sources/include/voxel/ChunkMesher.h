@@ -1,15 +1,53 @@
 #ifndef THEPROJECT2_CHUNKMESHER_H
 #define THEPROJECT2_CHUNKMESHER_H
+#include "ChunkOccupancy.h"
 #include "VoxNode.h"
 
 namespace vox{
 class VoxelMesh;
 struct MaskNode;
+struct SliceFaces;
+
+/// Solid cells one voxel outside each side of a chunk, taken from the neighbor chunks so faces
+/// between two solid chunks can be culled. Rows are laid out like the mesher slices: the x sides
+/// hold rows along y indexed by z, the y sides rows along x indexed by z and the z sides rows
+/// along x indexed by y. Sides without a neighbor stay empty.
+struct ChunkApron {
+  enum ESide : uint8_t {
+    NegX, PosX, NegY, PosY, NegZ, PosZ
+  };
+
+  uint32_t Rows[6][32] = {};
+
+  /// Copies the layer of neighbor that touches this chunk on side.
+  void SetSide(ESide side, const ChunkOccupancy &neighbor);
+};
+
 class ChunkMesher {
 public:
-  ChunkMesher();
+  /// Both modes produce the same mesh. Greedy scans a MaskNode grid per slice, BinaryGreedy
+  /// culls and merges faces on 32-bit rows of cells.
+  enum class EMode {
+    Greedy, BinaryGreedy
+  };
+
+  explicit ChunkMesher(EMode mode = EMode::BinaryGreedy);
+
+  /// Bakes per-vertex ambient occlusion into packed vertices, on by default. Faces then only
+  /// merge with neighbors of the same uniform AO.
+  void SetAmbientOcclusion(bool enable) { m_ambientOcclusion = enable; }
 
-  void BuildChunk(core::Vector<VoxNode>::iterator begin, core::Vector<VoxNode>::iterator end, VoxelMesh* voxMesh);
+  /// Meshes the chunk into voxMesh and records the quad range of every slice in it.
+  void BuildChunk(core::Vector<VoxNode>::iterator begin, core::Vector<VoxNode>::iterator end, VoxelMesh* voxMesh,
+                  const ChunkApron &apron = ChunkApron());
+  /// Loads a chunk without meshing it, so that UpdateVoxel can patch a mesh built from it.
+  void LoadChunk(core::Vector<VoxNode>::iterator begin, core::Vector<VoxNode>::iterator end,
+                 const ChunkApron &apron = ChunkApron());
+  /// Sets (node != nullptr) or clears one cell of the loaded chunk and re-meshes only the slices
+  /// that see it, at most three per face plane, replacing their quads in mesh. The cell may lie
+  /// one voxel outside the chunk, which edits the apron. mesh must hold the loaded chunk as
+  /// BuildChunk or earlier UpdateVoxel calls left it.
+  void UpdateVoxel(VoxelMesh *mesh, glm::ivec3 cell, const VoxNode *node);
 
 private:
   enum class FacePlane {
@@ -17,9 +55,16 @@ private:
   };
 
 private:
-  VoxNode GetBuildNode(uint32_t x, uint32_t y, uint32_t z);
+  struct BuildColor {
+    uint8_t r, g, b;
+  };
+
+  /// Coordinates one step outside the chunk (32, or -1 wrapped around) are read from the apron.
   bool CheckBuildNode(uint32_t x, uint32_t y, uint32_t z);
-  void SetBuildNode(const VoxNode &node);
+  uint32_t GetBuildColumn(uint32_t x, uint32_t z);
+  void SetBuildNode(uint32_t x, uint32_t y, uint32_t z, const VoxNode &node);
+  void ResetBuildNode(uint32_t x, uint32_t y, uint32_t z);
+  void SetApronCell(uint32_t x, uint32_t y, uint32_t z, bool solid);
   void ClearBuildNodes();
 
   void BuildSliceMask(uint32_t dir, uint32_t slice, MaskNode mask[32][32]);
@@ -28,16 +73,32 @@ private:
 
   void AddFaceToMesh(vox::VoxelMesh *mesh, bool frontFace,
                                   FacePlane dir, uint32_t slice,
-                                  glm::ivec2 start, glm::ivec2 dims, uint8_t color[3]);
+                                  glm::ivec2 start, glm::ivec2 dims, uint8_t color[3],
+                                  uint8_t ao);
 
+  /// ao holds the AO level 0..3 of each face vertex.
   void AddQuadToMesh(vox::VoxelMesh *mesh, const glm::vec3 *face, glm::ivec2 dims,
-                     bool frontFace, FacePlane facePlane, const uint8_t color[3]) noexcept;
+                     bool frontFace, FacePlane facePlane, const uint8_t color[3],
+                     const uint8_t ao[4]) noexcept;
 
 
-  void GreedyBuildChunk(vox::VoxelMesh *mesh);
+  void BuildSliceFaces(uint32_t dim, uint32_t slice, SliceFaces &faces);
+  void MergeSliceFaces(vox::VoxelMesh *mesh, uint32_t dim, uint32_t slice, SliceFaces &faces,
+                       bool frontFace);
+  /// Appends the quads of one slice, recording where they start in mesh->SliceQuadStart.
+  void MeshSlice(vox::VoxelMesh *mesh, uint32_t dim, uint32_t slice);
 
   uint8_t GetVisibleBuildNodeSides(uint32_t x, uint32_t y, uint32_t z);
-  VoxNode m_buildNodes[32][32][32];
+  /// AO of the four corners of a face of mask cell (i, j), 2 bits each.
+  uint8_t GetFaceAO(uint32_t dim, uint32_t slice, bool frontFace, uint32_t i, uint32_t j);
+  /// Solid cells of the chunk being built, colors are only meaningful where a bit is set.
+  ChunkOccupancy m_buildOccupancy;
+  /// The same cells as rows along x, m_buildRows[z][y] bit x.
+  uint32_t m_buildRows[32][32];
+  BuildColor m_buildColors[32][32][32];
+  ChunkApron m_apron;
+  EMode m_mode;
+  bool m_ambientOcclusion = true;
 };
 }
 
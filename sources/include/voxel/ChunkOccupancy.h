@@ -0,0 +1,61 @@
+#ifndef THEPROJECT2_INCLUDE_VOXEL_CHUNKOCCUPANCY_H_
+#define THEPROJECT2_INCLUDE_VOXEL_CHUNKOCCUPANCY_H_
+
+/// Solid cells of one 32^3 chunk in 4 KB: one 32-bit column per x/z pair, bit y set when the
+/// voxel at local (x, y, z) is solid. Neighbor tests along y are shifts of one column, along x and
+/// z they combine two columns, so a whole row of cells is answered by one word operation.
+namespace vox {
+struct ChunkOccupancy
+{
+  static constexpr uint32_t Size = 32;
+
+  uint32_t Columns[Size][Size]; /// [x][z]
+
+  ChunkOccupancy()
+  {
+    Clear();
+  }
+
+  void Clear()
+  {
+    std::fill(&Columns[0][0], &Columns[0][0] + Size * Size, 0u);
+  }
+
+  uint32_t Column(uint32_t x, uint32_t z) const
+  {
+    return Columns[x][z];
+  }
+
+  bool Get(uint32_t x, uint32_t y, uint32_t z) const
+  {
+    return (Columns[x][z] >> y) & 1u;
+  }
+
+  void Set(uint32_t x, uint32_t y, uint32_t z)
+  {
+    Columns[x][z] |= 1u << y;
+  }
+
+  void Reset(uint32_t x, uint32_t y, uint32_t z)
+  {
+    Columns[x][z] &= ~(1u << y);
+  }
+
+  bool IsEmpty() const
+  {
+    for (uint32_t x = 0; x < Size; x++)
+      for (uint32_t z = 0; z < Size; z++)
+        if (Columns[x][z])
+          return false;
+    return true;
+  }
+
+  /// Bits first..last of a column, inclusive.
+  static uint32_t RangeMask(uint32_t first, uint32_t last)
+  {
+    return (~0u >> (Size - 1 - last)) & (~0u << first);
+  }
+};
+} // namespace vox
+
+#endif // THEPROJECT2_INCLUDE_VOXEL_CHUNKOCCUPANCY_H_
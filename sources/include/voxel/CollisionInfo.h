@@ -4,12 +4,12 @@
 #include "VoxNode.h"
 
 namespace vox {
-struct CollisionInfo {
-  VoxNode node;
+template <class TKey> struct BasicCollisionInfo {
+  BasicVoxNode<TKey> node;
   float nearestDistance;
   glm::vec3 rayStart, rayDirection, rayInverseDirection;
 
-  CollisionInfo(glm::vec3 ray_start, glm::vec3 ray_direction){
+  BasicCollisionInfo(glm::vec3 ray_start, glm::vec3 ray_direction){
     rayStart = ray_start;
     rayDirection = glm::normalize(ray_direction);
     rayInverseDirection = 1.0f/ray_direction;
@@ -22,11 +22,16 @@ struct CollisionInfo {
   }
 };
 
-struct AABBCollisionInfo {
-  uint32_t voxelMK;
+template <class TKey> struct BasicAABBCollisionInfo {
+  TKey voxelMK;
   float time;
   glm::vec3 normal;
 };
+
+using CollisionInfo       = BasicCollisionInfo<uint32_t>;
+using CollisionInfo64     = BasicCollisionInfo<uint64_t>;
+using AABBCollisionInfo   = BasicAABBCollisionInfo<uint32_t>;
+using AABBCollisionInfo64 = BasicAABBCollisionInfo<uint64_t>;
 }
 
-#endif
\ No newline at end of file
+#endif
@@ -1,6 +1,7 @@
 #ifndef COLLISIONMANAGER_H
 #define COLLISIONMANAGER_H
 
+#include "MortonOccupancy.h"
 #include "VoxelFwd.h"
 
 namespace core {
@@ -9,15 +10,22 @@ class AxisAlignedBoundingBox;
 
 namespace vox {
 
-class CollisionManager {
+template <class TKey> class BasicCollisionManager {
 public:
-  CollisionManager(core::SharedPtr<MortonOctree> octree);
-  virtual ~CollisionManager();
+  using Octree            = BasicMortonOctree<TKey>;
+  using CollisionInfo     = BasicCollisionInfo<TKey>;
+  using AABBCollisionInfo = BasicAABBCollisionInfo<TKey>;
+  using Occupancy         = MortonOccupancy<TKey>;
+
+  BasicCollisionManager(core::SharedPtr<Octree> octree);
+  virtual ~BasicCollisionManager();
 
   bool CheckCollision(const glm::vec3 &bmin, const glm::vec3 &bmax,
                       const glm::vec3 &rayStart,
                       const glm::vec3 &rayDirectionInverse);
+  /// True when a solid voxel cell overlaps aabb, answered from the chunk occupancy bitsets.
   bool CheckCollision(const core::AxisAlignedBoundingBox &aabb);
+  /// Same as CheckCollision(aabb).
   bool CheckCollisionB(const core::AxisAlignedBoundingBox &aabb);
   core::Vector<AABBCollisionInfo>
   CheckCollisionSwept(const core::AxisAlignedBoundingBox &aabb,
@@ -28,11 +36,12 @@ public:
   void Collide(CollisionInfo &colInfo);
 
 protected:
-  void Collide(CollisionInfo &colInfo, uint32_t depthLevel,
-               const glm::ivec3 &octStart);
+  /// Descends only into cells the occupancy tree marks as non-empty.
+  void Collide(CollisionInfo &colInfo, uint32_t depthLevel, const glm::ivec3 &octStart,
+               const Occupancy &occupancy, const typename Occupancy::Cell &cell);
 protected:
-  core::SharedPtr<MortonOctree> m_octree;
-  uint32_t Depth; /// just until we get rid of templated octree.
+  core::SharedPtr<Octree> m_octree;
+  uint32_t Depth;
 };
 }
 
@@ -1,8 +1,12 @@
 #ifndef MORTON_H_INCLUDED
 #define MORTON_H_INCLUDED
 
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#endif
+
 namespace vox {
-static constexpr uint32_t MaxMortonKey = 1073741824; // 21 bits MAX morton key
+static constexpr uint32_t MaxMortonKey = 1073741824; // 30 bits MAX morton key
 
 static constexpr uint32_t mortonkeyX[256] = {
     0x00000000, 0x00000001, 0x00000008, 0x00000009, 0x00000040, 0x00000041,
@@ -141,47 +145,377 @@ static const uint32_t mortonkeyZ[256] = {
     0x00924120, 0x00924124, 0x00924800, 0x00924804, 0x00924820, 0x00924824,
     0x00924900, 0x00924904, 0x00924920, 0x00924924};
 
-inline uint32_t encodeMK(uint32_t x, uint32_t y, uint32_t z) {
+namespace morton {
+/// Implementations behind encodeMK/decodeMK. LookupTable must stay zero: it is the value the
+/// active codec has before the startup CPU check runs, so early callers get the portable path.
+enum class ECodec : uint8_t
+{
+  LookupTable = 0,
+  MagicBits,
+  BMI2
+};
+
+/// Picks the fastest codec for the running CPU. BMI2 is skipped on CPUs where pdep/pext are
+/// microcoded (AMD before Zen 3), there the tables win by a wide margin.
+ECodec      DetectCodec();
+bool        IsCodecSupported(ECodec codec);
+bool        SetCodec(ECodec codec);
+const char* GetCodecName(ECodec codec);
+
+extern ECodec ActiveCodec;
+
+inline ECodec GetCodec()
+{
+  return ActiveCodec;
+}
+
+static constexpr uint32_t MaskX = 0x09249249u;
+static constexpr uint32_t MaskY = 0x12492492u;
+static constexpr uint32_t MaskZ = 0x24924924u;
+
+/// All codecs take coordinates modulo 1024 so that they produce identical keys.
+inline uint32_t EncodeLUT(uint32_t x, uint32_t y, uint32_t z)
+{
   uint32_t result = 0;
-  result = result | mortonkeyZ[(z >> 8u) & 0xFFu] |
-           mortonkeyY[(y >> 8u) & 0xFFu] | mortonkeyX[(x >> 8u) & 0xFFu];
-  result = result << 24u | mortonkeyZ[(z)&0xFFu] | mortonkeyY[(y)&0xFFu] |
-           mortonkeyX[(x)&0xFFu];
+  result = result | mortonkeyZ[(z >> 8u) & 0x03u] | mortonkeyY[(y >> 8u) & 0x03u] |
+           mortonkeyX[(x >> 8u) & 0x03u];
+  result = result << 24u | mortonkeyZ[(z)&0xFFu] | mortonkeyY[(y)&0xFFu] | mortonkeyX[(x)&0xFFu];
   return result;
 }
 
+inline uint32_t SplitBy3(uint32_t a)
+{
+  a &= 0x000003ffu;
+  a = (a | (a << 16u)) & 0x030000ffu;
+  a = (a | (a << 8u)) & 0x0300f00fu;
+  a = (a | (a << 4u)) & 0x030c30c3u;
+  a = (a | (a << 2u)) & 0x09249249u;
+  return a;
+}
+
+inline uint32_t CompactBy3(uint32_t a)
+{
+  a &= 0x09249249u;
+  a = (a | (a >> 2u)) & 0x030c30c3u;
+  a = (a | (a >> 4u)) & 0x0300f00fu;
+  a = (a | (a >> 8u)) & 0x030000ffu;
+  a = (a | (a >> 16u)) & 0x000003ffu;
+  return a;
+}
+
+inline uint32_t EncodeMagicBits(uint32_t x, uint32_t y, uint32_t z)
+{
+  return SplitBy3(x) | (SplitBy3(y) << 1u) | (SplitBy3(z) << 2u);
+}
+
+inline void DecodeMagicBits(const uint32_t morton, uint32_t& x, uint32_t& y, uint32_t& z)
+{
+  x = CompactBy3(morton);
+  y = CompactBy3(morton >> 1u);
+  z = CompactBy3(morton >> 2u);
+}
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define VOX_MORTON_HAS_BMI2 1
+
+__attribute__((target("bmi2"))) inline uint32_t EncodeBMI2(uint32_t x, uint32_t y, uint32_t z)
+{
+  return _pdep_u32(x, MaskX) | _pdep_u32(y, MaskY) | _pdep_u32(z, MaskZ);
+}
+
+__attribute__((target("bmi2"))) inline void DecodeBMI2(const uint32_t morton, uint32_t& x,
+                                                        uint32_t& y, uint32_t& z)
+{
+  x = _pext_u32(morton, MaskX);
+  y = _pext_u32(morton, MaskY);
+  z = _pext_u32(morton, MaskZ);
+}
+#else
+#define VOX_MORTON_HAS_BMI2 0
+#endif
+
+static constexpr uint64_t MaskX64 = 0x1249249249249249ull;
+static constexpr uint64_t MaskY64 = 0x2492492492492492ull;
+static constexpr uint64_t MaskZ64 = 0x4924924924924924ull;
+
+/// 64-bit keys hold 21 bits per axis, coordinates are taken modulo 2^21.
+inline uint64_t SplitBy3(uint64_t a)
+{
+  a &= 0x00000000001fffffull;
+  a = (a | (a << 32u)) & 0x001f00000000ffffull;
+  a = (a | (a << 16u)) & 0x001f0000ff0000ffull;
+  a = (a | (a << 8u)) & 0x100f00f00f00f00full;
+  a = (a | (a << 4u)) & 0x10c30c30c30c30c3ull;
+  a = (a | (a << 2u)) & 0x1249249249249249ull;
+  return a;
+}
+
+inline uint64_t CompactBy3(uint64_t a)
+{
+  a &= 0x1249249249249249ull;
+  a = (a | (a >> 2u)) & 0x10c30c30c30c30c3ull;
+  a = (a | (a >> 4u)) & 0x100f00f00f00f00full;
+  a = (a | (a >> 8u)) & 0x001f0000ff0000ffull;
+  a = (a | (a >> 16u)) & 0x001f00000000ffffull;
+  a = (a | (a >> 32u)) & 0x00000000001fffffull;
+  return a;
+}
+
+inline uint64_t EncodeMagicBits64(uint32_t x, uint32_t y, uint32_t z)
+{
+  return SplitBy3(uint64_t(x)) | (SplitBy3(uint64_t(y)) << 1u) | (SplitBy3(uint64_t(z)) << 2u);
+}
+
+inline void DecodeMagicBits64(const uint64_t morton, uint32_t& x, uint32_t& y, uint32_t& z)
+{
+  x = uint32_t(CompactBy3(morton));
+  y = uint32_t(CompactBy3(morton >> 1u));
+  z = uint32_t(CompactBy3(morton >> 2u));
+}
+
+#if VOX_MORTON_HAS_BMI2 && defined(__x86_64__)
+__attribute__((target("bmi2"))) inline uint64_t EncodeBMI2_64(uint32_t x, uint32_t y, uint32_t z)
+{
+  return _pdep_u64(x, MaskX64) | _pdep_u64(y, MaskY64) | _pdep_u64(z, MaskZ64);
+}
+
+__attribute__((target("bmi2"))) inline void DecodeBMI2_64(const uint64_t morton, uint32_t& x,
+                                                           uint32_t& y, uint32_t& z)
+{
+  x = uint32_t(_pext_u64(morton, MaskX64));
+  y = uint32_t(_pext_u64(morton, MaskY64));
+  z = uint32_t(_pext_u64(morton, MaskZ64));
+}
+#endif
+} // namespace morton
+
+inline uint32_t encodeMK(uint32_t x, uint32_t y, uint32_t z) {
+#if VOX_MORTON_HAS_BMI2
+  if (morton::ActiveCodec == morton::ECodec::BMI2)
+    return morton::EncodeBMI2(x, y, z);
+#endif
+  if (morton::ActiveCodec == morton::ECodec::MagicBits)
+    return morton::EncodeMagicBits(x, y, z);
+
+  return morton::EncodeLUT(x, y, z);
+}
+
 inline void decodeMK(const uint32_t morton, uint32_t &x, uint32_t &y,
                      uint32_t &z) {
-  x = morton;
-  y = (x >> 1u);
-  z = (x >> 2u);
-  x &= 0x09249249u;
-  y &= 0x09249249u;
-  z &= 0x09249249u;
-  x |= (x >> 2u);
-  y |= (y >> 2u);
-  z |= (z >> 2u);
-  x &= 0x030c30c3u;
-  y &= 0x030c30c3u;
-  z &= 0x030c30c3u;
-  x |= (x >> 4u);
-  y |= (y >> 4u);
-  z |= (z >> 4u);
-  x &= 0x0300f00fu;
-  y &= 0x0300f00fu;
-  z &= 0x0300f00fu;
-  x |= (x >> 8u);
-  y |= (y >> 8u);
-  z |= (z >> 8u);
-  x &= 0x030000ffu;
-  y &= 0x030000ffu;
-  z &= 0x030000ffu;
-  x |= (x >> 16u);
-  y |= (y >> 16u);
-  z |= (z >> 16u);
-  x &= 0x000003ffu;
-  y &= 0x000003ffu;
-  z &= 0x000003ffu;
+#if VOX_MORTON_HAS_BMI2
+  if (vox::morton::ActiveCodec == morton::ECodec::BMI2)
+  {
+    vox::morton::DecodeBMI2(morton, x, y, z);
+    return;
+  }
+#endif
+  vox::morton::DecodeMagicBits(morton, x, y, z);
+}
+
+using MortonKey   = uint32_t;
+using MortonKey64 = uint64_t;
+
+/// Key width dependent constants and codec entry points. MortonKey covers 1024^3 voxels with
+/// 10 bits per axis, MortonKey64 covers 2^21 per axis in 63 bits.
+template <class TKey> struct MortonTraits;
+
+template <> struct MortonTraits<MortonKey>
+{
+  static constexpr uint32_t  BitsPerAxis   = 10;
+  static constexpr uint32_t  MaxCoordinate = (1u << BitsPerAxis) - 1;
+  static constexpr MortonKey MaxKey        = MaxMortonKey;
+  static constexpr MortonKey MaskX         = morton::MaskX;
+  static constexpr MortonKey MaskY         = morton::MaskY;
+  static constexpr MortonKey MaskZ         = morton::MaskZ;
+
+  static MortonKey Encode(uint32_t x, uint32_t y, uint32_t z)
+  {
+    return encodeMK(x, y, z);
+  }
+
+  static void Decode(MortonKey key, uint32_t& x, uint32_t& y, uint32_t& z)
+  {
+    decodeMK(key, x, y, z);
+  }
+};
+
+template <> struct MortonTraits<MortonKey64>
+{
+  static constexpr uint32_t    BitsPerAxis   = 21;
+  static constexpr uint32_t    MaxCoordinate = (1u << BitsPerAxis) - 1;
+  static constexpr MortonKey64 MaxKey        = 1ull << (3 * BitsPerAxis);
+  static constexpr MortonKey64 MaskX         = morton::MaskX64;
+  static constexpr MortonKey64 MaskY         = morton::MaskY64;
+  static constexpr MortonKey64 MaskZ         = morton::MaskZ64;
+
+  static MortonKey64 Encode(uint32_t x, uint32_t y, uint32_t z)
+  {
+#if VOX_MORTON_HAS_BMI2 && defined(__x86_64__)
+    if (morton::ActiveCodec == morton::ECodec::BMI2)
+      return morton::EncodeBMI2_64(x, y, z);
+#endif
+    return morton::EncodeMagicBits64(x, y, z);
+  }
+
+  static void Decode(MortonKey64 key, uint32_t& x, uint32_t& y, uint32_t& z)
+  {
+#if VOX_MORTON_HAS_BMI2 && defined(__x86_64__)
+    if (morton::ActiveCodec == morton::ECodec::BMI2)
+    {
+      morton::DecodeBMI2_64(key, x, y, z);
+      return;
+    }
+#endif
+    morton::DecodeMagicBits64(key, x, y, z);
+  }
+};
+
+/// Neighbor arithmetic on interleaved keys. Each axis is treated as a dilated integer, so
+/// stepping along one axis carries only through that axis' bits and never needs a decode.
+/// Steps wrap around at the edges of the key space; use the MortonIsMin/MortonIsMax checks first.
+template <class TKey> inline TKey MortonAddX(TKey key)
+{
+  constexpr TKey M = MortonTraits<TKey>::MaskX;
+  return (((key | ~M) + TKey(1)) & M) | (key & ~M);
+}
+
+template <class TKey> inline TKey MortonAddY(TKey key)
+{
+  constexpr TKey M = MortonTraits<TKey>::MaskY;
+  return (((key | ~M) + TKey(2)) & M) | (key & ~M);
+}
+
+template <class TKey> inline TKey MortonAddZ(TKey key)
+{
+  constexpr TKey M = MortonTraits<TKey>::MaskZ;
+  return (((key | ~M) + TKey(4)) & M) | (key & ~M);
+}
+
+template <class TKey> inline TKey MortonSubX(TKey key)
+{
+  constexpr TKey M = MortonTraits<TKey>::MaskX;
+  return (((key & M) - TKey(1)) & M) | (key & ~M);
+}
+
+template <class TKey> inline TKey MortonSubY(TKey key)
+{
+  constexpr TKey M = MortonTraits<TKey>::MaskY;
+  return (((key & M) - TKey(2)) & M) | (key & ~M);
+}
+
+template <class TKey> inline TKey MortonSubZ(TKey key)
+{
+  constexpr TKey M = MortonTraits<TKey>::MaskZ;
+  return (((key & M) - TKey(4)) & M) | (key & ~M);
+}
+
+/// Adds two keys component-wise, e.g. a key and encodeMK(dx, dy, dz).
+template <class TKey> inline TKey MortonAdd(TKey a, TKey b)
+{
+  using Traits = MortonTraits<TKey>;
+  const TKey x = ((a | ~Traits::MaskX) + (b & Traits::MaskX)) & Traits::MaskX;
+  const TKey y = ((a | ~Traits::MaskY) + (b & Traits::MaskY)) & Traits::MaskY;
+  const TKey z = ((a | ~Traits::MaskZ) + (b & Traits::MaskZ)) & Traits::MaskZ;
+  return x | y | z;
+}
+
+/// Subtracts two keys component-wise.
+template <class TKey> inline TKey MortonSub(TKey a, TKey b)
+{
+  using Traits = MortonTraits<TKey>;
+  const TKey x = ((a & Traits::MaskX) - (b & Traits::MaskX)) & Traits::MaskX;
+  const TKey y = ((a & Traits::MaskY) - (b & Traits::MaskY)) & Traits::MaskY;
+  const TKey z = ((a & Traits::MaskZ) - (b & Traits::MaskZ)) & Traits::MaskZ;
+  return x | y | z;
+}
+
+template <class TKey> inline bool MortonIsMinX(TKey key)
+{
+  return (key & MortonTraits<TKey>::MaskX) == 0;
+}
+
+template <class TKey> inline bool MortonIsMinY(TKey key)
+{
+  return (key & MortonTraits<TKey>::MaskY) == 0;
+}
+
+template <class TKey> inline bool MortonIsMinZ(TKey key)
+{
+  return (key & MortonTraits<TKey>::MaskZ) == 0;
+}
+
+template <class TKey> inline bool MortonIsMaxX(TKey key)
+{
+  return (key & MortonTraits<TKey>::MaskX) == MortonTraits<TKey>::MaskX;
+}
+
+template <class TKey> inline bool MortonIsMaxY(TKey key)
+{
+  return (key & MortonTraits<TKey>::MaskY) == MortonTraits<TKey>::MaskY;
+}
+
+template <class TKey> inline bool MortonIsMaxZ(TKey key)
+{
+  return (key & MortonTraits<TKey>::MaskZ) == MortonTraits<TKey>::MaskZ;
+}
+
+/// Face neighbor order used by MortonFaceNeighbors.
+enum EMortonFace : uint8_t
+{
+  PositiveX = 0,
+  NegativeX,
+  PositiveY,
+  NegativeY,
+  PositiveZ,
+  NegativeZ,
+  FaceCount
+};
+
+/// Writes the six face neighbors of key in EMortonFace order. Returns a bit mask with bit
+/// EMortonFace set for every neighbor that lies inside the key space.
+template <class TKey> inline uint8_t MortonFaceNeighbors(TKey key, TKey neighbors[FaceCount])
+{
+  neighbors[PositiveX] = MortonAddX(key);
+  neighbors[NegativeX] = MortonSubX(key);
+  neighbors[PositiveY] = MortonAddY(key);
+  neighbors[NegativeY] = MortonSubY(key);
+  neighbors[PositiveZ] = MortonAddZ(key);
+  neighbors[NegativeZ] = MortonSubZ(key);
+
+  return (MortonIsMaxX(key) ? 0 : 1u << PositiveX) | (MortonIsMinX(key) ? 0 : 1u << NegativeX) |
+         (MortonIsMaxY(key) ? 0 : 1u << PositiveY) | (MortonIsMinY(key) ? 0 : 1u << NegativeY) |
+         (MortonIsMaxZ(key) ? 0 : 1u << PositiveZ) | (MortonIsMinZ(key) ? 0 : 1u << NegativeZ);
+}
+
+/// Calls func(neighborKey, dx, dy, dz) for each of the up to 26 neighbors of key that lie
+/// inside the key space. Rows are produced by stepping, so no neighbor is encoded from scratch.
+template <class TKey, class TFunc> void ForEachMortonNeighbor26(TKey key, TFunc&& func)
+{
+  const bool hasLow[3]  = { !MortonIsMinX(key), !MortonIsMinY(key), !MortonIsMinZ(key) };
+  const bool hasHigh[3] = { !MortonIsMaxX(key), !MortonIsMaxY(key), !MortonIsMaxZ(key) };
+
+  TKey zKey = MortonSubZ(key);
+  for (int32_t dz = -1; dz <= 1; dz++, zKey = MortonAddZ(zKey))
+  {
+    if ((dz < 0 && !hasLow[2]) || (dz > 0 && !hasHigh[2]))
+      continue;
+
+    TKey yKey = MortonSubY(zKey);
+    for (int32_t dy = -1; dy <= 1; dy++, yKey = MortonAddY(yKey))
+    {
+      if ((dy < 0 && !hasLow[1]) || (dy > 0 && !hasHigh[1]))
+        continue;
+
+      TKey xKey = MortonSubX(yKey);
+      for (int32_t dx = -1; dx <= 1; dx++, xKey = MortonAddX(xKey))
+      {
+        if ((dx < 0 && !hasLow[0]) || (dx > 0 && !hasHigh[0]) || (dx | dy | dz) == 0)
+          continue;
+
+        func(xKey, dx, dy, dz);
+      }
+    }
+  }
 }
 
 }
@@ -0,0 +1,19 @@
+#ifndef THEPROJECT2_INCLUDE_VOXEL_MORTONBATCH_H_
+#define THEPROJECT2_INCLUDE_VOXEL_MORTONBATCH_H_
+
+#include "Morton.h"
+
+namespace vox::morton {
+/// Batched codec kernels. They process 8 keys per step with AVX2 when the CPU has it and 4 per
+/// step with SSE otherwise, and produce the same keys as encodeMK/decodeMK.
+void EncodeMany(const uint32_t* x, const uint32_t* y, const uint32_t* z, uint32_t* keys,
+                size_t count);
+void DecodeMany(const uint32_t* keys, uint32_t* x, uint32_t* y, uint32_t* z, size_t count);
+
+/// Decodes `count` consecutive keys starting at firstKey, without materializing the keys.
+void DecodeRange(uint32_t firstKey, uint32_t* x, uint32_t* y, uint32_t* z, size_t count);
+
+bool IsAVX2Enabled();
+} // namespace vox::morton
+
+#endif // THEPROJECT2_INCLUDE_VOXEL_MORTONBATCH_H_
@@ -0,0 +1,206 @@
+#ifndef THEPROJECT2_INCLUDE_VOXEL_MORTONOCCUPANCY_H_
+#define THEPROJECT2_INCLUDE_VOXEL_MORTONOCCUPANCY_H_
+
+#include "Morton.h"
+
+/// Pointerless sparse voxel octree over the sorted node spans of a storage. A cell of level L is
+/// the aligned block of 8^L keys sharing key >> 3L; level 0 cells are voxels. Every partially
+/// covered cell stores which of its 8 children hold voxels and which are completely full. Only
+/// partial children get a node of their own, stored level by level in Morton order, so a child
+/// is found with one popcount and descending to any cell is O(depth).
+namespace vox {
+template <class TKey> class MortonOccupancy
+{
+  public:
+  static constexpr uint32_t Depth = MortonTraits<TKey>::BitsPerAxis;
+
+  enum class EState : uint8_t
+  {
+    Empty,
+    Partial,
+    Full
+  };
+
+  /// Handle used to walk down the tree, node indexes m_levels[level] when the cell is partial.
+  struct Cell
+  {
+    uint32_t level;
+    uint32_t node;
+    EState   state;
+  };
+
+  /// Builds the tree from a sorted storage providing size(), Key(i) and Size(i).
+  template <class TStorage> void Build(const TStorage& nodes);
+
+  Cell Root() const;
+  /// Child cell at Morton child index `child`, bit 0 is x, bit 1 is y and bit 2 is z.
+  Cell Child(const Cell& cell, uint32_t child) const;
+  /// State of the level cell containing key.
+  EState GetState(uint32_t level, TKey key) const;
+  /// True when any voxel lies inside the inclusive voxel box [min, max].
+  bool AnyInBox(const glm::uvec3& min, const glm::uvec3& max) const;
+
+  private:
+  struct Node
+  {
+    uint32_t firstChild;
+    uint8_t  childMask;
+    uint8_t  fullMask;
+  };
+
+  bool AnyInBox(const Cell& cell, const glm::uvec3& origin, const glm::uvec3& min,
+                const glm::uvec3& max) const;
+
+  core::Vector<core::Vector<Node>> m_levels;
+  EState                           m_rootState = EState::Empty;
+};
+
+template <class TKey>
+template <class TStorage>
+void MortonOccupancy<TKey>::Build(const TStorage& nodes)
+{
+  using StorageNode = typename TStorage::Node;
+
+  // One past the last key of node i, tombstones cover nothing.
+  auto spanEnd = [&nodes](size_t i) {
+    const uint32_t size = nodes.Size(i);
+    return nodes.Key(i) + TKey(size == StorageNode::TombstoneSize ? 0 : size);
+  };
+
+  // Pending partial cell and the nodes overlapping it, [first, last).
+  struct Pending
+  {
+    TKey   start;
+    size_t first, last;
+  };
+
+  m_levels.assign(Depth + 1, {});
+  m_rootState = EState::Empty;
+
+  TKey covered = 0;
+  for (size_t i = 0; i < nodes.size(); i++)
+    covered += spanEnd(i) - nodes.Key(i);
+  if (covered == 0)
+    return;
+
+  // MaxKey is the number of keys, 8^Depth.
+  m_rootState = covered == MortonTraits<TKey>::MaxKey ? EState::Full : EState::Partial;
+  if (m_rootState == EState::Full)
+    return;
+
+  core::Vector<Pending> cells{ { 0, 0, nodes.size() } }, children;
+  for (uint32_t level = Depth; level > 0 && !cells.empty(); level--)
+  {
+    const TKey childSize = TKey(1) << (3 * (level - 1));
+    auto&      out       = m_levels[level];
+    out.reserve(cells.size());
+    children.clear();
+
+    for (const Pending& cell : cells)
+    {
+      Node   node{ uint32_t(children.size()), 0, 0 };
+      size_t i = cell.first;
+
+      for (uint32_t child = 0; child < 8; child++)
+      {
+        const TKey childStart = cell.start + TKey(child) * childSize;
+        const TKey childEnd   = childStart + childSize;
+
+        while (i < cell.last && spanEnd(i) <= childStart)
+          i++;
+
+        // The last node may continue into the next child, so i stays on it.
+        TKey   childCovered = 0;
+        size_t j            = i;
+        for (; j < cell.last && nodes.Key(j) < childEnd; j++)
+        {
+          const TKey end = spanEnd(j);
+          if (end > childStart)
+            childCovered += std::min(end, childEnd) - std::max(nodes.Key(j), childStart);
+        }
+
+        if (childCovered == 0)
+          continue;
+
+        node.childMask |= uint8_t(1u << child);
+        if (childCovered == childSize)
+          node.fullMask |= uint8_t(1u << child);
+        else
+          children.push_back({ childStart, i, j });
+      }
+      out.push_back(node);
+    }
+    cells.swap(children);
+  }
+}
+
+template <class TKey> typename MortonOccupancy<TKey>::Cell MortonOccupancy<TKey>::Root() const
+{
+  return { Depth, 0, m_rootState };
+}
+
+template <class TKey>
+typename MortonOccupancy<TKey>::Cell MortonOccupancy<TKey>::Child(const Cell& cell,
+                                                                  uint32_t    child) const
+{
+  if (cell.state != EState::Partial)
+    return { cell.level - 1, 0, cell.state };
+
+  const Node&   node = m_levels[cell.level][cell.node];
+  const uint8_t bit  = uint8_t(1u << child);
+  if (!(node.childMask & bit))
+    return { cell.level - 1, 0, EState::Empty };
+  if (node.fullMask & bit)
+    return { cell.level - 1, 0, EState::Full };
+
+  const uint32_t partialBefore = node.childMask & ~node.fullMask & (bit - 1u);
+  return { cell.level - 1, node.firstChild + uint32_t(__builtin_popcount(partialBefore)),
+           EState::Partial };
+}
+
+template <class TKey>
+typename MortonOccupancy<TKey>::EState MortonOccupancy<TKey>::GetState(uint32_t level,
+                                                                       TKey     key) const
+{
+  Cell cell = Root();
+  while (cell.level > level && cell.state == EState::Partial)
+    cell = Child(cell, uint32_t(key >> (3 * (cell.level - 1))) & 7u);
+  return cell.state;
+}
+
+template <class TKey>
+bool MortonOccupancy<TKey>::AnyInBox(const glm::uvec3& min, const glm::uvec3& max) const
+{
+  return AnyInBox(Root(), glm::uvec3(0), min, max);
+}
+
+template <class TKey>
+bool MortonOccupancy<TKey>::AnyInBox(const Cell& cell, const glm::uvec3& origin,
+                                     const glm::uvec3& min, const glm::uvec3& max) const
+{
+  if (cell.state == EState::Empty)
+    return false;
+
+  const uint32_t last = (1u << cell.level) - 1;
+  for (uint32_t axis = 0; axis < 3; axis++)
+  {
+    if (origin[axis] > max[axis] || origin[axis] + last < min[axis])
+      return false;
+  }
+  if (cell.state == EState::Full)
+    return true;
+
+  const uint32_t half = 1u << (cell.level - 1);
+  for (uint32_t child = 0; child < 8; child++)
+  {
+    const glm::uvec3 childOrigin = origin + glm::uvec3((child & 1) ? half : 0,
+                                                       (child & 2) ? half : 0,
+                                                       (child & 4) ? half : 0);
+    if (AnyInBox(Child(cell, child), childOrigin, min, max))
+      return true;
+  }
+  return false;
+}
+} // namespace vox
+
+#endif // THEPROJECT2_INCLUDE_VOXEL_MORTONOCCUPANCY_H_
@@ -1,8 +1,14 @@
 #ifndef MortonOctree_H
 #define	MortonOctree_H
 
+#include "ChunkOccupancy.h"
+#include "MortonOccupancy.h"
+#include "MortonRange.h"
+#include "MortonSearchIndex.h"
+#include "NodeStorage.h"
 #include "OctreeConstants.h"
 #include "VoxNode.h"
+#include "VoxelFwd.h"
 #include "VoxelSide.h"
 
 namespace gameworld{
@@ -10,26 +16,142 @@ class WorldGenerator;
 }
 
 namespace vox {
-class MortonOctree {
+/// Sorted leaf nodes in Morton order. TStorage picks the node layout, see NodeStorage.h.
+/// A node covers the `size` consecutive keys starting at its key; spans never overlap, edits
+/// inside a span split it.
+template <class TKey, class TStorage> class BasicMortonOctree {
 public:
-  void AddNode(VoxNode node);
-  void AddOrphanNode(VoxNode node);
+  using KeyType      = TKey;
+  using Node         = BasicVoxNode<TKey>;
+  using Storage      = TStorage;
+  using NodeIterator = typename TStorage::iterator;
+
+  enum class EEditType : uint8_t { Add, Remove };
+
+  /// Nodes of one 32^3 chunk: [begin, end) in GetNodes(), tombstones included.
+  struct ChunkRange {
+    size_t begin, end;
+    uint32_t liveCount;
+  };
+
+  struct Edit {
+    Node node;
+    EEditType type;
+  };
+
+  /// Edits applied together by ApplyEdits. When a key is edited more than once, the last edit wins.
+  /// Added spans must not overlap each other.
+  struct EditBatch {
+    core::Vector<Edit> Edits;
+
+    void Add(Node node) { Edits.push_back({core::Move(node), EEditType::Add}); }
+    void Remove(uint32_t x, uint32_t y, uint32_t z) {
+      Edits.push_back({Node(MortonTraits<TKey>::Encode(x, y, z)), EEditType::Remove});
+    }
+  };
+
+  /// Replaces whatever the node's span covers, nodes inside it become tombstones.
+  void AddNode(Node node);
+  /// Sorts the batch and merges it in one linear pass, O(n + k log k) for k edits.
+  void AddNodes(core::Vector<Node> nodes);
+  void ApplyEdits(EditBatch batch);
+  void AddOrphanNode(Node node);
   bool IsSorted();
   void SortLeafNodes();
+  /// Keeps the most recently added node of each key.
   void RemoveDuplicateNodes();
+  /// Drops removed nodes from the vector. Invalidates node iterators.
+  void Compact();
+  /// Compacts once more than 1/TombstoneCompactionRatio of the nodes are tombstones.
+  bool CompactIfNeeded();
+  size_t GetTombstoneCount() const;
+  /// Point lookups go through a static B-tree over the keys. The index is rebuilt lazily once
+  /// enough lookups happened since the last edit to pay for the rebuild.
+  void EnableSearchIndex(bool enable);
+  /// Chunk directory: begin/end offsets and live node counts per CHUNK_MASK bucket, so a chunk's
+  /// range is found in constant time. Built on first use, which sorts the nodes, then kept up to
+  /// date by AddNode and RemoveNode; other edits rebuild it on next use. It spans every bucket up
+  /// to the highest key, so use it on octrees with superchunk local keys.
+  size_t GetChunkCount();
+  ChunkRange GetChunkRange(size_t chunk);
   bool CheckNodeFloat(float x, float y, float z);
   bool CheckNode(uint32_t x, uint32_t y, uint32_t z);
-  uint8_t GetVisibleSides(uint32_t x, uint32_t y, uint32_t z,
-                          core::Vector<VoxNode>::iterator nodeIt);
-  core::Vector<VoxNode> &GetNodes();
+  bool CheckNode(TKey mortonKey);
+  /// Sides of the voxel whose neighbor is empty, read from the chunk occupancy. The iterator is
+  /// no longer needed and only kept for existing callers.
+  uint8_t GetVisibleSides(uint32_t x, uint32_t y, uint32_t z, NodeIterator nodeIt);
+  TStorage &GetNodes();
+
+  /// Calls func(node) for each node inside the inclusive voxel box [min, max] until it returns
+  /// false. Returns the number of nodes examined.
+  template <class TFunc>
+  uint32_t ForEachNodeInBox(const glm::uvec3 &min, const glm::uvec3 &max, TFunc &&func);
+  /// Answered by the occupancy tree, so empty space is skipped a whole cell at a time.
+  bool AnyNodeInBox(const glm::uvec3 &min, const glm::uvec3 &max);
+  /// Per-level occupancy of the octree cells. Rebuilt on first use after an edit, which also sorts
+  /// the nodes.
+  const MortonOccupancy<TKey> &GetOccupancy();
+  /// Solid cells of one CHUNK_MASK bucket, nullptr when it never held a voxel. All chunks are
+  /// built on first use, then AddNode and RemoveNode update single bits; other edits rebuild them
+  /// on next use.
+  const ChunkOccupancy *GetChunkOccupancy(size_t chunk);
 
   bool RemoveNode(uint32_t x, uint32_t y, uint32_t z);
 
 private:
-  core::Vector<VoxNode> m_nodes;
-  void Remove(VoxNode node);
+  TStorage m_nodes;
+  /// Length of the sorted prefix of m_nodes, orphan nodes are appended after it.
+  size_t m_sortedCount = 0;
+  size_t m_tombstoneCount = 0;
+  static constexpr size_t TombstoneCompactionRatio = 8;
+
+  MortonSearchIndex<TKey> m_searchIndex;
+  bool m_searchIndexEnabled = false;
+  bool m_searchIndexDirty = true;
+  size_t m_lookupsSinceEdit = 0;
+  static constexpr size_t SearchIndexRebuildRatio = 16;
+
+  /// m_chunkOffsets[c] is the first node of chunk c, the extra last entry is the node count.
+  core::Vector<size_t> m_chunkOffsets;
+  core::Vector<uint32_t> m_chunkLiveCounts;
+  bool m_chunkDirectoryDirty = true;
+
+  MortonOccupancy<TKey> m_occupancy;
+  bool m_occupancyDirty = true;
+
+  core::UnorderedMap<size_t, ChunkOccupancy> m_chunkOccupancy;
+  bool m_chunkOccupancyDirty = true;
+
+  void InvalidateSearchIndex();
+  void InvalidateChunkDirectory();
+  void UpdateChunkDirectory();
+  /// Records one more live node in chunk, the first offsets of chunks (chunk, lastShifted] move up.
+  void InsertIntoChunkDirectory(size_t chunk, size_t lastShifted);
+  size_t LowerBound(size_t first, size_t last, TKey key);
+  bool IsTombstoneAt(size_t i) const;
+  bool SpanContains(size_t i, TKey key) const;
+  /// Index of the node in [first, last) starting at key or whose span contains it, else last.
+  size_t FindNode(size_t first, size_t last, TKey key);
+  /// Splits the live span containing key so that a node starts at key.
+  void SplitSpanAt(TKey key);
+  /// SplitSpanAt for every key of the sorted cuts, in one pass over the nodes.
+  void SplitSpans(const core::Vector<TKey> &cuts);
+  void MarkRemoved(size_t i);
+  /// Sets or clears the chunk occupancy bits of the keys [start, start + size).
+  void UpdateChunkOccupancy(TKey start, uint32_t size, bool solid);
+  void Remove(Node node);
   friend class gameworld::WorldGenerator;
 };
+
+template <class TKey, class TStorage>
+template <class TFunc>
+uint32_t BasicMortonOctree<TKey, TStorage>::ForEachNodeInBox(const glm::uvec3 &min,
+                                                             const glm::uvec3 &max, TFunc &&func) {
+  const TKey minKey = MortonTraits<TKey>::Encode(min.x, min.y, min.z);
+  const TKey maxKey = MortonTraits<TKey>::Encode(max.x, max.y, max.z);
+  return ForEachInMortonBox(m_nodes, minKey, maxKey,
+                            [&](size_t i) { return IsTombstoneAt(i) || func(m_nodes[i]); });
+}
 }
 
 #endif	/* MortonOctree_H */
@@ -0,0 +1,210 @@
+#ifndef THEPROJECT2_INCLUDE_VOXEL_MORTONRANGE_H_
+#define THEPROJECT2_INCLUDE_VOXEL_MORTONRANGE_H_
+
+#include "Morton.h"
+
+/// Box queries in Morton space. A box [minKey, maxKey] covers a single key span, but most keys in
+/// that span lie outside the box. These helpers either split the box into the contiguous key
+/// intervals it actually covers, or jump over the gaps with BIGMIN (Tropf and Herzog, 1981).
+namespace vox {
+/// Inclusive key interval [first, last].
+template <class TKey> struct MortonInterval
+{
+  TKey first, last;
+};
+
+/// Component-wise comparison of a key against the box spanned by minKey and maxKey.
+template <class TKey> inline bool MortonInBox(TKey key, TKey minKey, TKey maxKey)
+{
+  using Traits = MortonTraits<TKey>;
+  for (TKey mask : { Traits::MaskX, Traits::MaskY, Traits::MaskZ })
+  {
+    if ((key & mask) < (minKey & mask) || (key & mask) > (maxKey & mask))
+      return false;
+  }
+  return true;
+}
+
+namespace morton {
+/// Mask of the bits below `bit` that belong to the same axis.
+template <class TKey> inline TKey LowerAxisBits(uint32_t bit)
+{
+  using Traits          = MortonTraits<TKey>;
+  const TKey axisMasks[] = { Traits::MaskX, Traits::MaskY, Traits::MaskZ };
+  return axisMasks[bit % 3] & ((TKey(1) << bit) - 1);
+}
+
+/// Sets `bit` and clears the lower bits of its axis ("1000..." in the paper).
+template <class TKey> inline TKey LoadMin(TKey value, uint32_t bit)
+{
+  return (value | (TKey(1) << bit)) & ~LowerAxisBits<TKey>(bit);
+}
+
+/// Clears `bit` and sets the lower bits of its axis ("0111...").
+template <class TKey> inline TKey LoadMax(TKey value, uint32_t bit)
+{
+  return (value & ~(TKey(1) << bit)) | LowerAxisBits<TKey>(bit);
+}
+} // namespace morton
+
+/// Smallest key greater than `key` that lies inside the box. `key` must be inside
+/// [minKey, maxKey] but outside the box.
+template <class TKey> inline TKey MortonBigMin(TKey key, TKey minKey, TKey maxKey)
+{
+  TKey bigMin = maxKey;
+
+  for (int32_t bit = 3 * MortonTraits<TKey>::BitsPerAxis - 1; bit >= 0; bit--)
+  {
+    const TKey mask = TKey(1) << bit;
+    const int  code = ((key & mask) ? 4 : 0) | ((minKey & mask) ? 2 : 0) | ((maxKey & mask) ? 1 : 0);
+
+    switch (code)
+    {
+    case 0b001:
+      bigMin = morton::LoadMin(minKey, bit);
+      maxKey = morton::LoadMax(maxKey, bit);
+      break;
+    case 0b011:
+      return minKey;
+    case 0b100:
+      return bigMin;
+    case 0b101:
+      minKey = morton::LoadMin(minKey, bit);
+      break;
+    default:
+      break;
+    }
+  }
+  return bigMin;
+}
+
+/// Largest key smaller than `key` that lies inside the box, with the same preconditions as
+/// MortonBigMin.
+template <class TKey> inline TKey MortonLitMax(TKey key, TKey minKey, TKey maxKey)
+{
+  TKey litMax = minKey;
+
+  for (int32_t bit = 3 * MortonTraits<TKey>::BitsPerAxis - 1; bit >= 0; bit--)
+  {
+    const TKey mask = TKey(1) << bit;
+    const int  code = ((key & mask) ? 4 : 0) | ((minKey & mask) ? 2 : 0) | ((maxKey & mask) ? 1 : 0);
+
+    switch (code)
+    {
+    case 0b001:
+      maxKey = morton::LoadMax(maxKey, bit);
+      break;
+    case 0b011:
+      return litMax;
+    case 0b100:
+      return maxKey;
+    case 0b101:
+      litMax = morton::LoadMax(maxKey, bit);
+      minKey = morton::LoadMin(minKey, bit);
+      break;
+    default:
+      break;
+    }
+  }
+  return litMax;
+}
+
+namespace morton {
+template <class TKey>
+void AppendBoxIntervals(TKey cellStart, const uint32_t cell[3], uint32_t level, const uint32_t min[3],
+                        const uint32_t max[3], core::Vector<MortonInterval<TKey>>& intervals)
+{
+  const uint32_t size   = 1u << level;
+  bool           inside = true;
+
+  for (uint32_t axis = 0; axis < 3; axis++)
+  {
+    const uint32_t cellMax = cell[axis] + (size - 1);
+    if (cellMax < min[axis] || cell[axis] > max[axis])
+      return;
+    inside = inside && cell[axis] >= min[axis] && cellMax <= max[axis];
+  }
+
+  if (inside)
+  {
+    const TKey last = cellStart + ((TKey(1) << (3 * level)) - 1);
+    if (!intervals.empty() && intervals.back().last + 1 == cellStart)
+      intervals.back().last = last;
+    else
+      intervals.push_back({ cellStart, last });
+    return;
+  }
+
+  const uint32_t half = size >> 1;
+  for (uint32_t child = 0; child < 8; child++)
+  {
+    const uint32_t childCell[3] = { cell[0] + ((child & 1) ? half : 0),
+                                    cell[1] + ((child & 2) ? half : 0),
+                                    cell[2] + ((child & 4) ? half : 0) };
+    AppendBoxIntervals(cellStart + (TKey(child) << (3 * (level - 1))), childCell, level - 1, min,
+                       max, intervals);
+  }
+}
+} // namespace morton
+
+/// Splits the inclusive box [min, max] into the minimal sorted set of contiguous key intervals.
+/// The number of intervals grows with the box surface, prefer ForEachInMortonBox for large boxes.
+template <class TKey>
+void MortonBoxIntervals(const uint32_t min[3], const uint32_t max[3],
+                        core::Vector<MortonInterval<TKey>>& intervals)
+{
+  const uint32_t root[3] = { 0, 0, 0 };
+  morton::AppendBoxIntervals<TKey>(0, root, MortonTraits<TKey>::BitsPerAxis, min, max, intervals);
+}
+
+/// Calls func(index) for every node of a sorted node storage whose key span reaches into the box
+/// [minKey, maxKey]. Keys outside the box are skipped with a BIGMIN jump and a binary search, so
+/// only the key and size arrays are read. Iteration stops when func returns false. Returns the
+/// number of nodes examined.
+template <class TKey, class TStorage, class TFunc>
+uint32_t ForEachInMortonBox(const TStorage& nodes, TKey minKey, TKey maxKey, TFunc&& func)
+{
+  using Node         = typename TStorage::Node;
+  const size_t count = nodes.size();
+
+  // Last key covered by node i, tombstones only cover their own key.
+  auto spanLast = [&nodes](size_t i) {
+    const uint32_t size = nodes.Size(i);
+    return nodes.Key(i) + TKey(size == Node::TombstoneSize || size == 0 ? 0 : size - 1);
+  };
+  // First node at or after `first` whose span reaches key.
+  auto seek = [&](size_t first, TKey key) {
+    const size_t i = nodes.LowerBound(first, count, key);
+    return i > first && spanLast(i - 1) >= key ? i - 1 : i;
+  };
+
+  size_t   i        = seek(0, minKey);
+  uint32_t examined = 0;
+  while (i < count && nodes.Key(i) <= maxKey)
+  {
+    examined++;
+    const TKey key = nodes.Key(i);
+
+    // First key of the box at or after the node start, only the first node can start below it.
+    TKey inside = key;
+    if (key < minKey)
+      inside = minKey;
+    else if (!MortonInBox(key, minKey, maxKey))
+      inside = MortonBigMin(key, minKey, maxKey);
+
+    if (inside <= spanLast(i))
+    {
+      if (!func(i))
+        break;
+      i++;
+    }
+    else
+    {
+      i = seek(i + 1, inside);
+    }
+  }
+  return examined;
+}
+} // namespace vox
+
+#endif // THEPROJECT2_INCLUDE_VOXEL_MORTONRANGE_H_
@@ -0,0 +1,128 @@
+#ifndef THEPROJECT2_INCLUDE_VOXEL_MORTONSEARCHINDEX_H_
+#define THEPROJECT2_INCLUDE_VOXEL_MORTONSEARCHINDEX_H_
+
+#include "Morton.h"
+
+/// Read-only search index over the sorted keys of a node storage, laid out as a static B+ tree.
+/// Leaves are the keys in sorted order, 16 per cache line for 32-bit keys; every internal block
+/// holds the first key of 16 of its 17 children. A lookup costs one cache miss per level,
+/// log17(n) in total, instead of one per level of a binary search, and the leaf slot it ends in
+/// is the node index directly.
+namespace vox {
+template <class TKey> class MortonSearchIndex
+{
+  public:
+  static constexpr uint32_t BlockSize = 16;
+
+  /// Builds the index from a sorted storage providing size() and Key(i).
+  template <class TStorage> void Build(const TStorage& nodes);
+  void                           Clear();
+
+  /// Index of the first node whose key is not less than key, or the node count.
+  size_t LowerBound(TKey key) const;
+
+  private:
+  struct alignas(64) Block
+  {
+    TKey Keys[BlockSize];
+  };
+
+  /// Padding for unused slots, larger than any valid key.
+  static constexpr TKey PaddingKey = std::is_same<TKey, uint32_t>::value ? TKey(0x7fffffff) : ~TKey(0);
+
+  /// Number of keys in the block smaller than key.
+  static uint32_t Rank(const Block& block, TKey key);
+
+  /// Blocks of all layers, leaves first. m_layerOffsets[h] is the first block of layer h.
+  core::Vector<Block>  m_blocks;
+  core::Vector<size_t> m_layerOffsets;
+  size_t               m_count = 0;
+};
+
+template <class TKey>
+template <class TStorage>
+void MortonSearchIndex<TKey>::Build(const TStorage& nodes)
+{
+  Clear();
+  m_count = nodes.size();
+  if (m_count == 0)
+    return;
+
+  core::Vector<size_t> layerSizes{ (m_count + BlockSize - 1) / BlockSize };
+  while (layerSizes.back() > 1)
+    layerSizes.push_back((layerSizes.back() + BlockSize) / (BlockSize + 1));
+
+  size_t total = 0;
+  for (size_t size : layerSizes)
+  {
+    m_layerOffsets.push_back(total);
+    total += size;
+  }
+  m_blocks.resize(total);
+
+  for (size_t i = 0; i < layerSizes[0] * BlockSize; i++)
+    m_blocks[i / BlockSize].Keys[i % BlockSize] = i < m_count ? nodes.Key(i) : PaddingKey;
+
+  // Separator i of a block is the first key of child i + 1, i.e. of its leftmost leaf.
+  size_t leavesPerChild = 1;
+  for (size_t layer = 1; layer < layerSizes.size(); layer++)
+  {
+    for (size_t block = 0; block < layerSizes[layer]; block++)
+    {
+      for (uint32_t slot = 0; slot < BlockSize; slot++)
+      {
+        const size_t key = (block * (BlockSize + 1) + slot + 1) * leavesPerChild * BlockSize;
+        m_blocks[m_layerOffsets[layer] + block].Keys[slot] = key < m_count ? nodes.Key(key) : PaddingKey;
+      }
+    }
+    leavesPerChild *= BlockSize + 1;
+  }
+}
+
+template <class TKey> void MortonSearchIndex<TKey>::Clear()
+{
+  m_blocks.clear();
+  m_layerOffsets.clear();
+  m_count = 0;
+}
+
+template <class TKey> size_t MortonSearchIndex<TKey>::LowerBound(TKey key) const
+{
+  if (m_count == 0)
+    return 0;
+
+  size_t block = 0;
+  for (size_t layer = m_layerOffsets.size() - 1; layer > 0; layer--)
+    block = block * (BlockSize + 1) + Rank(m_blocks[m_layerOffsets[layer] + block], key);
+
+  // A rank of BlockSize points at the first key of the next leaf, which is still correct.
+  return std::min(block * BlockSize + Rank(m_blocks[block], key), m_count);
+}
+
+#if defined(__SSE2__)
+/// Keys stay below 2^30, so signed compares are safe.
+template <> inline uint32_t MortonSearchIndex<uint32_t>::Rank(const Block& block, uint32_t key)
+{
+  const __m128i needle = _mm_set1_epi32(int32_t(key));
+  const auto*   keys   = reinterpret_cast<const __m128i*>(block.Keys);
+
+  uint32_t mask = 0;
+  for (uint32_t i = 0; i < BlockSize / 4; i++)
+  {
+    const __m128i less = _mm_cmpgt_epi32(needle, _mm_load_si128(keys + i));
+    mask |= uint32_t(_mm_movemask_ps(_mm_castsi128_ps(less))) << (4 * i);
+  }
+  return uint32_t(__builtin_popcount(mask));
+}
+#endif
+
+template <class TKey> inline uint32_t MortonSearchIndex<TKey>::Rank(const Block& block, TKey key)
+{
+  uint32_t rank = 0;
+  for (uint32_t i = 0; i < BlockSize; i++)
+    rank += block.Keys[i] < key;
+  return rank;
+}
+} // namespace vox
+
+#endif // THEPROJECT2_INCLUDE_VOXEL_MORTONSEARCHINDEX_H_
@@ -0,0 +1,249 @@
+#ifndef THEPROJECT2_INCLUDE_VOXEL_NODESTORAGE_H_
+#define THEPROJECT2_INCLUDE_VOXEL_NODESTORAGE_H_
+
+#include "VoxNode.h"
+#include <iterator>
+#include <numeric>
+
+/// Node containers for MortonOctree. Both keep nodes sorted by key in the octree's sorted prefix
+/// and expose the same index based interface; the octree never touches the layout directly.
+namespace vox {
+/// Array of VoxNode structs, 12 bytes per node with 32-bit keys.
+template <class TKey> class AosNodeStorage
+{
+  public:
+  using KeyType        = TKey;
+  using Node           = BasicVoxNode<TKey>;
+  using iterator       = typename core::Vector<Node>::iterator;
+  using const_iterator = typename core::Vector<Node>::const_iterator;
+
+  size_t size() const { return m_nodes.size(); }
+  bool   empty() const { return m_nodes.empty(); }
+  void   reserve(size_t count) { m_nodes.reserve(count); }
+  void   clear() { m_nodes.clear(); }
+
+  iterator       begin() { return m_nodes.begin(); }
+  iterator       end() { return m_nodes.end(); }
+  const_iterator begin() const { return m_nodes.begin(); }
+  const_iterator end() const { return m_nodes.end(); }
+
+  Node&       operator[](size_t i) { return m_nodes[i]; }
+  const Node& operator[](size_t i) const { return m_nodes[i]; }
+
+  TKey     Key(size_t i) const { return m_nodes[i].start; }
+  uint32_t Size(size_t i) const { return m_nodes[i].size; }
+  Node     Get(size_t i) const { return m_nodes[i]; }
+  void     Set(size_t i, const Node& node) { m_nodes[i].Assign(node); }
+  void     SetSize(size_t i, uint32_t size) { m_nodes[i].size = size; }
+
+  /// First index in [first, last) whose key is not less than key.
+  size_t LowerBound(size_t first, size_t last, TKey key) const
+  {
+    auto it = std::lower_bound(m_nodes.begin() + first, m_nodes.begin() + last, key,
+                               [](const Node& node, TKey k) { return node.start < k; });
+    return size_t(it - m_nodes.begin());
+  }
+
+  void PushBack(Node node) { m_nodes.push_back(core::Move(node)); }
+  void Insert(size_t i, Node node) { m_nodes.insert(m_nodes.begin() + i, core::Move(node)); }
+  void Erase(size_t first, size_t last)
+  {
+    m_nodes.erase(m_nodes.begin() + first, m_nodes.begin() + last);
+  }
+  void Resize(size_t count) { m_nodes.resize(count); }
+  void MoveElement(size_t from, size_t to) { m_nodes[to] = core::Move(m_nodes[from]); }
+
+  /// Stable sorts [first, size()) by key and merges it into the sorted prefix [0, first).
+  void SortTail(size_t first)
+  {
+    auto byKey = [](const Node& a, const Node& b) { return a.start < b.start; };
+    auto tail  = m_nodes.begin() + first;
+    std::stable_sort(tail, m_nodes.end(), byKey);
+    std::inplace_merge(m_nodes.begin(), tail, m_nodes.end(), byKey);
+  }
+
+  private:
+  core::Vector<Node> m_nodes;
+};
+
+/// Parallel key, size and color arrays. Searches only touch the dense key array, so a cache line
+/// holds 16 32-bit keys instead of 5 nodes.
+template <class TKey> class SoaNodeStorage
+{
+  public:
+  using KeyType = TKey;
+  using Node    = BasicVoxNode<TKey>;
+
+  struct Color
+  {
+    uint8_t r, g, b;
+  };
+
+  /// Read only random access iterator, dereferencing assembles a Node by value.
+  class const_iterator
+  {
+    public:
+    using iterator_category = std::random_access_iterator_tag;
+    using value_type        = Node;
+    using difference_type   = std::ptrdiff_t;
+    using reference         = Node;
+
+    struct pointer
+    {
+      Node        node;
+      const Node* operator->() const { return &node; }
+    };
+
+    const_iterator() = default;
+    const_iterator(const SoaNodeStorage* storage, size_t index)
+        : m_storage(storage)
+        , m_index(index)
+    {
+    }
+
+    Node    operator*() const { return m_storage->Get(m_index); }
+    pointer operator->() const { return { m_storage->Get(m_index) }; }
+    Node    operator[](difference_type n) const { return m_storage->Get(m_index + n); }
+
+    const_iterator& operator++() { m_index++; return *this; }
+    const_iterator& operator--() { m_index--; return *this; }
+    const_iterator  operator++(int) { auto it = *this; m_index++; return it; }
+    const_iterator  operator--(int) { auto it = *this; m_index--; return it; }
+    const_iterator& operator+=(difference_type n) { m_index += n; return *this; }
+    const_iterator& operator-=(difference_type n) { m_index -= n; return *this; }
+    const_iterator  operator+(difference_type n) const { return { m_storage, m_index + n }; }
+    const_iterator  operator-(difference_type n) const { return { m_storage, m_index - n }; }
+    difference_type operator-(const const_iterator& other) const
+    {
+      return difference_type(m_index) - difference_type(other.m_index);
+    }
+
+    bool operator==(const const_iterator& other) const { return m_index == other.m_index; }
+    bool operator!=(const const_iterator& other) const { return m_index != other.m_index; }
+    bool operator<(const const_iterator& other) const { return m_index < other.m_index; }
+    bool operator>(const const_iterator& other) const { return m_index > other.m_index; }
+    bool operator<=(const const_iterator& other) const { return m_index <= other.m_index; }
+    bool operator>=(const const_iterator& other) const { return m_index >= other.m_index; }
+
+    private:
+    const SoaNodeStorage* m_storage = nullptr;
+    size_t                m_index   = 0;
+  };
+  using iterator = const_iterator;
+
+  size_t size() const { return m_keys.size(); }
+  bool   empty() const { return m_keys.empty(); }
+
+  void reserve(size_t count)
+  {
+    m_keys.reserve(count);
+    m_sizes.reserve(count);
+    m_colors.reserve(count);
+  }
+
+  void clear()
+  {
+    m_keys.clear();
+    m_sizes.clear();
+    m_colors.clear();
+  }
+
+  const_iterator begin() const { return { this, 0 }; }
+  const_iterator end() const { return { this, size() }; }
+
+  Node operator[](size_t i) const { return Get(i); }
+
+  const core::Vector<TKey>& Keys() const { return m_keys; }
+
+  TKey     Key(size_t i) const { return m_keys[i]; }
+  uint32_t Size(size_t i) const { return m_sizes[i]; }
+
+  Node Get(size_t i) const
+  {
+    const Color& c = m_colors[i];
+    return Node(m_keys[i], m_sizes[i], c.r, c.g, c.b);
+  }
+
+  void Set(size_t i, const Node& node)
+  {
+    m_keys[i]   = node.start;
+    m_sizes[i]  = node.size;
+    m_colors[i] = { node.r, node.g, node.b };
+  }
+
+  void SetSize(size_t i, uint32_t size) { m_sizes[i] = size; }
+
+  size_t LowerBound(size_t first, size_t last, TKey key) const
+  {
+    return size_t(std::lower_bound(m_keys.begin() + first, m_keys.begin() + last, key) -
+                  m_keys.begin());
+  }
+
+  void PushBack(const Node& node)
+  {
+    m_keys.push_back(node.start);
+    m_sizes.push_back(node.size);
+    m_colors.push_back({ node.r, node.g, node.b });
+  }
+
+  void Insert(size_t i, const Node& node)
+  {
+    m_keys.insert(m_keys.begin() + i, node.start);
+    m_sizes.insert(m_sizes.begin() + i, node.size);
+    m_colors.insert(m_colors.begin() + i, Color{ node.r, node.g, node.b });
+  }
+
+  void Erase(size_t first, size_t last)
+  {
+    m_keys.erase(m_keys.begin() + first, m_keys.begin() + last);
+    m_sizes.erase(m_sizes.begin() + first, m_sizes.begin() + last);
+    m_colors.erase(m_colors.begin() + first, m_colors.begin() + last);
+  }
+
+  void Resize(size_t count)
+  {
+    m_keys.resize(count);
+    m_sizes.resize(count);
+    m_colors.resize(count);
+  }
+
+  void MoveElement(size_t from, size_t to)
+  {
+    m_keys[to]   = m_keys[from];
+    m_sizes[to]  = m_sizes[from];
+    m_colors[to] = m_colors[from];
+  }
+
+  /// Sorts a permutation of the tail, merges it with the prefix and gathers all three arrays.
+  void SortTail(size_t first)
+  {
+    core::Vector<uint32_t> order(size());
+    std::iota(order.begin(), order.end(), 0u);
+
+    auto byKey = [this](uint32_t a, uint32_t b) { return m_keys[a] < m_keys[b]; };
+    auto tail  = order.begin() + first;
+    std::stable_sort(tail, order.end(), byKey);
+    std::inplace_merge(order.begin(), tail, order.end(), byKey);
+
+    Gather(m_keys, order);
+    Gather(m_sizes, order);
+    Gather(m_colors, order);
+  }
+
+  private:
+  template <class T> static void Gather(core::Vector<T>& values, const core::Vector<uint32_t>& order)
+  {
+    core::Vector<T> sorted;
+    sorted.reserve(values.size());
+    for (uint32_t i : order)
+      sorted.push_back(values[i]);
+    values.swap(sorted);
+  }
+
+  core::Vector<TKey>     m_keys;
+  core::Vector<uint32_t> m_sizes;
+  core::Vector<Color>    m_colors;
+};
+} // namespace vox
+
+#endif // THEPROJECT2_INCLUDE_VOXEL_NODESTORAGE_H_
@@ -10,6 +10,8 @@ static const uint32_t DEPTH_TABLE[]=      {2,4,8,16,32,64,128,256,512,1024};
 static const uint32_t POSITION_MASK[]= {0xfffffe00,0xffffff00,0xffffff80,0xffffffc0,0xffffffe0,0xfffffff0,0xfffffff8,0xfffffffc,0xfffffffe,0xffffffff}; /// Don't question the hax
 static const uint32_t CHUNK_MASK= ~0x7FFFu;
 static const uint32_t LOCAL_VOXEL_MASK= 0x7FFFu;
+static const uint32_t CHUNK_SHIFT = 15;           ///key >> CHUNK_SHIFT is the 32^3 chunk index
 static const uint32_t VOXELS_IN_CHUNK = 0x7FFFu + 1;
+template <class TKey> static constexpr TKey KEY_CHUNK_MASK = ~TKey(LOCAL_VOXEL_MASK); /// CHUNK_MASK for any key width
 }
 #endif
\ No newline at end of file
@@ -5,26 +5,36 @@
 #include "core/POD.h"
 
 namespace vox {
-struct VoxNode {
+template <class TKey> struct BasicVoxNode {
 public:
-  uint32_t start;
+  using KeyType = TKey;
+
+  /// Size of a removed node that is still waiting for the octree to compact it away.
+  static constexpr uint32_t TombstoneSize = ~0u;
+
+  TKey start;
   uint32_t size;
   uint8_t r, g, b;
 
-  VoxNode(const VoxNode &node) = default;
-  VoxNode(VoxNode &&n) noexcept;
-  VoxNode(core::pod::Vec3<uint32_t> pos, core::pod::Vec3<uint8_t> color, uint32_t nodeSize = 1);
-  VoxNode(uint32_t x, uint32_t y, uint32_t z, uint32_t nodeSize = 1);
-  VoxNode(uint32_t morton, uint32_t nodeSize, uint8_t red, uint8_t green,
+  BasicVoxNode(const BasicVoxNode &node) = default;
+  BasicVoxNode(BasicVoxNode &&n) noexcept;
+  BasicVoxNode(core::pod::Vec3<uint32_t> pos, core::pod::Vec3<uint8_t> color, uint32_t nodeSize = 1);
+  BasicVoxNode(uint32_t x, uint32_t y, uint32_t z, uint32_t nodeSize = 1);
+  BasicVoxNode(TKey morton, uint32_t nodeSize, uint8_t red, uint8_t green,
         uint8_t blue);
-  explicit VoxNode(uint32_t morton, uint32_t nodeSize = 1);
-  VoxNode();
+  explicit BasicVoxNode(TKey morton, uint32_t nodeSize = 1);
+  BasicVoxNode();
 
-  void Assign(const VoxNode& node);
+  void Assign(const BasicVoxNode& node);
+  bool IsTombstone() const { return size == TombstoneSize; }
 
-  VoxNode &operator=(VoxNode &&x) noexcept = default;
-  bool operator<(const VoxNode &other) const;
-  bool operator==(const VoxNode &other) const;
+  BasicVoxNode &operator=(BasicVoxNode &&x) noexcept = default;
+  bool operator<(const BasicVoxNode &other) const;
+  bool operator==(const BasicVoxNode &other) const;
 };
+
+/// 32-bit keys address 1024^3 voxels, 64-bit keys 2^21 voxels per axis.
+using VoxNode   = BasicVoxNode<uint32_t>;
+using VoxNode64 = BasicVoxNode<uint64_t>;
 }
 #endif
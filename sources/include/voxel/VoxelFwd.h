@@ -2,14 +2,28 @@
 #define THEPROJECT2_INCLUDE_VOXEL_VOXELFWD_H_
 
 namespace vox {
-class MortonOctree;
+template <class TKey> class AosNodeStorage;
+template <class TKey> class SoaNodeStorage;
+template <class TKey, class TStorage = AosNodeStorage<TKey>> class BasicMortonOctree;
 class VoxelMesh;
 class WorldRenderer;
-class CollisionManager;
-struct CollisionInfo;
-struct AABBCollisionInfo;
+template <class TKey> class BasicCollisionManager;
+template <class TKey> struct BasicCollisionInfo;
+template <class TKey> struct BasicAABBCollisionInfo;
 struct MaskNode;
-struct VoxNode;
+template <class TKey> struct BasicVoxNode;
+
+using VoxNode             = BasicVoxNode<uint32_t>;
+using VoxNode64           = BasicVoxNode<uint64_t>;
+using MortonOctree        = BasicMortonOctree<uint32_t>;
+using MortonOctree64      = BasicMortonOctree<uint64_t>;
+using MortonOctreeSoa     = BasicMortonOctree<uint32_t, SoaNodeStorage<uint32_t>>;
+using CollisionManager    = BasicCollisionManager<uint32_t>;
+using CollisionManager64  = BasicCollisionManager<uint64_t>;
+using CollisionInfo       = BasicCollisionInfo<uint32_t>;
+using CollisionInfo64     = BasicCollisionInfo<uint64_t>;
+using AABBCollisionInfo   = BasicAABBCollisionInfo<uint32_t>;
+using AABBCollisionInfo64 = BasicAABBCollisionInfo<uint64_t>;
 
 namespace map {
 class WorldGenerator;
@@ -9,7 +9,9 @@
 #include "CollisionManager.h"
 #include "MNodeUtil.h"
 #include "Morton.h"
+#include "MortonBatch.h"
 #include "MortonOctree.h"
+#include "MortonRange.h"
 #include "OctreeConstants.h"
 #include "VoxNode.h"
 #include "VoxelMesh.h"
@@ -3,19 +3,87 @@
 #include "render/RenderFwd.h"
 
 namespace vox {
+/// 8-byte chunk vertex, decoded by resources/shaders/voxel.vert. Chunk local positions fit 6 bits
+/// per axis, the normal is one of six axes and the UV is 0 or the quad size along each axis.
+/// The ambient occlusion level goes from 0, a fully enclosed corner, to 3, unoccluded.
+/// Both words stay below 2^24, so they convert to float32 and back exactly.
+struct PackedVoxelVertex {
+  uint32_t PositionNormal; /// x, y, z in bits 0..17, normal index in bits 18..20, AO in 21..22
+  uint32_t UVTexture;      /// u, v in bits 0..11, texture layer in bits 16..23
+
+  /// Normal indices: +x, -x, +y, -y, +z, -z.
+  enum ENormal : uint32_t { PosX, NegX, PosY, NegY, PosZ, NegZ };
+
+  static PackedVoxelVertex Pack(const glm::vec3 &position, ENormal normal, uint32_t u, uint32_t v,
+                                uint32_t texture, uint32_t ao = 3) {
+    return {uint32_t(position.x) | uint32_t(position.y) << 6 | uint32_t(position.z) << 12 |
+                uint32_t(normal) << 18 | ao << 21,
+            u | v << 6 | texture << 16};
+  }
+
+  /// The vertex as the GPU gets it: both words as float32 components, the attribute type the
+  /// float format uses too, so no integer vertex attribute support is needed.
+  [[nodiscard]] glm::vec2 ToFloat32() const {
+    return glm::vec2(float(PositionNormal), float(UVTexture));
+  }
+};
+
 class VoxelMesh {
 public:
+  /// Float keeps separate position, UV and normal arrays, 36 bytes per vertex, and has no room
+  /// for ambient occlusion. Packed fills PackedVertices only, 8 bytes per vertex, with the winding
+  /// folded into the vertex order so every quad uses the same indices and Indices stays empty.
+  enum class EVertexFormat { Float, Packed };
+
+  /// The mesher emits quads slice by slice: 32 slices for each of the three face planes.
+  static constexpr uint32_t SliceCount = 3 * 32;
+
   core::Vector<uint32_t> Indices;
   core::Vector<glm::vec3> Vertices;
   core::Vector<glm::vec3> UVs;
   core::Vector<glm::vec3> Normals;
+  core::Vector<PackedVoxelVertex> PackedVertices;
+  /// Quads of slice s are [SliceQuadStart[s], SliceQuadStart[s + 1]), filled by the mesher.
+  uint32_t SliceQuadStart[SliceCount + 1] = {};
 
 public:
-  VoxelMesh(core::UniquePtr<render::IGpuBufferArrayObject> vao);
+  VoxelMesh(core::UniquePtr<render::IGpuBufferArrayObject> vao,
+            EVertexFormat format = EVertexFormat::Float);
+
+  [[nodiscard]] EVertexFormat GetVertexFormat() const {
+    return m_format;
+  }
+
+  [[nodiscard]] uint32_t GetQuadCount() const {
+    const size_t vertexCount =
+        m_format == EVertexFormat::Packed ? PackedVertices.size() : Vertices.size();
+    return uint32_t(vertexCount / 4);
+  }
+
+  /// Bytes of geometry Upload() sends, not counting the shared quad index buffer.
+  [[nodiscard]] size_t GetUploadSize() const {
+    if (m_format == EVertexFormat::Packed)
+      return PackedVertices.size() * sizeof(PackedVoxelVertex);
+    return Indices.size() * sizeof(uint32_t) +
+           (Vertices.size() + UVs.size() + Normals.size()) * sizeof(glm::vec3);
+  }
+
+  /// Indices of the first quadCount quads of a packed mesh, shared by all meshes: two triangles
+  /// (0, 2, 3) and (0, 1, 2) per four vertices. Grows on demand, main thread only.
+  static const core::Vector<uint32_t> &GetQuadIndices(size_t quadCount);
+  /// Quads the GPU index buffer of a packed mesh with quadCount quads is sized for. Every mesh
+  /// uploads its own copy, the render abstraction can not share one index buffer between VAOs.
+  static size_t GetQuadIndexCapacity(size_t quadCount);
   void Upload();
   void Render();
 
   void Clear();
+  /// Copies the geometry of other, sized to fit: a buffer much larger than needed is released
+  /// instead of being kept around by a mesh that shrank.
+  void AssignGeometry(const VoxelMesh &other);
+  /// Replaces the quads of one slice with all quads of patch, which must use the same format.
+  /// Quads of later slices move, their vertex indices are adjusted. Upload again afterwards.
+  void ReplaceSliceQuads(uint32_t slice, const VoxelMesh &patch);
 
   [[nodiscard]] bool IsReady() const {
     return m_isReady;
@@ -24,6 +92,11 @@ public:
   ~VoxelMesh();
 protected:
   core::UniquePtr<render::IGpuBufferArrayObject> m_vao;
+  EVertexFormat m_format;
+  /// Granularity of the index buffer size, 6 KiB of indices.
+  static constexpr size_t QuadCapacityStep = 256;
+  /// Quads covered by the index buffer uploaded for a packed mesh.
+  size_t m_uploadedQuadCapacity = 0;
   bool m_isReady;
 };
 }
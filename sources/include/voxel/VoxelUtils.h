@@ -2,54 +2,65 @@
 #define THEPROJECT2_INCLUDE_VOXEL_VOXELUTILS_H_
 #include "Morton.h"
 #include "OctreeConstants.h"
+#include "VoxNode.h"
+#include "util/TypeUtils.h"
 
+/// Helpers taking a bare key default to 32-bit keys, pass the key type explicitly for others,
+/// e.g. Decode<MortonKey64>(key).
 namespace vox::utils {
-inline uint32_t GetChunk(uint32_t mortonVoxelPosition)
+template <class TKey = MortonKey> inline TKey GetChunk(util::TypeIdentityT<TKey> mortonVoxelPosition)
 {
-  return mortonVoxelPosition & CHUNK_MASK;
+  return mortonVoxelPosition & KEY_CHUNK_MASK<TKey>;
 }
 
-inline uint32_t NextChunk(uint32_t mortonVoxelPosition)
+template <class TKey = MortonKey> inline size_t GetChunkIndex(util::TypeIdentityT<TKey> mortonVoxelPosition)
 {
-  return (mortonVoxelPosition + VOXELS_IN_CHUNK) & CHUNK_MASK;
+  return size_t(mortonVoxelPosition >> CHUNK_SHIFT);
 }
 
-inline std::tuple<uint32_t, uint32_t, uint32_t> Decode(uint32_t mk)
+template <class TKey = MortonKey> inline TKey NextChunk(util::TypeIdentityT<TKey> mortonVoxelPosition)
+{
+  return (mortonVoxelPosition + VOXELS_IN_CHUNK) & KEY_CHUNK_MASK<TKey>;
+}
+
+template <class TKey = MortonKey>
+inline std::tuple<uint32_t, uint32_t, uint32_t> Decode(util::TypeIdentityT<TKey> mk)
 {
   uint32_t x, y, z;
-  decodeMK(mk, x, y, z);
+  MortonTraits<TKey>::Decode(mk, x, y, z);
   return { x, y, z };
 }
 
-inline uint32_t Encode(uint32_t x, uint32_t y, uint32_t z)
+template <class TKey = MortonKey> inline TKey Encode(uint32_t x, uint32_t y, uint32_t z)
 {
-  return encodeMK(x, y, z);
+  return MortonTraits<TKey>::Encode(x, y, z);
 }
 
-inline uint32_t VoxelChunkSpan(const vox::VoxNode& node)
+template <class TKey> inline TKey VoxelChunkSpan(const vox::BasicVoxNode<TKey>& node)
 {
   return node.start + node.size;
 }
 
-inline bool IsNodeInChunk(const vox::VoxNode& node, uint32_t chunk)
+template <class TKey>
+inline bool IsNodeInChunk(const vox::BasicVoxNode<TKey>& node, util::TypeIdentityT<TKey> chunk)
 {
-  return GetChunk(node.start) >= chunk && GetChunk(node.start + node.size - 1) <= chunk;
+  return GetChunk<TKey>(node.start) >= chunk && GetChunk<TKey>(node.start + node.size - 1) <= chunk;
 }
 
-inline void FitNodeToChunk(vox::VoxNode& node)
+template <class TKey> inline void FitNodeToChunk(vox::BasicVoxNode<TKey>& node)
 {
-  auto chunkEndForNode = NextChunk(node.start);
-  node.size            = glm::min(node.size, chunkEndForNode - node.start);
+  auto chunkEndForNode = NextChunk<TKey>(node.start);
+  node.size            = uint32_t(glm::min<TKey>(node.size, chunkEndForNode - node.start));
 }
 
-inline uint32_t GetNodeEndChunk(const vox::VoxNode& node)
+template <class TKey> inline TKey GetNodeEndChunk(const vox::BasicVoxNode<TKey>& node)
 {
-  return GetChunk(node.start + node.size - 1);
+  return GetChunk<TKey>(node.start + node.size - 1);
 }
 
-inline uint32_t MaxNode(uint32_t worldSizeDim)
+template <class TKey = MortonKey> inline TKey MaxNode(uint32_t worldSizeDim)
 {
-  return Encode(worldSizeDim - 1, worldSizeDim - 1, worldSizeDim - 1);
+  return Encode<TKey>(worldSizeDim - 1, worldSizeDim - 1, worldSizeDim - 1);
 }
 
 } // namespace vox::utils
@@ -10,6 +10,7 @@
 #include "voxel/VoxelFwd.h"
 #include "voxel/VoxelMesh.h"
 #include <voxel/world/World.h>
+#include <atomic>
 namespace vox {
 class WorldSubChunk
 {
@@ -48,6 +49,7 @@ class WorldSubChunk
       , m_isDirty(false)
       , m_isGenerating(false)
       , m_isFirstBufferActive(true)
+      , m_isRemeshQueued(false)
   {
     ASSERT(m_firstMeshBuffer && m_secondMeshBuffer);
   }
@@ -61,51 +63,85 @@ class WorldSubChunk
   bool                       m_isDirty;
   bool                       m_isGenerating;
   bool                       m_isFirstBufferActive;
+  /// In WorldRenderer::m_pendingRemesh. A job still running then is already cancelled.
+  bool                       m_isRemeshQueued;
+  /// Bumped for every mesher job, and to cancel the queued one. A job whose generation no longer
+  /// matches is stale and is dropped without meshing.
+  std::atomic<uint32_t>      m_meshGeneration{ 0 };
 
   friend class WorldRenderer;
   friend class MesherBackgroundJob;
 };
 
+/// Describes one sub-chunk to mesh: a copy of its nodes and apron. The mesher and its output
+/// buffers belong to the worker thread that runs the job, see Run(). Sub-chunks are never removed
+/// from WorldRenderer, so m_subChunk stays valid even after the job was cancelled.
 class MesherBackgroundJob : public threading::BackgroundJob
 {
   public:
-  MesherBackgroundJob(WorldSubChunk* subChunk, std::vector<VoxNode>::iterator chunkStart,
-                      std::vector<VoxNode>::iterator chunkEnd)
-      : m_subChunk(subChunk)
+  /// Copies the nodes out of the octree, so any node storage iterator works.
+  template <class TNodeIterator>
+  MesherBackgroundJob(WorldSubChunk* subChunk, glm::ivec3 subChunkPos, TNodeIterator chunkStart,
+                      TNodeIterator chunkEnd, const ChunkApron& apron = ChunkApron())
+      : m_nodesToMesh(chunkStart, chunkEnd)
+      , m_subChunk(subChunk)
+      , m_subChunkPos(subChunkPos)
+      , m_generation(++subChunk->m_meshGeneration)
+      , m_apron(apron)
   {
     subChunk->GetBufferForUpdates()->Clear();
-    m_nodesToMesh = core::Vector<VoxNode>(chunkStart, chunkEnd);
   }
 
-  MesherBackgroundJob(WorldSubChunk* subChunk, std::vector<VoxNode>&& chunkNodes)
-      : m_subChunk(subChunk)
-      , m_nodesToMesh(chunkNodes)
+  MesherBackgroundJob(WorldSubChunk* subChunk, glm::ivec3 subChunkPos,
+                      std::vector<VoxNode>&& chunkNodes)
+      : m_nodesToMesh(core::Move(chunkNodes))
+      , m_subChunk(subChunk)
+      , m_subChunkPos(subChunkPos)
+      , m_generation(++subChunk->m_meshGeneration)
   {
   }
 
   ~MesherBackgroundJob() override = default;
 
-  void Run() final
-  {
-    static int chunkCount = 0;
-    m_subChunk->GetBufferForUpdates()->Clear();
-    chunkMesher.BuildChunk(m_nodesToMesh.begin(), m_nodesToMesh.end(),
-                           m_subChunk->GetBufferForUpdates());
-    elog::LogInfo(core::string::format("Chunk counter {}", chunkCount));
-    chunkCount++;
-  }
+  void Run() final;
 
   void FinalizeInMainThread() final
   {
-    m_subChunk->GetBufferForUpdates()->Upload();
-    m_subChunk->SwapActiveBuffer();
+    if (IsCancelled())
+    {
+      // Whoever cancelled the job queued the sub-chunk in WorldRenderer::m_pendingRemesh, Update
+      // remeshes it from there once it is in render range.
+      m_subChunk->m_isDirty = true;
+    }
+    else
+    {
+      m_subChunk->GetBufferForUpdates()->Upload();
+      m_subChunk->SwapActiveBuffer();
+    }
     m_subChunk->m_isGenerating = false;
   }
 
+  size_t GetFinalizationBytes() const final
+  {
+    return IsCancelled() ? 0 : m_subChunk->GetBufferForUpdates()->GetUploadSize();
+  }
+
+  bool IsCancelled() const final
+  {
+    return m_subChunk->m_meshGeneration.load(std::memory_order_relaxed) != m_generation;
+  }
+
+  [[nodiscard]] glm::ivec3 GetSubChunkPos() const
+  {
+    return m_subChunkPos;
+  }
+
   private:
-  vox::ChunkMesher     chunkMesher;
   std::vector<VoxNode> m_nodesToMesh;
   WorldSubChunk*       m_subChunk;
+  glm::ivec3           m_subChunkPos;
+  uint32_t             m_generation;
+  ChunkApron           m_apron;
 };
 
 
@@ -119,6 +155,9 @@ class WorldRenderer
 
   virtual ~WorldRenderer();
 
+  /// Queued mesher jobs are reprioritized whenever the origin moves to another sub-chunk, and
+  /// cancelled when their sub-chunk drops out of render range. Update meshes those sub-chunks
+  /// again once they are back in range.
   void SetPlayerOriginInWorld(glm::ivec3 origin);
 
   void BuildChunkV2(const gw::WorldSuperChunk& chunkData);
@@ -126,6 +165,10 @@ class WorldRenderer
 
   void Update(float microsecondsElapsed);
   void SetChunkDirty(glm::ivec3 subchunkGlobalOffset);
+  /// Call after the voxel at a world position was added or removed. Sub-chunks whose mesh is
+  /// current get the slices around the voxel patched and uploaded right away, others are remeshed
+  /// in the background once their pending job is done.
+  void UpdateVoxel(glm::ivec3 voxel);
   void GenerateVisibleChunks();
 
   void RenderWorldGui();
@@ -136,6 +179,24 @@ class WorldRenderer
   core::UniquePtr<vox::VoxelMesh> CreateEmptyMesh();
 
   WorldSubChunk* GetSubChunk(uint32_t chunkMK, glm::ivec3 worldChunkOffset);
+  /// Border layers of the six sub-chunks around chunkMK, read from the occupancy of the
+  /// superchunk or of its neighbor superchunk.
+  ChunkApron GetChunkApron(const gw::WorldSuperChunk& chunkData, uint32_t chunkMK);
+  /// Queues a full remesh of the sub-chunk at chunkMK, from the nodes as they are now.
+  void EnqueueMeshing(const gw::WorldSuperChunk& chunkData, uint32_t chunkMK,
+                      WorldSubChunk* subChunk);
+  /// Cancels the job of the sub-chunk, if any, and queues it in m_pendingRemesh once.
+  void QueueRemesh(glm::ivec3 subChunkPos, WorldSubChunk& subChunk);
+  /// Applies one voxel change to the sub-chunk at subChunkPos, the voxel may be in its apron.
+  void UpdateSubChunkVoxel(glm::ivec3 subChunkPos, glm::ivec3 voxel, const VoxNode* node);
+  /// Lower runs sooner: the distance to the player, up to three times as far for sub-chunks
+  /// behind the camera.
+  float   GetMeshingPriority(glm::ivec3 subChunkPos) const;
+  /// Superchunks meshed on each side of the superchunk of the player.
+  int32_t GetRenderDistanceInSuperChunks() const;
+  bool    IsInRenderRange(glm::ivec3 subChunkPos) const;
+  /// Cancels queued meshing of sub-chunks out of range and reprioritizes the rest.
+  void    UpdateMeshingPriorities();
 
   private:
   // VoxNode m_buildNodes[32][32][32];
@@ -146,9 +207,24 @@ class WorldRenderer
   render::DebugRenderer*                        m_debugRenderer;
   vox::EWorldRenderDistance                     m_renderDistanceInChunks;
   glm::ivec3                                    m_playerOrigin;
+  /// Camera forward vector, zero until the first Update.
+  glm::vec3                                     m_playerViewDirection;
+  /// Sub-chunk of the player origin when mesher jobs were last reprioritized.
+  glm::ivec3                                    m_prioritizedSubChunk;
   core::UniquePtr<render::ITexture>             m_worldAtlas;
 
-  threading::BackgroundJobRunner<4> m_backgroundMesher;
+  threading::BackgroundJobRunner m_backgroundMesher;
+  /// Main-thread time and upload bytes Update spends on finished meshes per frame.
+  threading::FinalizationBudget m_meshUploadBudget;
+  threading::FinalizationStats  m_lastMeshUploadStats;
+
+  /// Holds the chunk of m_editSubChunk between edits, so editing the same sub-chunk again
+  /// does not reload it.
+  core::UniquePtr<ChunkMesher> m_editMesher;
+  WorldSubChunk*               m_editSubChunk = nullptr;
+  /// Sub-chunks whose mesh is not current because of an edit or a cancelled job, remeshed by
+  /// Update once no job is running and they are in render range.
+  core::Vector<glm::ivec3> m_pendingRemesh;
 };
 } // namespace vox
 
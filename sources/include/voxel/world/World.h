@@ -26,6 +26,20 @@ class World
 
   WorldSuperChunk* CreateChunk(glm::ivec3 chunk);
 
+  /// Superchunk holding a world voxel position, rounding down for negative positions.
+  static glm::ivec3 GetSuperChunkPos(glm::ivec3 voxel)
+  {
+    auto floorDiv = [](int32_t v) {
+      return (v >= 0 ? v : v - (SuperChunkSize - 1)) / SuperChunkSize;
+    };
+    return glm::ivec3(floorDiv(voxel.x), floorDiv(voxel.y), floorDiv(voxel.z));
+  }
+
+  /// Copies the node covering the voxel at a world position, false when the voxel is empty.
+  bool GetVoxel(glm::ivec3 voxel, vox::VoxNode& node);
+  /// Removes the voxel at a world position, false when it was already empty.
+  bool RemoveVoxel(glm::ivec3 voxel);
+
   core::UnorderedMap<glm::ivec3, WorldSuperChunk>& GetAllChunks()
   {
     return m_worldChunks;
@@ -13,7 +13,7 @@ struct WorldSuperChunk
   NONCOPYABLE(WorldSuperChunk);
 
   public:
-  using VoxNodeIterator = std::vector<vox::VoxNode>::iterator;
+  using VoxNodeIterator = vox::MortonOctree::NodeIterator;
 
   public:
   WorldSuperChunk(const glm::ivec3& worldPos, core::UniquePtr<vox::MortonOctree> octree)
@@ -32,20 +32,21 @@ struct WorldSuperChunk
     return Octree->GetNodes().begin();
   }
 
+  /// Number of 32^3 sub-chunk slots, some of them may be empty.
+  size_t GetSubChunkCount() const
+  {
+    return Octree->GetChunkCount();
+  }
+
+  vox::MortonOctree::ChunkRange GetSubChunkRange(size_t subChunk) const
+  {
+    return Octree->GetChunkRange(subChunk);
+  }
+
   VoxNodeIterator GetChunkEnd(VoxNodeIterator it) const
   {
-    auto searchVoxNode = vox::VoxNode(vox::utils::NextChunk(it->start + it->size));
-
-    //    elog::LogInfo(core::string::format("searchVoxNode.start  = {}", searchVoxNode.start));
-
-    return std::upper_bound(it, Octree->GetNodes().end(), searchVoxNode,
-                            [](const vox::VoxNode& a, const vox::VoxNode& b) {
-                              //                              elog::LogInfo(core::string::format("a.start
-                              //                              = {}, b.start={}",
-                              //                                                                 a.start,
-                              //                                                                 b.start));
-                              return (a.start & vox::CHUNK_MASK) <= b.start;
-                            });
+    const auto range = Octree->GetChunkRange(vox::utils::GetChunkIndex(it->start));
+    return Octree->GetNodes().begin() + range.end;
   }
 
   glm::ivec3                         WorldPos;
@@ -194,6 +194,7 @@ bool GameState::Run()
   auto milisecondsElapsed  = microSecondsElapsed / 1000.f;
   auto secondsElapsed      = milisecondsElapsed / 1000.f;
 
+  m_worldRenderer->SetPlayerOriginInWorld(m_player->GetPosition());
   m_worldRenderer->Update(microSecondsElapsed);
   m_timer.Start();
 
@@ -363,21 +364,18 @@ bool GameState::OnMouseUp(const input::MouseButton& key)
                                        start.z, end.x, end.y, end.z));
     m_debugRenderer->AddLine(start, start + dir, 5);
 
-    /*auto ci = vox::CollisionInfo(start, dir);
-    m_collisionManager->Collide(ci);
-
-    if (ci.HasCollided()) {
-      uint32_t nodeX, nodeY, nodeZ;
-      vox::decodeMK(ci.node.start, nodeX, nodeY, nodeZ);
-
-      m_debugRenderer->AddAABV(glm::vec3(nodeX, nodeY, nodeZ),
-                               glm::vec3(nodeX + 1, nodeY + 1, nodeZ + 1), 5);
-
-      m_octree->RemoveNode(nodeX, nodeY, nodeZ);
-
-      uint32_t chunk = vox::utils::GetChunk(ci.node.start);
-      m_worldRenderer->SetChunkDirty(chunk);
-    }*/
+    // Break the first solid voxel along the aim ray, steps stay well below one voxel.
+    static constexpr uint32_t RaySteps = 64;
+    for (uint32_t step = 0; step <= RaySteps; step++)
+    {
+      const glm::ivec3 voxel(glm::floor(start + dir * (float(step) / RaySteps)));
+      if (m_world->RemoveVoxel(voxel))
+      {
+        m_debugRenderer->AddAABV(glm::vec3(voxel), glm::vec3(1), 5);
+        m_worldRenderer->UpdateVoxel(voxel);
+        break;
+      }
+    }
   }
 
   return GameInputHandler::OnMouseUp(key);
@@ -0,0 +1,175 @@
+#include "threading/JobScheduler.h"
+#include <algorithm>
+
+namespace threading {
+namespace {
+/// Scheduler and worker index of the current thread, when it is a scheduler worker.
+thread_local JobScheduler* t_scheduler   = nullptr;
+thread_local uint32_t      t_workerIndex = 0;
+} // namespace
+
+JobScheduler::JobScheduler(uint32_t workerCount)
+{
+  workerCount = std::max(workerCount, 1u);
+  m_workers.reserve(workerCount);
+  for (uint32_t i = 0; i < workerCount; i++)
+  {
+    m_workers.push_back(core::MakeUnique<Worker>());
+  }
+
+  // Start only once every deque exists, workers steal from each other right away.
+  for (uint32_t i = 0; i < workerCount; i++)
+  {
+    m_workers[i]->Thread = std::thread(&JobScheduler::WorkerLoop, this, i);
+  }
+}
+
+JobScheduler::~JobScheduler()
+{
+  {
+    // Set under the lock, so no worker can miss the wakeup between its check and its wait.
+    std::lock_guard<std::mutex> lock(m_sleepMutex);
+    m_stop = true;
+  }
+  m_taskAvailable.notify_all();
+
+  // No logging, the scheduler of Get() is destroyed during static destruction, maybe after the
+  // logger.
+  for (auto& worker : m_workers)
+  {
+    worker->Thread.join();
+  }
+
+  // Tasks still queued at shutdown are dropped.
+  for (auto& worker : m_workers)
+  {
+    while (SchedulerTask* task = worker->Deque.Steal())
+    {
+      delete task;
+    }
+    for (SchedulerTask* task : worker->Inbox)
+    {
+      delete task;
+    }
+  }
+}
+
+JobScheduler& JobScheduler::Get()
+{
+  static JobScheduler scheduler;
+  return scheduler;
+}
+
+uint32_t JobScheduler::GetDefaultWorkerCount()
+{
+  // hardware_concurrency() may return 0 when it can not tell.
+  const uint32_t hardwareThreads = std::thread::hardware_concurrency();
+  return hardwareThreads > 1 ? hardwareThreads - 1 : 1;
+}
+
+void JobScheduler::Submit(SchedulerTask* task)
+{
+  if (t_scheduler == this)
+  {
+    m_workers[t_workerIndex]->Deque.Push(task);
+  }
+  else
+  {
+    Worker& worker = *m_workers[m_nextInbox++ % m_workers.size()];
+    std::lock_guard<std::mutex> lock(worker.InboxMutex);
+    worker.Inbox.push_back(task);
+  }
+
+  m_queuedTasks++;
+  WakeWorker();
+}
+
+void JobScheduler::WakeWorker()
+{
+  // Pairs with the increment of m_sleepingWorkers in WorkerLoop: either the worker sees the new
+  // task before it waits, or this sees the sleeping worker. Taking the lock makes sure the worker
+  // is inside wait() before it is notified.
+  if (m_sleepingWorkers.load() > 0)
+  {
+    {
+      std::lock_guard<std::mutex> lock(m_sleepMutex);
+    }
+    m_taskAvailable.notify_one();
+  }
+}
+
+void JobScheduler::WorkerLoop(uint32_t workerIndex)
+{
+  t_scheduler   = this;
+  t_workerIndex = workerIndex;
+
+  while (m_stop == false)
+  {
+    if (SchedulerTask* task = FindTask(workerIndex))
+    {
+      m_queuedTasks--;
+      task->Execute();
+      continue;
+    }
+
+    std::unique_lock<std::mutex> lock(m_sleepMutex);
+    m_sleepingWorkers++;
+    m_taskAvailable.wait(lock, [this]() { return m_stop || m_queuedTasks.load() > 0; });
+    m_sleepingWorkers--;
+  }
+}
+
+SchedulerTask* JobScheduler::FindTask(uint32_t workerIndex)
+{
+  Worker& self = *m_workers[workerIndex];
+  if (SchedulerTask* task = self.Deque.Pop())
+  {
+    return task;
+  }
+
+  // Move the own inbox into the deque, so other workers can steal from it without the lock.
+  SchedulerTask* task = nullptr;
+  {
+    std::lock_guard<std::mutex> lock(self.InboxMutex);
+    if (self.Inbox.empty() == false)
+    {
+      task = self.Inbox.front();
+      for (size_t i = 1; i < self.Inbox.size(); i++)
+      {
+        self.Deque.Push(self.Inbox[i]);
+      }
+      self.Inbox.clear();
+    }
+  }
+  if (task)
+  {
+    return task;
+  }
+
+  const uint32_t workerCount = uint32_t(m_workers.size());
+  for (uint32_t i = 1; i < workerCount; i++)
+  {
+    Worker& victim = *m_workers[(workerIndex + i) % workerCount];
+    if (SchedulerTask* stolen = victim.Deque.Steal())
+    {
+      return stolen;
+    }
+  }
+
+  // A busy worker has not looked at its inbox yet.
+  for (uint32_t i = 1; i < workerCount; i++)
+  {
+    Worker& victim = *m_workers[(workerIndex + i) % workerCount];
+    std::unique_lock<std::mutex> lock(victim.InboxMutex, std::try_to_lock);
+    if (lock.owns_lock() && victim.Inbox.empty() == false)
+    {
+      SchedulerTask* stolen = victim.Inbox.back();
+      victim.Inbox.pop_back();
+      return stolen;
+    }
+  }
+
+  return nullptr;
+}
+
+} // namespace threading
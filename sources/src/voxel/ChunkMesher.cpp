@@ -1,4 +1,5 @@
 #include "voxel/ChunkMesher.h"
+#include "voxel/MortonBatch.h"
 #include "voxel/VoxelSide.h"
 #include <voxel/VoxelInc.h>
 #include <stack>
@@ -10,6 +11,7 @@ struct MaskNode {
   uint8_t backFace : 1;
   uint8_t align : 6;
   uint8_t r, g, b;
+  uint8_t frontAO, backAO;
 
   MaskNode() { frontFace = backFace = false; }
 };
@@ -23,21 +25,32 @@ struct Rect {
 };
 
 #define COLOR_EQ(C, N) (C[0] == N.r && C[1] == N.g && C[2] == N.b)
+#define AO_EQ(AO, N, FRONT) (AO == (FRONT ? N.frontAO : N.backAO))
+
+/// Per-vertex ambient occlusion of a face: 2 bits per corner, corners (i, j), (i + 1, j),
+/// (i + 1, j + 1) and (i, j + 1) of the mask cell from the low bits up. 3 is unoccluded.
+static constexpr uint8_t UnoccludedAO = 0xff;
+
+/// Faces only merge when the AO is the same on all four corners, otherwise the merged quad
+/// would stretch the gradient of one cell across all of them.
+static inline bool IsUniformAO(uint8_t ao) {
+  return ao == uint8_t((ao & 3u) * 0x55u);
+}
 
 inline int lengthr(int x, int y, const Rect &r, MaskNode mask[32][32],
-                   bool front, uint8_t color[3]) {
+                   bool front, uint8_t color[3], uint8_t ao) {
   int l = x;
   for (; l <= r.x2 && (front ? mask[y][l].frontFace : mask[y][l].backFace) &&
-         COLOR_EQ(color, mask[y][l]);
+         COLOR_EQ(color, mask[y][l]) && AO_EQ(ao, mask[y][l], front);
        l++)
     ;
   return l - x;
 }
 
 inline int heightr(int x, int y, int l, const Rect &r, MaskNode mask[32][32],
-                   bool front, uint8_t color[3]) {
+                   bool front, uint8_t color[3], uint8_t ao) {
   int h = y;
-  for (; h <= r.y2 && lengthr(x, h, r, mask, front, color) >= l; h++)
+  for (; h <= r.y2 && lengthr(x, h, r, mask, front, color, ao) >= l; h++)
     ;
   return h - y;
 }
@@ -52,124 +65,243 @@ inline void clearArea(MaskNode mask[32][32], bool front, int si, int sj, int i2,
         mask[j][i].backFace = false;
 }
 
-inline bool vf_equals(const VoxNode &n1, const VoxNode &n2) {
-  return n1.size == 1 && n1.size == n2.size;
-}
+/// Face rows of one slice for the binary mesher: bit i of front[j] is mask cell [j][i].
+/// mergeable[d][j] bit i tells whether the face of cell i can merge with the one of cell i - 1
+/// (same color and the same uniform AO), for front (d = 0) and back (d = 1) faces. It is only
+/// meaningful between two cells that have such a face.
+struct SliceFaces {
+  uint32_t front[32];
+  uint32_t back[32];
+  uint32_t mergeable[2][32];
+  uint8_t colors[32][32][3];
+  uint8_t ao[2][32][32];
+};
 
-ChunkMesher::ChunkMesher() {
+ChunkMesher::ChunkMesher(EMode mode) : m_mode(mode) {
 }
 
-VoxNode ChunkMesher::GetBuildNode(uint32_t x, uint32_t y, uint32_t z) {
-  if (x > 31 || y > 31 || z > 31) {
-    return VoxNode(0, 0);
-  } else {
-    return m_buildNodes[x][y][z];
+void ChunkApron::SetSide(ESide side, const ChunkOccupancy &neighbor) {
+  uint32_t *rows = Rows[side];
+  for (uint32_t j = 0; j < 32; j++)
+    rows[j] = 0;
+
+  switch (side) {
+  case NegX:
+  case PosX:
+    for (uint32_t z = 0; z < 32; z++)
+      rows[z] = neighbor.Column(side == NegX ? 31 : 0, z);
+    break;
+  case NegY:
+  case PosY: {
+    const uint32_t y = side == NegY ? 31 : 0;
+    for (uint32_t z = 0; z < 32; z++)
+      for (uint32_t x = 0; x < 32; x++)
+        rows[z] |= ((neighbor.Column(x, z) >> y) & 1u) << x;
+    break;
+  }
+  case NegZ:
+  case PosZ: {
+    const uint32_t z = side == NegZ ? 31 : 0;
+    for (uint32_t x = 0; x < 32; x++)
+      for (uint32_t column = neighbor.Column(x, z); column; column &= column - 1)
+        rows[__builtin_ctz(column)] |= 1u << x;
+    break;
+  }
   }
 }
 
 bool ChunkMesher::CheckBuildNode(uint32_t x, uint32_t y, uint32_t z) {
-  if (x > 31 || y > 31 || z > 31) {
-    return false;
-  } else {
-    return m_buildNodes[x][y][z].size == 1;
-  }
+  if (x < 32 && y < 32 && z < 32)
+    return m_buildOccupancy.Get(x, y, z);
+
+  if (y < 32 && z < 32 && (x == 32 || x == ~0u))
+    return (m_apron.Rows[x == 32 ? ChunkApron::PosX : ChunkApron::NegX][z] >> y) & 1u;
+  if (x < 32 && z < 32 && (y == 32 || y == ~0u))
+    return (m_apron.Rows[y == 32 ? ChunkApron::PosY : ChunkApron::NegY][z] >> x) & 1u;
+  if (x < 32 && y < 32 && (z == 32 || z == ~0u))
+    return (m_apron.Rows[z == 32 ? ChunkApron::PosZ : ChunkApron::NegZ][y] >> x) & 1u;
+  return false;
+}
+
+uint32_t ChunkMesher::GetBuildColumn(uint32_t x, uint32_t z) {
+  if (x < 32 && z < 32)
+    return m_buildOccupancy.Column(x, z);
+
+  uint32_t column = 0;
+  for (uint32_t y = 0; y < 32; y++)
+    column |= uint32_t(CheckBuildNode(x, y, z)) << y;
+  return column;
 }
 
 uint8_t ChunkMesher::GetVisibleBuildNodeSides(uint32_t x, uint32_t y,
                                               uint32_t z) {
   uint8_t sides = 0;
 
-  if (x == 0 || m_buildNodes[x - 1][y][z].size == 0)
+  if (!CheckBuildNode(x - 1, y, z))
     sides |= RIGHT;
 
-  if (x == 31 || m_buildNodes[x + 1][y][z].size == 0)
+  if (!CheckBuildNode(x + 1, y, z))
     sides |= LEFT;
 
-  if (y == 0 || m_buildNodes[x][y - 1][z].size == 0)
+  if (!CheckBuildNode(x, y - 1, z))
     sides |= BOTTOM;
 
-  if (y == 31 || m_buildNodes[x][y + 1][z].size == 0)
+  if (!CheckBuildNode(x, y + 1, z))
     sides |= TOP;
 
-  if (z == 0 || m_buildNodes[x][y][z - 1].size == 0)
+  if (!CheckBuildNode(x, y, z - 1))
     sides |= BACK;
 
-  if (z == 31 || m_buildNodes[x][y][z + 1].size == 0)
+  if (!CheckBuildNode(x, y, z + 1))
     sides |= FRONT;
 
   return sides;
 }
 
-void ChunkMesher::SetBuildNode(const VoxNode &node) {
-  uint32_t x, y, z;
-  decodeMK(node.start & LOCAL_VOXEL_MASK, x, y, z);
-  VoxNode &bn = m_buildNodes[x][y][z];
-  bn.start = node.start;
-  bn.size = node.size;
-  bn.r = node.r;
-  bn.g = node.g;
-  bn.b = node.b;
+/// Classic voxel AO: a corner is darkened by the two cells beside it and the one diagonal to it
+/// in the layer the face looks into, and fully dark when both side cells are solid. Cells of that
+/// layer outside the chunk are read from the apron, or count as empty where it has none.
+uint8_t ChunkMesher::GetFaceAO(uint32_t dim, uint32_t slice, bool frontFace, uint32_t i,
+                               uint32_t j) {
+  if (!m_ambientOcclusion)
+    return UnoccludedAO;
+
+  const uint32_t layer = frontFace ? slice + 1 : slice - 1;
+  auto solid = [&](int32_t di, int32_t dj) -> uint32_t {
+    const uint32_t ci = i + di, cj = j + dj;
+    if (ci >= 32 || cj >= 32)
+      return 0;
+    switch (dim) {
+    case 0:
+      return CheckBuildNode(ci, cj, layer);
+    case 1:
+      return CheckBuildNode(ci, layer, cj);
+    default:
+      return CheckBuildNode(layer, ci, cj);
+    }
+  };
+
+  static constexpr int32_t CornerSteps[4][2] = {{-1, -1}, {1, -1}, {1, 1}, {-1, 1}};
+  uint8_t ao = 0;
+  for (uint32_t corner = 0; corner < 4; corner++) {
+    const int32_t di = CornerSteps[corner][0], dj = CornerSteps[corner][1];
+    const uint32_t side1 = solid(di, 0), side2 = solid(0, dj), diagonal = solid(di, dj);
+    const uint32_t level = side1 && side2 ? 0 : 3 - (side1 + side2 + diagonal);
+    ao |= uint8_t(level << (2 * corner));
+  }
+  return ao;
+}
+
+/// Build nodes are single voxels, spans are expanded into one build node per key.
+void ChunkMesher::SetBuildNode(uint32_t x, uint32_t y, uint32_t z, const VoxNode &node) {
+  ASSERT(x<32 && y<32 && z<32, core::string::format("node x=<{}>, y=<{}>, z=<{}>", x,y,z));
+
+  m_buildOccupancy.Set(x, y, z);
+  m_buildRows[z][y] |= 1u << x;
+  m_buildColors[x][y][z] = {node.r, node.g, node.b};
+}
+
+void ChunkMesher::ResetBuildNode(uint32_t x, uint32_t y, uint32_t z) {
+  m_buildOccupancy.Reset(x, y, z);
+  m_buildRows[z][y] &= ~(1u << x);
+}
+
+void ChunkMesher::SetApronCell(uint32_t x, uint32_t y, uint32_t z, bool solid) {
+  uint32_t *row = nullptr;
+  uint32_t bit = 0;
+  if (y < 32 && z < 32 && (x == 32 || x == ~0u)) {
+    row = &m_apron.Rows[x == 32 ? ChunkApron::PosX : ChunkApron::NegX][z];
+    bit = y;
+  } else if (x < 32 && z < 32 && (y == 32 || y == ~0u)) {
+    row = &m_apron.Rows[y == 32 ? ChunkApron::PosY : ChunkApron::NegY][z];
+    bit = x;
+  } else if (x < 32 && y < 32 && (z == 32 || z == ~0u)) {
+    row = &m_apron.Rows[z == 32 ? ChunkApron::PosZ : ChunkApron::NegZ][y];
+    bit = x;
+  }
+
+  if (row == nullptr)
+    return;
+  if (solid)
+    *row |= 1u << bit;
+  else
+    *row &= ~(1u << bit);
 }
 
 void ChunkMesher::ClearBuildNodes() {
-  for (int x = 0; x < 32; x++)
-    for (int y = 0; y < 32; y++)
-      for (int z = 0; z < 32; z++)
-        m_buildNodes[x][y][z].size = 0;
+  m_buildOccupancy.Clear();
+  std::fill(&m_buildRows[0][0], &m_buildRows[0][0] + 32 * 32, 0u);
+}
+
+/// Calls func(bit) for every set bit of mask.
+template <class TFunc> static inline void ForEachBit(uint32_t mask, TFunc &&func) {
+  for (; mask; mask &= mask - 1)
+    func(uint32_t(__builtin_ctz(mask)));
 }
 
+/// Face bits come from whole occupancy columns: a cell has a front face where it is solid and
+/// the next cell along the slice axis is not, cells outside the chunk come from the apron. Mask
+/// cells without a face are left alone, BuildFacesFromMask clears every flag it consumed.
 inline void ChunkMesher::BuildSliceMask(uint32_t dim, uint32_t slice,
                                         MaskNode mask[32][32]) {
+  auto setFace = [&](MaskNode &maskNode, bool front, const BuildColor &color) {
+    const uint32_t i = uint32_t(&maskNode - &mask[0][0]) % 32;
+    const uint32_t j = uint32_t(&maskNode - &mask[0][0]) / 32;
+    if (front) {
+      maskNode.frontFace = true;
+      maskNode.frontAO = GetFaceAO(dim, slice, true, i, j);
+    } else {
+      maskNode.backFace = true;
+      maskNode.backAO = GetFaceAO(dim, slice, false, i, j);
+    }
+    maskNode.r = color.r;
+    maskNode.g = color.g;
+    maskNode.b = color.b;
+  };
+
   switch (dim) {
   case 0: {
-    for (int y = 0; y < 32; y++)
-      for (int x = 0; x < 32; x++) {
-        auto &mask_node = mask[y][x];
-
-        auto cn = GetBuildNode(x, y, slice);
-        mask_node.r = cn.r;
-        mask_node.g = cn.g;
-        mask_node.b = cn.b;
-
-        if (cn.size == 1) {
-          mask_node.frontFace = CheckBuildNode(x, y, slice + 1) == false;
-          mask_node.backFace = CheckBuildNode(x, y, slice - 1) == false;
-        }
-      }
+    // mask[y][x] is voxel (x, y, slice), columns run along the mask rows.
+    for (uint32_t x = 0; x < 32; x++) {
+      const uint32_t column = m_buildOccupancy.Column(x, slice);
+      const uint32_t next = GetBuildColumn(x, slice + 1);
+      const uint32_t prev = GetBuildColumn(x, slice - 1);
+
+      ForEachBit(column & ~next,
+                 [&](uint32_t y) { setFace(mask[y][x], true, m_buildColors[x][y][slice]); });
+      ForEachBit(column & ~prev,
+                 [&](uint32_t y) { setFace(mask[y][x], false, m_buildColors[x][y][slice]); });
+    }
     break;
   }
   case 1: {
-    for (int y = 0; y < 32; y++)
-      for (int x = 0; x < 32; x++) {
-        auto &mask_node = mask[y][x];
-
-        auto cn = GetBuildNode(x, slice, y);
-        mask_node.r = cn.r;
-        mask_node.g = cn.g;
-        mask_node.b = cn.b;
-
-        if (cn.size == 1) {
-          mask_node.frontFace = CheckBuildNode(x, slice + 1, y) == false;
-          mask_node.backFace = CheckBuildNode(x, slice - 1, y) == false;
-        }
+    // mask[z][x] is voxel (x, slice, z), the neighbors are the adjacent bits of one column.
+    const uint32_t bit = 1u << slice;
+    for (uint32_t z = 0; z < 32; z++)
+      for (uint32_t x = 0; x < 32; x++) {
+        const uint32_t column = m_buildOccupancy.Column(x, z);
+        if (!(column & bit))
+          continue;
+
+        if (slice < 31 ? !(column & (bit << 1)) : !CheckBuildNode(x, 32, z))
+          setFace(mask[z][x], true, m_buildColors[x][slice][z]);
+        if (slice > 0 ? !(column & (bit >> 1)) : !CheckBuildNode(x, ~0u, z))
+          setFace(mask[z][x], false, m_buildColors[x][slice][z]);
       }
     break;
   }
   case 2: {
-    for (int y = 0; y < 32; y++)
-      for (int x = 0; x < 32; x++) {
-        auto &mask_node = mask[y][x];
-
-        auto cn = GetBuildNode(slice, x, y);
-        mask_node.r = cn.r;
-        mask_node.g = cn.g;
-        mask_node.b = cn.b;
-
-        if (cn.size == 1) {
-          mask_node.frontFace = CheckBuildNode(slice + 1, x, y) == false;
-          mask_node.backFace = CheckBuildNode(slice - 1, x, y) == false;
-        }
-      }
+    // mask[z][y] is voxel (slice, y, z).
+    for (uint32_t z = 0; z < 32; z++) {
+      const uint32_t column = m_buildOccupancy.Column(slice, z);
+      const uint32_t next = GetBuildColumn(slice + 1, z);
+      const uint32_t prev = GetBuildColumn(slice - 1, z);
+
+      ForEachBit(column & ~next,
+                 [&](uint32_t y) { setFace(mask[z][y], true, m_buildColors[slice][y][z]); });
+      ForEachBit(column & ~prev,
+                 [&](uint32_t y) { setFace(mask[z][y], false, m_buildColors[slice][y][z]); });
+    }
     break;
   }
   }
@@ -197,9 +329,13 @@ void ChunkMesher::BuildFacesFromMask(vox::VoxelMesh *mesh, int dim, int z,
           color[0] = mask[j][i].r;
           color[1] = mask[j][i].g;
           color[2] = mask[j][i].b;
+          const uint8_t ao = frontFace ? mask[j][i].frontAO : mask[j][i].backAO;
 
-          int l = lengthr(i, j, r, mask, frontFace, color);
-          int h = heightr(i, j + 1, l, full, mask, frontFace, color) + 1;
+          int l = 1, h = 1;
+          if (IsUniformAO(ao)) {
+            l = lengthr(i, j, r, mask, frontFace, color, ao);
+            h = heightr(i, j + 1, l, full, mask, frontFace, color, ao) + 1;
+          }
 
           int sx = r.x, sy = j + h, ex = r.x2, ey = r.y2; /// bot one
           if (sx <= ex && sy <= ey)
@@ -214,7 +350,7 @@ void ChunkMesher::BuildFacesFromMask(vox::VoxelMesh *mesh, int dim, int z,
             scanArea.emplace(sx, sy, ex, ey);
 
           AddFaceToMesh(mesh, frontFace, (FacePlane)dim, z, glm::ivec2(i, j),
-                        glm::ivec2(l, h), color);
+                        glm::ivec2(l, h), color, ao);
           clearArea(mask, frontFace, i, j, i + l, j + h);
           faceNumber++;
 
@@ -229,8 +365,13 @@ void ChunkMesher::BuildFacesFromMask(vox::VoxelMesh *mesh, int dim, int z,
 void ChunkMesher::AddFaceToMesh(vox::VoxelMesh *mesh, bool frontFace,
                                 FacePlane dir, uint32_t slice, glm::ivec2 start,
                                 glm::ivec2 dims,
-                                uint8_t color[3]) {
+                                uint8_t color[3], uint8_t ao) {
+  // Mask corner of each face vertex: 0 is (i, j), 1 (i + 1, j), 2 (i + 1, j + 1), 3 (i, j + 1).
+  static constexpr uint32_t FaceCorners[3][4] = {{2, 3, 0, 1}, {0, 1, 2, 3}, {1, 2, 3, 0}};
   glm::vec3 face[4];
+  uint8_t faceAO[4];
+  for (uint32_t i = 0; i < 4; i++)
+    faceAO[i] = (ao >> (2 * FaceCorners[uint32_t(dir)][i])) & 3u;
 
   switch (dir) {
   case FacePlane::XY: // xy
@@ -264,28 +405,16 @@ void ChunkMesher::AddFaceToMesh(vox::VoxelMesh *mesh, bool frontFace,
     break;
   }
 
-  AddQuadToMesh(mesh, face, dims, frontFace, dir, color);
+  AddQuadToMesh(mesh, face, dims, frontFace, dir, color, faceAO);
 }
 
 void ChunkMesher::AddQuadToMesh(vox::VoxelMesh *mesh, const glm::vec3 *face,
                                 glm::ivec2 dims, bool frontFace,
                                 FacePlane facePlane,
-                                const uint8_t color[3]) noexcept {
-  auto &ibo = mesh->Indices;
-  auto &vbo = mesh->Vertices;
-  auto &uvbo = mesh->UVs;
-  auto &normals = mesh->Normals;
-
-  uint32_t indicesStart = vbo.size();
-  glm::vec3 col(((float)color[0]) / 255.0f, ((float)color[1]) / 255.0f,
-                ((float)color[2]) / 255.0f);
+                                const uint8_t color[3], const uint8_t ao[4]) noexcept {
+  using ENormal = PackedVoxelVertex::ENormal;
 
-  vbo.emplace_back(face[0]);
-  vbo.emplace_back(face[1]);
-  vbo.emplace_back(face[2]);
-  vbo.emplace_back(face[3]);
-
-  float texId;
+  uint8_t texId;
 
   if (facePlane == FacePlane::XZ) {
     if (frontFace)
@@ -300,15 +429,48 @@ void ChunkMesher::AddQuadToMesh(vox::VoxelMesh *mesh, const glm::vec3 *face,
     util::swap(dims.x, dims.y);
   }
 
-  uvbo.emplace_back(glm::vec3{0.f, 0.f, texId});
-  uvbo.emplace_back(glm::vec3{1.f * dims.x, 0.f, texId});
-  uvbo.emplace_back(glm::vec3{1.f * dims.x, 1.f * dims.y, texId});
-  uvbo.emplace_back(glm::vec3{0.f, 1.f * dims.y, texId});
+  const glm::ivec2 uvs[4] = {{0, 0}, {dims.x, 0}, {dims.x, dims.y}, {0, dims.y}};
 
   if (facePlane == FacePlane::XZ) {
     frontFace = !frontFace;
   }
 
+  glm::vec3 normal;
+  ENormal normalIndex;
+
+  if(facePlane == FacePlane::XZ){
+    normal = frontFace ? glm::vec3(0, -1, 0) : glm::vec3(0, 1, 0);
+    normalIndex = frontFace ? ENormal::NegY : ENormal::PosY;
+  }
+  else if(facePlane == FacePlane::XY){
+    normal = frontFace ? glm::vec3(0, 0, 1) : glm::vec3(0, 0, -1) ;
+    normalIndex = frontFace ? ENormal::PosZ : ENormal::NegZ;
+  }
+  else{
+    normal = frontFace ? glm::vec3(1, 0, 0) : glm::vec3(-1, 0, 0) ;
+    normalIndex = frontFace ? ENormal::PosX : ENormal::NegX;
+  }
+
+  // The triangles split the quad along the diagonal from vertex 0 to 2. When the other
+  // diagonal joins the brighter corners, start one vertex later so a dark corner stays in its
+  // own triangle instead of shading across the whole quad.
+  const uint32_t first = ao[0] + ao[2] < ao[1] + ao[3] ? 1 : 0;
+
+  if (mesh->GetVertexFormat() == VoxelMesh::EVertexFormat::Packed) {
+    // Quads share the indices (0, 2, 3), (0, 1, 2) of VoxelMesh::GetQuadIndices. Back faces list
+    // their corners as 2, 1, 0, 3, which gives the same triangles as the indices below.
+    static constexpr uint32_t BackFaceCorners[4] = {2, 1, 0, 3};
+    for (uint32_t corner = 0; corner < 4; corner++) {
+      const uint32_t i = ((frontFace ? corner : BackFaceCorners[corner]) + first) % 4;
+      mesh->PackedVertices.push_back(
+          PackedVoxelVertex::Pack(face[i], normalIndex, uvs[i].x, uvs[i].y, texId, ao[i]));
+    }
+    return;
+  }
+
+  auto &ibo = mesh->Indices;
+  uint32_t indicesStart = mesh->Vertices.size();
+
   if (frontFace) {
     ibo.emplace_back(indicesStart);
     ibo.emplace_back(indicesStart + 2);
@@ -327,72 +489,276 @@ void ChunkMesher::AddQuadToMesh(vox::VoxelMesh *mesh, const glm::vec3 *face,
     ibo.emplace_back(indicesStart);
   }
 
-  glm::vec3 normal;
-
-  if(facePlane == FacePlane::XZ){
-    normal = frontFace ? glm::vec3(0, -1, 0) : glm::vec3(0, 1, 0);
+  for (uint32_t corner = 0; corner < 4; corner++) {
+    const uint32_t i = (corner + first) % 4;
+    mesh->Vertices.emplace_back(face[i]);
+    mesh->UVs.emplace_back(glm::vec3{1.f * uvs[i].x, 1.f * uvs[i].y, float(texId)});
+    mesh->Normals.emplace_back(normal);
   }
-  else if(facePlane == FacePlane::XY){
-    normal = frontFace ? glm::vec3(0, 0, 1) : glm::vec3(0, 0, -1) ;
-  }
-  else{
-    normal = frontFace ? glm::vec3(1, 0, 0) : glm::vec3(-1, 0, 0) ;
+}
+
+void ChunkMesher::BuildSliceFaces(uint32_t dim, uint32_t slice, SliceFaces &faces) {
+  // Rows of the slice and of its two neighbors, indexed like the MaskNode grid of BuildSliceMask.
+  // The neighbors of the border slices come from the apron, slice - 1 wraps around for slice 0.
+  const uint32_t negSide = ChunkApron::NegZ - 2 * dim;
+  auto row = [this, dim, negSide](uint32_t s, uint32_t j) -> uint32_t {
+    if (s == 32)
+      return m_apron.Rows[negSide + 1][j];
+    if (s > 32)
+      return m_apron.Rows[negSide][j];
+    switch (dim) {
+    case 0:
+      return m_buildRows[s][j];
+    case 1:
+      return m_buildRows[j][s];
+    default:
+      return m_buildOccupancy.Column(s, j);
+    }
+  };
+  auto color = [this, dim, slice](uint32_t j, uint32_t i) -> const BuildColor & {
+    switch (dim) {
+    case 0:
+      return m_buildColors[i][j][slice];
+    case 1:
+      return m_buildColors[i][slice][j];
+    default:
+      return m_buildColors[slice][i][j];
+    }
+  };
+
+  for (uint32_t j = 0; j < 32; j++) {
+    const uint32_t solid = row(slice, j);
+    faces.front[j] = solid & ~row(slice + 1, j);
+    faces.back[j] = solid & ~row(slice - 1, j);
+
+    const uint32_t withFace = faces.front[j] | faces.back[j];
+    for (uint32_t bits = withFace; bits; bits &= bits - 1) {
+      const uint32_t i = uint32_t(__builtin_ctz(bits));
+      const BuildColor &c = color(j, i);
+      faces.colors[j][i][0] = c.r;
+      faces.colors[j][i][1] = c.g;
+      faces.colors[j][i][2] = c.b;
+    }
   }
 
-  normals.emplace_back(normal);
-  normals.emplace_back(normal);
-  normals.emplace_back(normal);
-  normals.emplace_back(normal);
-}
+  // AO of every face, 32 cells at a time: rows of the layer the faces look into give the side
+  // and diagonal occluders of each corner as shifted masks, see GetFaceAO. The occluder count
+  // 0..3 is kept in two bit planes.
+  for (uint32_t d = 0; d < 2; d++) {
+    const uint32_t *rows = d == 0 ? faces.front : faces.back;
+    const uint32_t layer = d == 0 ? slice + 1 : slice - 1;
+
+    uint32_t air[34] = {};
+    if (m_ambientOcclusion)
+      for (uint32_t j = 0; j < 32; j++)
+        air[j + 1] = row(layer, j);
+
+    for (uint32_t j = 0; j < 32; j++) {
+      const uint32_t down = air[j], mid = air[j + 1], up = air[j + 2];
+      const uint32_t sides[4][2] = {
+          {mid << 1, down}, {mid >> 1, down}, {mid >> 1, up}, {mid << 1, up}};
+      const uint32_t diagonals[4] = {down << 1, down >> 1, up >> 1, up << 1};
+
+      uint32_t low[4], high[4];
+      for (uint32_t corner = 0; corner < 4; corner++) {
+        const uint32_t both = sides[corner][0] & sides[corner][1];
+        const uint32_t any = sides[corner][0] | sides[corner][1];
+        low[corner] = both | (any ^ diagonals[corner]);
+        high[corner] = both | (any & diagonals[corner]);
+      }
 
-void ChunkMesher::GreedyBuildChunk(vox::VoxelMesh *mesh) {
-  MaskNode mask[32][32];
+      for (uint32_t bits = rows[j]; bits; bits &= bits - 1) {
+        const uint32_t i = uint32_t(__builtin_ctz(bits));
+        uint32_t ao = 0;
+        for (uint32_t corner = 0; corner < 4; corner++) {
+          const uint32_t occluders = ((low[corner] >> i) & 1u) | ((high[corner] >> i) & 1u) << 1;
+          ao |= (3u - occluders) << (2 * corner);
+        }
+        faces.ao[d][j][i] = uint8_t(ao);
+      }
 
-  for (int dim = 0; dim < 3; dim++) {
-    for (int i = 0; i < 32; i++) {
-      for (int j = 0; j < 32; j++) {
-        mask[i][j].frontFace = false;
-        mask[i][j].backFace = false;
+      faces.mergeable[d][j] = 0;
+      for (uint32_t bits = rows[j] & (rows[j] << 1); bits; bits &= bits - 1) {
+        const uint32_t i = uint32_t(__builtin_ctz(bits));
+        const uint8_t ao = faces.ao[d][j][i];
+        if (ao == faces.ao[d][j][i - 1] && IsUniformAO(ao) &&
+            std::equal(faces.colors[j][i], faces.colors[j][i] + 3, faces.colors[j][i - 1]))
+          faces.mergeable[d][j] |= 1u << i;
       }
     }
+  }
+}
+
+/// Same scan order and rectangle splitting as BuildFacesFromMask, so the quads come out
+/// identical, but runs of equal faces are measured with one ctz per row.
+void ChunkMesher::MergeSliceFaces(vox::VoxelMesh *mesh, uint32_t dim, uint32_t slice,
+                                  SliceFaces &faces, bool frontFace) {
+  struct ScanRect {
+    int x, y, x2, y2;
+  };
+
+  uint32_t *rows = frontFace ? faces.front : faces.back;
+  const uint32_t *mergeable = faces.mergeable[frontFace ? 0 : 1];
+  const uint8_t (*faceAO)[32] = faces.ao[frontFace ? 0 : 1];
+
+  // Length of the run of faces with the given color and AO starting at cell i of row j, up to x2.
+  auto runLength = [&](int j, int i, int x2, const uint8_t color[3], uint8_t ao) {
+    if (!((rows[j] >> i) & 1u) || faceAO[j][i] != ao ||
+        !std::equal(color, color + 3, faces.colors[j][i]))
+      return 0;
+    const int faceRun = __builtin_ctzll(~(uint64_t(rows[j]) >> i));
+    const int colorRun = 1 + __builtin_ctzll(~(uint64_t(mergeable[j]) >> (i + 1)));
+    return std::min({faceRun, colorRun, x2 - i + 1});
+  };
+
+  // Every quad pops one rectangle and pushes at most three.
+  ScanRect scanArea[2 * 32 * 32 + 1];
+  int scanCount = 0;
+  scanArea[scanCount++] = {0, 0, 31, 31};
 
-    for (int z = 0; z < 32; z++) {
-      BuildSliceMask(dim, z, mask);
-      BuildFacesFromMask(mesh, dim, z, mask, true);
-      BuildFacesFromMask(mesh, dim, z, mask, false);
+  uint8_t color[3];
+
+  while (scanCount != 0) {
+    const ScanRect r = scanArea[--scanCount];
+    const uint32_t columns = ChunkOccupancy::RangeMask(r.x, r.x2);
+
+    for (int j = r.y; j <= r.y2; j++) {
+      const uint32_t bits = rows[j] & columns;
+      if (!bits)
+        continue;
+
+      const int i = __builtin_ctz(bits);
+      std::copy(faces.colors[j][i], faces.colors[j][i] + 3, color);
+      const uint8_t ao = faceAO[j][i];
+
+      int l = 1, h = 1;
+      if (IsUniformAO(ao)) {
+        l = runLength(j, i, r.x2, color, ao);
+        while (j + h <= 31 && runLength(j + h, i, 31, color, ao) >= l)
+          h++;
+      }
+
+      if (j + h <= r.y2) /// bot one
+        scanArea[scanCount++] = {r.x, j + h, r.x2, r.y2};
+      if (r.x <= i - 1 && h > 1) /// left one
+        scanArea[scanCount++] = {r.x, j + 1, i - 1, j + h - 1};
+      if (i + l <= r.x2) /// right one
+        scanArea[scanCount++] = {i + l, j, r.x2, j + h - 1};
+
+      AddFaceToMesh(mesh, frontFace, (FacePlane)dim, slice, glm::ivec2(i, j), glm::ivec2(l, h),
+                    color, ao);
+
+      const uint32_t quadColumns = ChunkOccupancy::RangeMask(i, i + l - 1);
+      for (int k = j; k < j + h; k++)
+        rows[k] &= ~quadColumns;
+      break;
     }
   }
 }
 
-void ChunkMesher::BuildChunk(core::Vector<VoxNode>::iterator begin, core::Vector<VoxNode>::iterator end, VoxelMesh* voxMesh) {
-  if(begin == end){
+void ChunkMesher::MeshSlice(vox::VoxelMesh *mesh, uint32_t dim, uint32_t slice) {
+  mesh->SliceQuadStart[dim * 32 + slice] = mesh->GetQuadCount();
+
+  if (m_mode == EMode::Greedy) {
+    MaskNode mask[32][32];
+    BuildSliceMask(dim, slice, mask);
+    BuildFacesFromMask(mesh, dim, slice, mask, true);
+    BuildFacesFromMask(mesh, dim, slice, mask, false);
     return;
   }
 
-  ClearBuildNodes();
+  SliceFaces faces;
+  BuildSliceFaces(dim, slice, faces);
+  MergeSliceFaces(mesh, dim, slice, faces, true);
+  MergeSliceFaces(mesh, dim, slice, faces, false);
+}
 
-  uint32_t x, y, z;
-  while(true){
-    auto& chunkNode = *begin;
-    decodeMK(chunkNode.start & LOCAL_VOXEL_MASK, x, y, z);
+void ChunkMesher::BuildChunk(core::Vector<VoxNode>::iterator begin, core::Vector<VoxNode>::iterator end, VoxelMesh* voxMesh,
+                             const ChunkApron &apron) {
+  if(begin == end){
+    return;
+  }
 
-    ASSERT(x<32 && y<32 && z<32, core::string::format("node x=<{}>, y=<{}>, z=<{}>", x,y,z));
+  LoadChunk(begin, end, apron);
 
-    auto & buildNode = m_buildNodes[x][y][z];
-    buildNode.start = chunkNode.start & LOCAL_VOXEL_MASK;
-    buildNode.r = chunkNode.r;
-    buildNode.g = chunkNode.g;
-    buildNode.b = chunkNode.b;
-    buildNode.size = chunkNode.size;
-    begin++;
+  for (uint32_t dim = 0; dim < 3; dim++)
+    for (uint32_t slice = 0; slice < 32; slice++)
+      MeshSlice(voxMesh, dim, slice);
+  voxMesh->SliceQuadStart[VoxelMesh::SliceCount] = voxMesh->GetQuadCount();
+}
 
-    if(begin == end)
-    {
-      break;
+void ChunkMesher::LoadChunk(core::Vector<VoxNode>::iterator begin,
+                            core::Vector<VoxNode>::iterator end, const ChunkApron &apron) {
+  ClearBuildNodes();
+  m_apron = apron;
+
+  static constexpr uint32_t DecodeBlockSize = 256;
+  uint32_t keys[DecodeBlockSize], xs[DecodeBlockSize], ys[DecodeBlockSize], zs[DecodeBlockSize];
+  const VoxNode *blockNodes[DecodeBlockSize];
+  uint32_t count = 0;
+
+  auto flushBlock = [&]() {
+    // Also keeps the compiler from seeing a read of keys before anything was stored in it.
+    if (count == 0)
+      return;
+    morton::DecodeMany(keys, xs, ys, zs, count);
+    for (uint32_t i = 0; i < count; i++)
+      SetBuildNode(xs[i], ys[i], zs[i], *blockNodes[i]);
+    count = 0;
+  };
+
+  for (; begin != end; begin++) {
+    const VoxNode &chunkNode = *begin;
+    if (chunkNode.IsTombstone() || chunkNode.size == 0)
+      continue;
+
+    const uint32_t local = chunkNode.start & LOCAL_VOXEL_MASK;
+    if (chunkNode.size == 1) {
+      keys[count] = local;
+      blockNodes[count++] = &chunkNode;
+      if (count == DecodeBlockSize)
+        flushBlock();
+      continue;
+    }
+
+    // a span covers consecutive keys, decode it as a range, clipped to this chunk
+    const uint32_t spanSize = std::min(chunkNode.size, VOXELS_IN_CHUNK - local);
+    for (uint32_t done = 0; done < spanSize; done += DecodeBlockSize) {
+      const uint32_t blockSize = std::min(DecodeBlockSize, spanSize - done);
+      morton::DecodeRange(local + done, xs, ys, zs, blockSize);
+      for (uint32_t i = 0; i < blockSize; i++)
+        SetBuildNode(xs[i], ys[i], zs[i], chunkNode);
     }
   }
+  flushBlock();
+}
 
-  GreedyBuildChunk(voxMesh);
+void ChunkMesher::UpdateVoxel(VoxelMesh *mesh, glm::ivec3 cell, const VoxNode *node) {
+  const glm::uvec3 c(cell);
+  if (c.x < 32 && c.y < 32 && c.z < 32) {
+    if (node)
+      SetBuildNode(c.x, c.y, c.z, *node);
+    else
+      ResetBuildNode(c.x, c.y, c.z);
+  } else {
+    SetApronCell(c.x, c.y, c.z, node != nullptr);
+  }
+
+  // A face plane sees the cell in its own slice and in the slices on either side of it. Apron
+  // cells only lie in the border slice of the plane facing them.
+  VoxelMesh patch(nullptr, mesh->GetVertexFormat());
+  for (uint32_t dim = 0; dim < 3; dim++) {
+    const uint32_t axis = 2 - dim;
+    if (c[(axis + 1) % 3] >= 32 || c[(axis + 2) % 3] >= 32)
+      continue;
+
+    for (int32_t slice = std::max(cell[axis] - 1, 0); slice <= std::min(cell[axis] + 1, 31);
+         slice++) {
+      patch.Clear();
+      MeshSlice(&patch, dim, uint32_t(slice));
+      mesh->ReplaceSliceQuads(dim * 32 + uint32_t(slice), patch);
+    }
+  }
 }
 
 }
\ No newline at end of file
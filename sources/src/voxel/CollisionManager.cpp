@@ -3,24 +3,27 @@
 #include "voxel/CollisionInfo.h"
 #include "voxel/MortonOctree.h"
 #include "voxel/Morton.h"
+#include "voxel/VoxelUtils.h"
 #include "util/Numeric.h"
 #include <glm/common.hpp>
 #include <glm/gtx/norm.hpp>
 
 namespace vox {
 
-CollisionManager::CollisionManager(core::SharedPtr<MortonOctree> octree) {
+template <class TKey>
+BasicCollisionManager<TKey>::BasicCollisionManager(core::SharedPtr<Octree> octree) {
   m_octree = octree;
-  Depth = OCTREE_DEPTH;
+  Depth = MortonTraits<TKey>::BitsPerAxis;
 }
 
-CollisionManager::~CollisionManager() {
+template <class TKey> BasicCollisionManager<TKey>::~BasicCollisionManager() {
 }
 
-bool CollisionManager::CheckCollision(const glm::vec3 &bmin,
-                                      const glm::vec3 &bmax,
-                                      const glm::vec3 &rayStart,
-                                      const glm::vec3 &rayDirectionInverse) {
+template <class TKey>
+bool BasicCollisionManager<TKey>::CheckCollision(const glm::vec3 &bmin,
+                                                 const glm::vec3 &bmax,
+                                                 const glm::vec3 &rayStart,
+                                                 const glm::vec3 &rayDirectionInverse) {
 
 
   double tx1 = (bmin.x - rayStart.x) * rayDirectionInverse.x;
@@ -44,15 +47,13 @@ bool CollisionManager::CheckCollision(const glm::vec3 &bmin,
   return tmax >= std::max(0.0, tmin) && tmin < std::numeric_limits<float>::max();
 }
 
-bool CollisionManager::CheckCollision(
+template <class TKey> bool BasicCollisionManager<TKey>::CheckCollision(
     const core::AxisAlignedBoundingBox &aabb) {
-  core::Vector<VoxNode> &m_nodes = m_octree->GetNodes();
-
   auto clamp = [](float &x) {
     if (x < 0)
       x = 0;
-    else if (x > 1023)
-      x = 1023;
+    else if (x > MortonTraits<TKey>::MaxCoordinate)
+      x = MortonTraits<TKey>::MaxCoordinate;
   };
   auto clampVec = [&clamp](glm::vec3 &x) {
     clamp(x.x);
@@ -65,61 +66,29 @@ bool CollisionManager::CheckCollision(
   clampVec(min);
   clampVec(max);
 
-  uint32_t mortonMin = encodeMK(min.x, min.y, min.z);
-  uint32_t mortonMax = encodeMK(max.x, max.y, max.z);
-
-  auto low = std::lower_bound(m_nodes.begin(), m_nodes.end(), VoxNode(mortonMin));
-  auto hi = std::lower_bound(m_nodes.begin(), m_nodes.end(), VoxNode(mortonMax));
-
-  if (hi != m_nodes.end())
-    hi++;
-
-  uint32_t nodeCount = 0;
-  uint32_t x, y, z;
-  for (; low != hi && low != m_nodes.end(); low++) {
-    nodeCount++;
-    decodeMK(low->start, x, y, z);
-    if (aabb.IntersectsWith(glm::vec3(x, y, z),
-                            glm::vec3(x + 1, y + 1, z + 1))) {
-      std::cout << "Nodes queried: " << nodeCount << std::endl;
-      return true;
+  // Reads the chunk occupancy bitsets instead of the nodes, so spans need no special case. A
+  // chunk column holds 32 cells along y, so the y range is tested a word at a time.
+  const uint32_t yEnd = uint32_t(std::ceil(max.y));
+  for (uint32_t z = min.z; z < max.z; z++) {
+    for (uint32_t x = min.x; x < max.x; x++) {
+      for (uint32_t y = min.y; y < yEnd; y = (y | 31) + 1) {
+        const uint32_t last = std::min(yEnd - 1, y | 31);
+        const TKey key = MortonTraits<TKey>::Encode(x, y, z);
+        const ChunkOccupancy *occupancy =
+            m_octree->GetChunkOccupancy(utils::GetChunkIndex<TKey>(key));
+        if (occupancy &&
+            (occupancy->Column(x & 31, z & 31) & ChunkOccupancy::RangeMask(y & 31, last & 31)))
+          return true;
+      }
     }
   }
 
-  // std::cout<<"Nodes queried: " << nodeCount << std::endl;
   return false;
 }
 
-bool CollisionManager::CheckCollisionB(
+template <class TKey> bool BasicCollisionManager<TKey>::CheckCollisionB(
     const core::AxisAlignedBoundingBox &aabb) {
-  return false;
-  core::Vector<VoxNode> &m_nodes = m_octree->GetNodes();
-
-  auto clamp = [](float &x) {
-    if (x < 0)
-      x = 0;
-    else if (x > 1023)
-      x = 1023;
-  };
-  auto clampVec = [&clamp](glm::vec3 &x) {
-    clamp(x.x);
-    clamp(x.y);
-    clamp(x.z);
-  };
-
-  glm::vec3 min = aabb.GetMin(), max = aabb.GetMax();
-
-  clampVec(min);
-  clampVec(max);
-
-  for (uint32_t z = min.z; z < max.z; z++)
-    for (uint32_t y = min.y; y < max.y; y++)
-      for (uint32_t x = min.x; x < max.x; x++)
-        if (std::binary_search(m_nodes.begin(), m_nodes.end(),
-                               VoxNode(x, y, z)))
-          return true;
-
-  return false;
+  return CheckCollision(aabb);
 }
 
 static inline core::AxisAlignedBoundingBox
@@ -130,9 +99,10 @@ BroadphaseAABB(const core::AxisAlignedBoundingBox &box, const glm::vec3 &vel) {
   return core::AxisAlignedBoundingBox(center, size);
 }
 
-core::Vector<AABBCollisionInfo>
-CollisionManager::CheckCollisionSwept(const core::AxisAlignedBoundingBox &aabb,
-                                      const glm::vec3 &vel) {
+template <class TKey>
+core::Vector<BasicAABBCollisionInfo<TKey>>
+BasicCollisionManager<TKey>::CheckCollisionSwept(const core::AxisAlignedBoundingBox &aabb,
+                                                 const glm::vec3 &vel) {
   return core::Vector<AABBCollisionInfo>();
   /*auto printAABB = [](const std::string & name, const AABB & bb)
   {
@@ -142,15 +112,13 @@ CollisionManager::CheckCollisionSwept(const core::AxisAlignedBoundingBox &aabb,
   name.c_str(), mi.x, mi.y, mi.z, mx.x, mx.y, mx.z);
   };*/
 
-  core::Vector<VoxNode> &m_nodes = m_octree->GetNodes();
-
   core::Vector<AABBCollisionInfo> infoVec;
 
   auto clamp = [](float &x) {
     if (x < 0)
       x = 0;
-    else if (x > 1023)
-      x = 1023;
+    else if (x > MortonTraits<TKey>::MaxCoordinate)
+      x = MortonTraits<TKey>::MaxCoordinate;
   };
 
   auto clampVec = [&clamp](glm::vec3 &x) {
@@ -168,59 +136,67 @@ CollisionManager::CheckCollisionSwept(const core::AxisAlignedBoundingBox &aabb,
 
   glm::vec3 normalOut;
 
-  for (uint32_t z = min.z; z < max.z; z++)
-    for (uint32_t y = min.y; y < max.y; y++)
-      for (uint32_t x = min.x; x < max.x; x++)
-        if (std::binary_search(m_nodes.begin(), m_nodes.end(),
-                               VoxNode(x, y, z))) {
+  TKey zKey = MortonTraits<TKey>::Encode(min.x, min.y, min.z);
+  for (uint32_t z = min.z; z < max.z; z++, zKey = MortonAddZ(zKey)) {
+    TKey yKey = zKey;
+    for (uint32_t y = min.y; y < max.y; y++, yKey = MortonAddY(yKey)) {
+      TKey key = yKey;
+      for (uint32_t x = min.x; x < max.x; x++, key = MortonAddX(key))
+        if (m_octree->CheckNode(key)) {
           core::AxisAlignedBoundingBox b1(glm::vec3(x + 0.5, y + 0.5, z + 0.5),
                                           glm::vec3(0.5, 0.5, 0.5));
           AABBCollisionInfo info;
           info.time = aabb.SweepCollidesWith(b1, vel, normalOut);
 
           if (info.time != 1.0f) {
-            info.voxelMK = encodeMK(x, y, z);
+            info.voxelMK = key;
             info.normal = normalOut;
             infoVec.push_back(info);
           }
         }
+    }
+  }
   return infoVec;
 }
 
-void CollisionManager::Collide(CollisionInfo &colInfo) {
-  Collide(colInfo, 0, glm::ivec3(0,0,0));
+template <class TKey> void BasicCollisionManager<TKey>::Collide(CollisionInfo &colInfo) {
+  const Occupancy &occupancy = m_octree->GetOccupancy();
+  Collide(colInfo, 0, glm::ivec3(0,0,0), occupancy, occupancy.Root());
 }
 
-void CollisionManager::Collide(CollisionInfo &colInfo, uint32_t depthLevel,
-                               const glm::ivec3 &octStart) {
+template <class TKey>
+void BasicCollisionManager<TKey>::Collide(CollisionInfo &colInfo, uint32_t depthLevel,
+                                          const glm::ivec3 &octStart, const Occupancy &occupancy,
+                                          const typename Occupancy::Cell &cell) {
+  if (cell.state == Occupancy::EState::Empty)
+    return;
+
   glm::vec3 octreeSearchStart(octStart.x, octStart.y, octStart.z);
-  glm::vec3 octreeSearchEnd = octreeSearchStart + glm::vec3(SIZE_TABLE[depthLevel]);
+  glm::vec3 octreeSearchEnd = octreeSearchStart + glm::vec3(float(1u << (Depth - depthLevel)));
 
   if (CheckCollision(octStart, octreeSearchEnd,
     colInfo.rayStart, colInfo.rayInverseDirection)) {
     if (depthLevel == Depth) {
       const float dist = glm::distance2(colInfo.rayStart, octreeSearchStart);
+      if (dist <= 0 || dist >= colInfo.nearestDistance)
+        return;
 
-      if (dist > 0 && dist < colInfo.nearestDistance &&
-          m_octree->CheckNode(octStart.x, octStart.y, octStart.z)) {
-        colInfo.nearestDistance = dist;
-        colInfo.node.start = encodeMK(octStart.x, octStart.y, octStart.z);
-        colInfo.node.size = 1;
-      }
+      // A non-empty voxel cell is solid, no lookup needed.
+      colInfo.nearestDistance = dist;
+      colInfo.node.start = MortonTraits<TKey>::Encode(octStart.x, octStart.y, octStart.z);
+      colInfo.node.size = 1;
       return;
     }
 
     depthLevel += 1;
-    const uint32_t size = SIZE_TABLE[depthLevel];
-    Collide(colInfo, depthLevel, octStart);
-    Collide(colInfo, depthLevel, octStart + glm::ivec3(size, 0, 0));
-    Collide(colInfo, depthLevel, octStart + glm::ivec3(size, 0, size));
-    Collide(colInfo, depthLevel, octStart + glm::ivec3(0, 0, size));
-
-    Collide(colInfo, depthLevel, octStart + glm::ivec3(0, size, 0));
-    Collide(colInfo, depthLevel, octStart + glm::ivec3(size, size, 0));
-    Collide(colInfo, depthLevel, octStart + glm::ivec3(size, size, size));
-    Collide(colInfo, depthLevel, octStart + glm::ivec3(0, size, size));
+    const int32_t size = int32_t(1u << (Depth - depthLevel));
+    // Same visiting order as before, the child index is x | y << 1 | z << 2.
+    static const uint32_t childOrder[] = {0b000, 0b001, 0b101, 0b100, 0b010, 0b011, 0b111, 0b110};
+    for (uint32_t child : childOrder) {
+      const glm::ivec3 offset((child & 1) ? size : 0, (child & 2) ? size : 0,
+                              (child & 4) ? size : 0);
+      Collide(colInfo, depthLevel, octStart + offset, occupancy, occupancy.Child(cell, child));
+    }
   }
 }
 
@@ -258,9 +234,10 @@ static bool IsRayIntersectingTriangle(glm::vec3 a, glm::vec3 b, glm::vec3 c,
   return t > util::numeric::FloatingPointRoundingError;
 }
 
-VoxelSide CollisionManager::GetCollisionSide(glm::vec3 voxPos,
-                                             glm::vec3 rayStart,
-                                             glm::vec3 rayDirection) {
+template <class TKey>
+VoxelSide BasicCollisionManager<TKey>::GetCollisionSide(glm::vec3 voxPos,
+                                                        glm::vec3 rayStart,
+                                                        glm::vec3 rayDirection) {
   static glm::vec3 up(0, 1, 0), down(0, -1, 0), front(0, 0, 1), back(0, 0, -1),
       left(-1, 0, 0), right(1, 0, 0);
 
@@ -318,4 +295,7 @@ VoxelSide CollisionManager::GetCollisionSide(glm::vec3 voxPos,
 
   return side;
 }
-}
\ No newline at end of file
+
+template class BasicCollisionManager<uint32_t>;
+template class BasicCollisionManager<uint64_t>;
+}
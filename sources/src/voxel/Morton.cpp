@@ -0,0 +1,85 @@
+#include "voxel/Morton.h"
+
+#if VOX_MORTON_HAS_BMI2
+#include <cpuid.h>
+#endif
+
+namespace vox::morton {
+namespace {
+bool CpuHasBMI2()
+{
+#if VOX_MORTON_HAS_BMI2
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("bmi2");
+#else
+  return false;
+#endif
+}
+
+bool CpuHasFastPdep()
+{
+#if VOX_MORTON_HAS_BMI2
+  uint32_t eax, ebx, ecx, edx;
+  if (!__get_cpuid(0, &eax, &ebx, &ecx, &edx))
+  {
+    return false;
+  }
+
+  const bool isAmd = ebx == 0x68747541u && edx == 0x69746e65u && ecx == 0x444d4163u;
+  if (!isAmd)
+  {
+    return true;
+  }
+
+  __get_cpuid(1, &eax, &ebx, &ecx, &edx);
+  const uint32_t family = ((eax >> 8u) & 0xfu) + ((eax >> 20u) & 0xffu);
+  return family >= 0x19u;
+#else
+  return false;
+#endif
+}
+} // namespace
+
+ECodec ActiveCodec = DetectCodec();
+
+ECodec DetectCodec()
+{
+  if (CpuHasBMI2() && CpuHasFastPdep())
+  {
+    return ECodec::BMI2;
+  }
+
+  return ECodec::LookupTable;
+}
+
+bool IsCodecSupported(ECodec codec)
+{
+  return codec != ECodec::BMI2 || CpuHasBMI2();
+}
+
+bool SetCodec(ECodec codec)
+{
+  if (!IsCodecSupported(codec))
+  {
+    return false;
+  }
+
+  ActiveCodec = codec;
+  return true;
+}
+
+const char* GetCodecName(ECodec codec)
+{
+  switch (codec)
+  {
+  case ECodec::LookupTable:
+    return "LookupTable";
+  case ECodec::MagicBits:
+    return "MagicBits";
+  case ECodec::BMI2:
+    return "BMI2";
+  }
+
+  return "Unknown";
+}
+} // namespace vox::morton
@@ -0,0 +1,197 @@
+#include "voxel/MortonBatch.h"
+#include <immintrin.h>
+
+namespace vox::morton {
+namespace {
+inline __m128i SplitBy3(__m128i a)
+{
+  a = _mm_and_si128(a, _mm_set1_epi32(0x000003ff));
+  a = _mm_and_si128(_mm_or_si128(a, _mm_slli_epi32(a, 16)), _mm_set1_epi32(0x030000ff));
+  a = _mm_and_si128(_mm_or_si128(a, _mm_slli_epi32(a, 8)), _mm_set1_epi32(0x0300f00f));
+  a = _mm_and_si128(_mm_or_si128(a, _mm_slli_epi32(a, 4)), _mm_set1_epi32(0x030c30c3));
+  a = _mm_and_si128(_mm_or_si128(a, _mm_slli_epi32(a, 2)), _mm_set1_epi32(0x09249249));
+  return a;
+}
+
+inline __m128i CompactBy3(__m128i a)
+{
+  a = _mm_and_si128(a, _mm_set1_epi32(0x09249249));
+  a = _mm_and_si128(_mm_or_si128(a, _mm_srli_epi32(a, 2)), _mm_set1_epi32(0x030c30c3));
+  a = _mm_and_si128(_mm_or_si128(a, _mm_srli_epi32(a, 4)), _mm_set1_epi32(0x0300f00f));
+  a = _mm_and_si128(_mm_or_si128(a, _mm_srli_epi32(a, 8)), _mm_set1_epi32(0x030000ff));
+  a = _mm_and_si128(_mm_or_si128(a, _mm_srli_epi32(a, 16)), _mm_set1_epi32(0x000003ff));
+  return a;
+}
+
+inline void DecodeBlock(__m128i keys, uint32_t* x, uint32_t* y, uint32_t* z)
+{
+  _mm_storeu_si128((__m128i*)x, CompactBy3(keys));
+  _mm_storeu_si128((__m128i*)y, CompactBy3(_mm_srli_epi32(keys, 1)));
+  _mm_storeu_si128((__m128i*)z, CompactBy3(_mm_srli_epi32(keys, 2)));
+}
+
+__attribute__((target("avx2"))) inline __m256i SplitBy3(__m256i a)
+{
+  a = _mm256_and_si256(a, _mm256_set1_epi32(0x000003ff));
+  a = _mm256_and_si256(_mm256_or_si256(a, _mm256_slli_epi32(a, 16)),
+                       _mm256_set1_epi32(0x030000ff));
+  a = _mm256_and_si256(_mm256_or_si256(a, _mm256_slli_epi32(a, 8)),
+                       _mm256_set1_epi32(0x0300f00f));
+  a = _mm256_and_si256(_mm256_or_si256(a, _mm256_slli_epi32(a, 4)),
+                       _mm256_set1_epi32(0x030c30c3));
+  a = _mm256_and_si256(_mm256_or_si256(a, _mm256_slli_epi32(a, 2)),
+                       _mm256_set1_epi32(0x09249249));
+  return a;
+}
+
+__attribute__((target("avx2"))) inline __m256i CompactBy3(__m256i a)
+{
+  a = _mm256_and_si256(a, _mm256_set1_epi32(0x09249249));
+  a = _mm256_and_si256(_mm256_or_si256(a, _mm256_srli_epi32(a, 2)),
+                       _mm256_set1_epi32(0x030c30c3));
+  a = _mm256_and_si256(_mm256_or_si256(a, _mm256_srli_epi32(a, 4)),
+                       _mm256_set1_epi32(0x0300f00f));
+  a = _mm256_and_si256(_mm256_or_si256(a, _mm256_srli_epi32(a, 8)),
+                       _mm256_set1_epi32(0x030000ff));
+  a = _mm256_and_si256(_mm256_or_si256(a, _mm256_srli_epi32(a, 16)),
+                       _mm256_set1_epi32(0x000003ff));
+  return a;
+}
+
+__attribute__((target("avx2"))) inline void DecodeBlock(__m256i keys, uint32_t* x, uint32_t* y,
+                                                         uint32_t* z)
+{
+  _mm256_storeu_si256((__m256i*)x, CompactBy3(keys));
+  _mm256_storeu_si256((__m256i*)y, CompactBy3(_mm256_srli_epi32(keys, 1)));
+  _mm256_storeu_si256((__m256i*)z, CompactBy3(_mm256_srli_epi32(keys, 2)));
+}
+
+size_t EncodeManySSE(const uint32_t* x, const uint32_t* y, const uint32_t* z, uint32_t* keys,
+                     size_t count)
+{
+  size_t i = 0;
+  for (; i + 4 <= count; i += 4)
+  {
+    __m128i kx = SplitBy3(_mm_loadu_si128((const __m128i*)(x + i)));
+    __m128i ky = SplitBy3(_mm_loadu_si128((const __m128i*)(y + i)));
+    __m128i kz = SplitBy3(_mm_loadu_si128((const __m128i*)(z + i)));
+    __m128i k  = _mm_or_si128(kx, _mm_or_si128(_mm_slli_epi32(ky, 1), _mm_slli_epi32(kz, 2)));
+    _mm_storeu_si128((__m128i*)(keys + i), k);
+  }
+  return i;
+}
+
+size_t DecodeManySSE(const uint32_t* keys, uint32_t* x, uint32_t* y, uint32_t* z, size_t count)
+{
+  size_t i = 0;
+  for (; i + 4 <= count; i += 4)
+  {
+    DecodeBlock(_mm_loadu_si128((const __m128i*)(keys + i)), x + i, y + i, z + i);
+  }
+  return i;
+}
+
+size_t DecodeRangeSSE(uint32_t firstKey, uint32_t* x, uint32_t* y, uint32_t* z, size_t count)
+{
+  const __m128i step = _mm_set1_epi32(4);
+  __m128i       k    = _mm_add_epi32(_mm_set1_epi32(firstKey), _mm_setr_epi32(0, 1, 2, 3));
+
+  size_t i = 0;
+  for (; i + 4 <= count; i += 4)
+  {
+    DecodeBlock(k, x + i, y + i, z + i);
+    k = _mm_add_epi32(k, step);
+  }
+  return i;
+}
+
+__attribute__((target("avx2"))) size_t EncodeManyAVX2(const uint32_t* x, const uint32_t* y,
+                                                       const uint32_t* z, uint32_t* keys,
+                                                       size_t count)
+{
+  size_t i = 0;
+  for (; i + 8 <= count; i += 8)
+  {
+    __m256i kx = SplitBy3(_mm256_loadu_si256((const __m256i*)(x + i)));
+    __m256i ky = SplitBy3(_mm256_loadu_si256((const __m256i*)(y + i)));
+    __m256i kz = SplitBy3(_mm256_loadu_si256((const __m256i*)(z + i)));
+    __m256i k  = _mm256_or_si256(
+        kx, _mm256_or_si256(_mm256_slli_epi32(ky, 1), _mm256_slli_epi32(kz, 2)));
+    _mm256_storeu_si256((__m256i*)(keys + i), k);
+  }
+  return i;
+}
+
+__attribute__((target("avx2"))) size_t DecodeManyAVX2(const uint32_t* keys, uint32_t* x,
+                                                       uint32_t* y, uint32_t* z, size_t count)
+{
+  size_t i = 0;
+  for (; i + 8 <= count; i += 8)
+  {
+    DecodeBlock(_mm256_loadu_si256((const __m256i*)(keys + i)), x + i, y + i, z + i);
+  }
+  return i;
+}
+
+__attribute__((target("avx2"))) size_t DecodeRangeAVX2(uint32_t firstKey, uint32_t* x,
+                                                        uint32_t* y, uint32_t* z, size_t count)
+{
+  const __m256i step = _mm256_set1_epi32(8);
+  __m256i       k    = _mm256_add_epi32(_mm256_set1_epi32(firstKey),
+                                        _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+
+  size_t i = 0;
+  for (; i + 8 <= count; i += 8)
+  {
+    DecodeBlock(k, x + i, y + i, z + i);
+    k = _mm256_add_epi32(k, step);
+  }
+  return i;
+}
+
+bool DetectAVX2()
+{
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("avx2");
+}
+
+const bool HasAVX2 = DetectAVX2();
+} // namespace
+
+bool IsAVX2Enabled()
+{
+  return HasAVX2;
+}
+
+void EncodeMany(const uint32_t* x, const uint32_t* y, const uint32_t* z, uint32_t* keys,
+                size_t count)
+{
+  size_t i = HasAVX2 ? EncodeManyAVX2(x, y, z, keys, count) : EncodeManySSE(x, y, z, keys, count);
+
+  for (; i < count; i++)
+  {
+    keys[i] = EncodeMagicBits(x[i], y[i], z[i]);
+  }
+}
+
+void DecodeMany(const uint32_t* keys, uint32_t* x, uint32_t* y, uint32_t* z, size_t count)
+{
+  size_t i = HasAVX2 ? DecodeManyAVX2(keys, x, y, z, count) : DecodeManySSE(keys, x, y, z, count);
+
+  for (; i < count; i++)
+  {
+    DecodeMagicBits(keys[i], x[i], y[i], z[i]);
+  }
+}
+
+void DecodeRange(uint32_t firstKey, uint32_t* x, uint32_t* y, uint32_t* z, size_t count)
+{
+  size_t i = HasAVX2 ? DecodeRangeAVX2(firstKey, x, y, z, count)
+                     : DecodeRangeSSE(firstKey, x, y, z, count);
+
+  for (; i < count; i++)
+  {
+    DecodeMagicBits(firstKey + i, x[i], y[i], z[i]);
+  }
+}
+} // namespace vox::morton
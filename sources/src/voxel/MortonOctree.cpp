@@ -1,128 +1,552 @@
 #include "voxel/MortonOctree.h"
 #include "voxel/Morton.h"
 #include "voxel/VoxNode.h"
+#include "voxel/VoxelUtils.h"
 #include <util/Bit.h>
 
-namespace {
-inline bool NodeSortPredicate(const vox::VoxNode &i, const vox::VoxNode &j) {
-  return (i.start < j.start);
-}
+namespace vox {
+template <class TKey, class TStorage>
+void BasicMortonOctree<TKey, TStorage>::AddNode(Node node) {
+  // Cut the new span out of its neighbors, anything left inside it is replaced.
+  const TKey end = node.start + std::max(node.size, 1u);
+  SplitSpanAt(node.start);
+  SplitSpanAt(end);
+  m_occupancyDirty = true;
 
-inline bool ActiveNodeSortPredicate(const vox::VoxNode &i, const vox::VoxNode &j) {
-  return (i.size > 0 && j.size > 0 && i.start < j.start);
-}
+  size_t sortedEnd = std::min(m_sortedCount, m_nodes.size());
+  const size_t lb = LowerBound(0, sortedEnd, node.start);
+
+  size_t coveredEnd = lb;
+  for (; coveredEnd < sortedEnd && m_nodes.Key(coveredEnd) < end; coveredEnd++)
+    if (!IsTombstoneAt(coveredEnd))
+      MarkRemoved(coveredEnd);
+  // After the covered nodes, whose MarkRemoved clears the same bits. An empty node only clears
+  // its own key.
+  UpdateChunkOccupancy(node.start, std::max(node.size, 1u), node.size != 0);
+
+  // The first covered slot is reused below, the others are erased. A tombstone left inside the
+  // span would be found by FindNode in place of the span.
+  if (coveredEnd > lb + 1) {
+    m_nodes.Erase(lb + 1, coveredEnd);
+    m_tombstoneCount -= coveredEnd - lb - 1;
+    m_sortedCount -= coveredEnd - lb - 1;
+    sortedEnd -= coveredEnd - lb - 1;
+    InvalidateSearchIndex();
+    InvalidateChunkDirectory();
+  }
+
+  if (lb != sortedEnd && IsTombstoneAt(lb)) {
+    m_tombstoneCount--;
+    InsertIntoChunkDirectory(utils::GetChunkIndex<TKey>(node.start),
+                             utils::GetChunkIndex<TKey>(m_nodes.Key(lb)));
+    if (m_nodes.Key(lb) != node.start)
+      InvalidateSearchIndex();
+    m_nodes.Set(lb, node);
+    return;
+  }
 
-inline bool NodeEqualsPredicate(const vox::VoxNode &i, const vox::VoxNode &j) {
-  return (i.start == j.start);
+  InsertIntoChunkDirectory(utils::GetChunkIndex<TKey>(node.start), m_chunkLiveCounts.size());
+  m_nodes.Insert(lb, core::Move(node));
+  m_sortedCount++;
+  InvalidateSearchIndex();
 }
+
+template <class TKey, class TStorage>
+void BasicMortonOctree<TKey, TStorage>::AddNodes(core::Vector<Node> nodes) {
+  EditBatch batch;
+  batch.Edits.reserve(nodes.size());
+  for (auto &node : nodes)
+    batch.Edits.push_back({core::Move(node), EEditType::Add});
+
+  ApplyEdits(core::Move(batch));
 }
 
-namespace vox {
-void MortonOctree::AddNode(VoxNode node) {
-  auto lb = std::lower_bound(m_nodes.begin(), m_nodes.end(), VoxNode(node.start));
+template <class TKey, class TStorage>
+void BasicMortonOctree<TKey, TStorage>::ApplyEdits(EditBatch batch) {
+  auto &edits = batch.Edits;
+  if (edits.empty())
+    return;
 
-  if(lb != m_nodes.end()){
-    if(lb->size == -1) {
-      lb->Assign(node);
-    }
-    else{
-      m_nodes.insert(lb, core::Move(node));
-    }
+  SortLeafNodes();
+  std::stable_sort(edits.begin(), edits.end(), [](const Edit &a, const Edit &b) {
+    return a.node.start < b.node.start;
+  });
+
+  // Unique over the reversed batch keeps the last edit of each key, packed at the back.
+  auto keyEquals = [](const Edit &a, const Edit &b) { return a.node.start == b.node.start; };
+  const auto first = std::unique(edits.rbegin(), edits.rend(), keyEquals).base();
+  auto editEnd = [](const Edit &e) { return e.node.start + std::max(e.node.size, 1u); };
+
+  // Split spans at the edit boundaries, so every edit covers whole nodes.
+  core::Vector<TKey> cuts;
+  cuts.reserve(2 * (edits.end() - first));
+  for (auto it = first; it != edits.end(); ++it) {
+    cuts.push_back(it->node.start);
+    cuts.push_back(editEnd(*it));
+  }
+  std::sort(cuts.begin(), cuts.end());
+  SplitSpans(cuts);
+
+  // Drop tombstones and every node touched by the batch, additions are merged back below.
+  auto edit = first;
+  size_t out = 0;
+  size_t addCount = 0;
+  for (size_t node = 0; node < m_nodes.size(); node++) {
+    const TKey key = m_nodes.Key(node);
+    while (edit != edits.end() && editEnd(*edit) <= key)
+      ++edit;
+    if (IsTombstoneAt(node) || (edit != edits.end() && edit->node.start <= key))
+      continue;
+    if (out != node)
+      m_nodes.MoveElement(node, out);
+    out++;
   }
-  else {
-    m_nodes.emplace_back(node);
+  m_tombstoneCount = 0;
+
+  for (edit = first; edit != edits.end(); ++edit)
+    addCount += edit->type == EEditType::Add;
+
+  // Merge from the back so every node moves at most once.
+  m_nodes.Resize(out + addCount);
+
+  size_t src = out;
+  size_t dst = m_nodes.size();
+  for (edit = edits.end(); edit != first;) {
+    --edit;
+    if (edit->type != EEditType::Add)
+      continue;
+
+    while (src > 0 && m_nodes.Key(src - 1) > edit->node.start)
+      m_nodes.MoveElement(--src, --dst);
+    m_nodes.Set(--dst, edit->node);
   }
+
+  m_sortedCount = m_nodes.size();
+  InvalidateSearchIndex();
+  InvalidateChunkDirectory();
+  m_occupancyDirty = true;
+  m_chunkOccupancyDirty = true;
 }
 
-void MortonOctree::Remove(VoxNode node) {
+template <class TKey, class TStorage>
+void BasicMortonOctree<TKey, TStorage>::Remove(Node node) {
   uint32_t x, y, z;
-  vox::decodeMK(node.start, x,y,z);
+  MortonTraits<TKey>::Decode(node.start, x, y, z);
   RemoveNode(x,y,z);
 }
 
-void MortonOctree::AddOrphanNode(VoxNode node) {
-  m_nodes.push_back(core::Move(node));
+template <class TKey, class TStorage>
+void BasicMortonOctree<TKey, TStorage>::AddOrphanNode(Node node) {
+  m_nodes.PushBack(core::Move(node));
+  InvalidateSearchIndex();
+  InvalidateChunkDirectory();
+  m_occupancyDirty = true;
+  m_chunkOccupancyDirty = true;
 }
 
-bool MortonOctree::IsSorted() {
-  return std::is_sorted(m_nodes.begin(), m_nodes.end(), NodeSortPredicate);
+template <class TKey, class TStorage> bool BasicMortonOctree<TKey, TStorage>::IsSorted() {
+  for (size_t i = 1; i < m_nodes.size(); i++)
+    if (m_nodes.Key(i) < m_nodes.Key(i - 1))
+      return false;
+  return true;
 }
 
-void MortonOctree::SortLeafNodes() {
-  std::sort(m_nodes.begin(), m_nodes.end(), NodeSortPredicate);
+template <class TKey, class TStorage> void BasicMortonOctree<TKey, TStorage>::SortLeafNodes() {
+  const size_t sortedEnd = std::min(m_sortedCount, m_nodes.size());
+  if (sortedEnd != m_nodes.size()) {
+    m_nodes.SortTail(sortedEnd);
+    InvalidateSearchIndex();
+    InvalidateChunkDirectory();
+  }
+
+  m_sortedCount = m_nodes.size();
 }
 
-void MortonOctree::RemoveDuplicateNodes() {
-  elog::LogError("void MortonOctree::RemoveDuplicateNodes() Not implemented");
+template <class TKey, class TStorage>
+void BasicMortonOctree<TKey, TStorage>::RemoveDuplicateNodes() {
+  SortLeafNodes();
+
+  // Sorting is stable, so the last node of each run is the most recent one.
+  size_t out = 0;
+  for (size_t i = 0; i < m_nodes.size(); i++) {
+    if (i + 1 < m_nodes.size() && m_nodes.Key(i + 1) == m_nodes.Key(i))
+      continue;
+    if (out != i)
+      m_nodes.MoveElement(i, out);
+    out++;
+  }
+  m_nodes.Resize(out);
+  InvalidateSearchIndex();
+  InvalidateChunkDirectory();
+  m_occupancyDirty = true;
+  m_chunkOccupancyDirty = true;
+
+  m_sortedCount = m_nodes.size();
+  m_tombstoneCount = 0;
+  for (size_t i = 0; i < m_nodes.size(); i++)
+    m_tombstoneCount += IsTombstoneAt(i);
+}
+
+template <class TKey, class TStorage> void BasicMortonOctree<TKey, TStorage>::Compact() {
+  if (m_tombstoneCount == 0)
+    return;
+
+  const size_t sortedEnd = std::min(m_sortedCount, m_nodes.size());
+  size_t out = 0;
+  for (size_t i = 0; i < m_nodes.size(); i++) {
+    if (i == sortedEnd)
+      m_sortedCount = out;
+    if (IsTombstoneAt(i))
+      continue;
+    if (out != i)
+      m_nodes.MoveElement(i, out);
+    out++;
+  }
+  if (sortedEnd == m_nodes.size())
+    m_sortedCount = out;
+
+  m_nodes.Resize(out);
+  m_tombstoneCount = 0;
+  InvalidateSearchIndex();
+  InvalidateChunkDirectory();
+}
+
+template <class TKey, class TStorage> bool BasicMortonOctree<TKey, TStorage>::CompactIfNeeded() {
+  if (m_tombstoneCount * TombstoneCompactionRatio <= m_nodes.size())
+    return false;
+
+  Compact();
+  return true;
+}
+
+template <class TKey, class TStorage>
+size_t BasicMortonOctree<TKey, TStorage>::GetTombstoneCount() const {
+  return m_tombstoneCount;
+}
+
+template <class TKey, class TStorage>
+void BasicMortonOctree<TKey, TStorage>::EnableSearchIndex(bool enable) {
+  m_searchIndexEnabled = enable;
+  InvalidateSearchIndex();
+}
+
+template <class TKey, class TStorage>
+void BasicMortonOctree<TKey, TStorage>::InvalidateSearchIndex() {
+  m_searchIndexDirty = true;
+  m_lookupsSinceEdit = 0;
+}
+
+template <class TKey, class TStorage>
+size_t BasicMortonOctree<TKey, TStorage>::LowerBound(size_t first, size_t last, TKey key) {
+  if (m_searchIndexEnabled && m_sortedCount == m_nodes.size()) {
+    if (m_searchIndexDirty && ++m_lookupsSinceEdit > m_nodes.size() / SearchIndexRebuildRatio) {
+      m_searchIndex.Build(m_nodes);
+      m_searchIndexDirty = false;
+    }
+
+    // Lower bound of a sorted subrange is the global lower bound clamped to it.
+    if (!m_searchIndexDirty)
+      return std::clamp(m_searchIndex.LowerBound(key), first, last);
+  }
+
+  return m_nodes.LowerBound(first, last, key);
+}
+
+template <class TKey, class TStorage>
+void BasicMortonOctree<TKey, TStorage>::InvalidateChunkDirectory() {
+  m_chunkDirectoryDirty = true;
+}
+
+template <class TKey, class TStorage>
+void BasicMortonOctree<TKey, TStorage>::UpdateChunkDirectory() {
+  SortLeafNodes();
+  if (!m_chunkDirectoryDirty)
+    return;
+
+  const size_t count = m_nodes.size();
+  const size_t chunkCount = count == 0 ? 0 : utils::GetChunkIndex<TKey>(m_nodes.Key(count - 1)) + 1;
+  m_chunkOffsets.assign(chunkCount + 1, 0);
+  m_chunkLiveCounts.assign(chunkCount, 0);
+
+  for (size_t i = 0; i < count; i++) {
+    const size_t chunk = utils::GetChunkIndex<TKey>(m_nodes.Key(i));
+    m_chunkOffsets[chunk + 1]++;
+    m_chunkLiveCounts[chunk] += !IsTombstoneAt(i);
+  }
+  std::partial_sum(m_chunkOffsets.begin(), m_chunkOffsets.end(), m_chunkOffsets.begin());
+  m_chunkDirectoryDirty = false;
 }
 
-bool MortonOctree::CheckNodeFloat(float x, float y, float z) {
+template <class TKey, class TStorage>
+void BasicMortonOctree<TKey, TStorage>::InsertIntoChunkDirectory(size_t chunk, size_t lastShifted) {
+  if (m_chunkDirectoryDirty)
+    return;
+
+  if (chunk >= m_chunkLiveCounts.size()) {
+    m_chunkOffsets.resize(chunk + 2, m_chunkOffsets.back());
+    m_chunkLiveCounts.resize(chunk + 1, 0);
+    lastShifted = chunk + 1;
+  }
+  for (size_t c = chunk + 1; c <= lastShifted; c++)
+    m_chunkOffsets[c]++;
+  m_chunkLiveCounts[chunk]++;
+}
+
+template <class TKey, class TStorage> size_t BasicMortonOctree<TKey, TStorage>::GetChunkCount() {
+  UpdateChunkDirectory();
+  return m_chunkLiveCounts.size();
+}
+
+template <class TKey, class TStorage>
+typename BasicMortonOctree<TKey, TStorage>::ChunkRange
+BasicMortonOctree<TKey, TStorage>::GetChunkRange(size_t chunk) {
+  UpdateChunkDirectory();
+  if (chunk >= m_chunkLiveCounts.size())
+    return {m_nodes.size(), m_nodes.size(), 0};
+
+  return {m_chunkOffsets[chunk], m_chunkOffsets[chunk + 1], m_chunkLiveCounts[chunk]};
+}
+
+template <class TKey, class TStorage>
+bool BasicMortonOctree<TKey, TStorage>::CheckNodeFloat(float x, float y, float z) {
   if (x < 0 || y < 0 || z < 0)
     return false;
 
   return CheckNode(x, y, z);
 }
 
-bool MortonOctree::CheckNode(uint32_t x, uint32_t y, uint32_t z) {
-  VoxNode n(x, y, z, 1);
-  auto node = std::lower_bound(m_nodes.begin(), m_nodes.end(), n,
-                               NodeSortPredicate);
+template <class TKey, class TStorage>
+bool BasicMortonOctree<TKey, TStorage>::CheckNode(uint32_t x, uint32_t y, uint32_t z) {
+  return CheckNode(MortonTraits<TKey>::Encode(x, y, z));
+}
+
+template <class TKey, class TStorage>
+bool BasicMortonOctree<TKey, TStorage>::CheckNode(TKey mortonKey) {
+  const size_t i = FindNode(0, m_nodes.size(), mortonKey);
+
+  return i != m_nodes.size() && m_nodes.Size(i) > 0 && !IsTombstoneAt(i);
+}
+
+template <class TKey, class TStorage>
+bool BasicMortonOctree<TKey, TStorage>::IsTombstoneAt(size_t i) const {
+  return m_nodes.Size(i) == Node::TombstoneSize;
+}
+
+template <class TKey, class TStorage>
+bool BasicMortonOctree<TKey, TStorage>::SpanContains(size_t i, TKey key) const {
+  return !IsTombstoneAt(i) && key - m_nodes.Key(i) < m_nodes.Size(i);
+}
+
+template <class TKey, class TStorage>
+size_t BasicMortonOctree<TKey, TStorage>::FindNode(size_t first, size_t last, TKey key) {
+  const size_t i = LowerBound(first, last, key);
+  if (i != last && m_nodes.Key(i) == key)
+    return i;
+  if (i != first && SpanContains(i - 1, key))
+    return i - 1;
+  return last;
+}
+
+template <class TKey, class TStorage>
+void BasicMortonOctree<TKey, TStorage>::SplitSpanAt(TKey key) {
+  const size_t sortedEnd = std::min(m_sortedCount, m_nodes.size());
+  const size_t i = FindNode(0, sortedEnd, key);
+  if (i == sortedEnd || m_nodes.Key(i) == key)
+    return;
+
+  Node right = m_nodes.Get(i);
+  right.start = key;
+  right.size = uint32_t(m_nodes.Key(i) + m_nodes.Size(i) - key);
+  m_nodes.SetSize(i, uint32_t(key - m_nodes.Key(i)));
+
+  InsertIntoChunkDirectory(utils::GetChunkIndex<TKey>(key), m_chunkLiveCounts.size());
+  m_nodes.Insert(i + 1, core::Move(right));
+  m_sortedCount++;
+  InvalidateSearchIndex();
+}
+
+template <class TKey, class TStorage>
+void BasicMortonOctree<TKey, TStorage>::SplitSpans(const core::Vector<TKey> &cuts) {
+  // Copying starts at the first split, batches that hit no span leave the nodes untouched.
+  TStorage split;
+  bool splitting = false;
+  size_t cut = 0;
+
+  for (size_t i = 0; i < m_nodes.size(); i++) {
+    Node node = m_nodes.Get(i);
+    if (!IsTombstoneAt(i) && node.size > 1) {
+      const TKey end = node.start + node.size;
+      while (cut != cuts.size() && cuts[cut] <= node.start)
+        cut++;
+
+      for (; cut != cuts.size() && cuts[cut] < end; cut++) {
+        if (!splitting) {
+          split.reserve(m_nodes.size() + cuts.size());
+          for (size_t j = 0; j < i; j++)
+            split.PushBack(m_nodes.Get(j));
+          splitting = true;
+        }
+
+        Node left = node;
+        left.size = uint32_t(cuts[cut] - node.start);
+        split.PushBack(core::Move(left));
+        node.start = cuts[cut];
+        node.size = uint32_t(end - node.start);
+      }
+    }
+    if (splitting)
+      split.PushBack(core::Move(node));
+  }
+
+  if (!splitting)
+    return;
+
+  m_nodes = core::Move(split);
+  m_sortedCount = m_nodes.size();
+  InvalidateSearchIndex();
+  InvalidateChunkDirectory();
+}
+
+template <class TKey, class TStorage>
+void BasicMortonOctree<TKey, TStorage>::MarkRemoved(size_t i) {
+  UpdateChunkOccupancy(m_nodes.Key(i), m_nodes.Size(i), false);
+  m_nodes.SetSize(i, Node::TombstoneSize);
+  m_tombstoneCount++;
+  m_occupancyDirty = true;
+  if (!m_chunkDirectoryDirty)
+    m_chunkLiveCounts[utils::GetChunkIndex<TKey>(m_nodes.Key(i))]--;
+}
+
+template <class TKey, class TStorage>
+void BasicMortonOctree<TKey, TStorage>::UpdateChunkOccupancy(TKey start, uint32_t size,
+                                                              bool solid) {
+  if (m_chunkOccupancyDirty)
+    return;
+
+  // Keys of a chunk are contiguous, so the map is only searched when a span enters a new chunk.
+  ChunkOccupancy *occupancy = nullptr;
+  size_t chunk = ~size_t(0);
+  for (TKey key = start; key != start + size; key++) {
+    if (utils::GetChunkIndex<TKey>(key) != chunk) {
+      chunk = utils::GetChunkIndex<TKey>(key);
+      auto it = m_chunkOccupancy.find(chunk);
+      occupancy = it != m_chunkOccupancy.end() ? &it->second : nullptr;
+      if (!occupancy && solid)
+        occupancy = &m_chunkOccupancy[chunk];
+    }
+    if (!occupancy)
+      continue;
 
-  return node != m_nodes.end() && node->start == n.start && node->size > 0;
+    uint32_t x, y, z;
+    MortonTraits<TKey>::Decode(key, x, y, z);
+    if (solid)
+      occupancy->Set(x & 31, y & 31, z & 31);
+    else
+      occupancy->Reset(x & 31, y & 31, z & 31);
+  }
 }
 
 #include "voxel/VoxelSide.h"
-uint8_t MortonOctree::GetVisibleSides(uint32_t x, uint32_t y, uint32_t z,
-                                       core::Vector<VoxNode>::iterator nodeIt) {
+template <class TKey, class TStorage>
+uint8_t BasicMortonOctree<TKey, TStorage>::GetVisibleSides(uint32_t x, uint32_t y, uint32_t z,
+                                                           NodeIterator) {
   uint8_t sides = ALL;
 
-  static VoxNode n;
-  n.size = 1;
-  n.start = encodeMK(x, y + 1, z);
+  // Neighbors are single bits of the chunk bitsets, no search over the nodes.
+  auto isSolid = [this](TKey key) {
+    uint32_t nx, ny, nz;
+    MortonTraits<TKey>::Decode(key, nx, ny, nz);
+    const ChunkOccupancy *occupancy = GetChunkOccupancy(utils::GetChunkIndex<TKey>(key));
+    return occupancy && occupancy->Get(nx & 31, ny & 31, nz & 31);
+  };
+
+  const TKey key = MortonTraits<TKey>::Encode(x, y, z);
 
-  if (std::binary_search(nodeIt, m_nodes.end(), n, NodeSortPredicate))
+  if (!MortonIsMaxY(key) && isSolid(MortonAddY(key)))
     util::RemoveBit(sides, TOP);
 
-  n.start = encodeMK(x, y, z + 1);
-  if (std::binary_search(nodeIt, m_nodes.end(), n, NodeSortPredicate))
+  if (!MortonIsMaxZ(key) && isSolid(MortonAddZ(key)))
     util::RemoveBit(sides, FRONT);
 
-  n.start = encodeMK(x + 1, y, z);
-  if (std::binary_search(nodeIt, m_nodes.end(), n, NodeSortPredicate))
+  if (!MortonIsMaxX(key) && isSolid(MortonAddX(key)))
     util::RemoveBit(sides, LEFT);
 
-  n.start = encodeMK(x - 1, y, z);
-  if (std::binary_search(m_nodes.begin(), nodeIt, n, NodeSortPredicate))
+  if (!MortonIsMinX(key) && isSolid(MortonSubX(key)))
     util::RemoveBit(sides, RIGHT);
 
-  n.start = encodeMK(x, y, z - 1);
-  if (std::binary_search(m_nodes.begin(), nodeIt, n, NodeSortPredicate))
+  if (!MortonIsMinZ(key) && isSolid(MortonSubZ(key)))
     util::RemoveBit(sides, BACK);
 
-  n.start = encodeMK(x, y - 1, z);
-  if (std::binary_search(m_nodes.begin(), nodeIt, n, NodeSortPredicate))
+  if (!MortonIsMinY(key) && isSolid(MortonSubY(key)))
     util::RemoveBit(sides, BOTTOM);
 
   return sides;
 }
 
-core::Vector<VoxNode> &MortonOctree::GetNodes() { return m_nodes; }
+template <class TKey, class TStorage> TStorage &BasicMortonOctree<TKey, TStorage>::GetNodes() {
+  return m_nodes;
+}
 
-bool MortonOctree::RemoveNode(uint32_t x, uint32_t y, uint32_t z) {
-  auto start = vox::encodeMK(x,y,z);
+template <class TKey, class TStorage>
+bool BasicMortonOctree<TKey, TStorage>::AnyNodeInBox(const glm::uvec3 &min,
+                                                     const glm::uvec3 &max) {
+  return GetOccupancy().AnyInBox(min, max);
+}
+
+template <class TKey, class TStorage>
+const MortonOccupancy<TKey> &BasicMortonOctree<TKey, TStorage>::GetOccupancy() {
+  SortLeafNodes();
+  if (m_occupancyDirty) {
+    m_occupancy.Build(m_nodes);
+    m_occupancyDirty = false;
+  }
+  return m_occupancy;
+}
 
-  auto lb = std::lower_bound(m_nodes.begin(), m_nodes.end(),
-                             VoxNode(start), NodeSortPredicate);
+template <class TKey, class TStorage>
+const ChunkOccupancy *BasicMortonOctree<TKey, TStorage>::GetChunkOccupancy(size_t chunk) {
+  if (m_chunkOccupancyDirty) {
+    SortLeafNodes();
+    m_chunkOccupancy.clear();
+    m_chunkOccupancyDirty = false;
+    for (size_t i = 0; i < m_nodes.size(); i++)
+      if (!IsTombstoneAt(i))
+        UpdateChunkOccupancy(m_nodes.Key(i), m_nodes.Size(i), true);
+  }
+
+  auto it = m_chunkOccupancy.find(chunk);
+  return it != m_chunkOccupancy.end() ? &it->second : nullptr;
+}
 
-  if(lb != m_nodes.end() && lb->start == start)
+template <class TKey, class TStorage>
+bool BasicMortonOctree<TKey, TStorage>::RemoveNode(uint32_t x, uint32_t y, uint32_t z) {
+  auto start = MortonTraits<TKey>::Encode(x, y, z);
+
+  // Like AddNode, only the sorted prefix is searched, the orphan tail is not in key order.
+  const size_t sortedEnd = std::min(m_sortedCount, m_nodes.size());
+  const size_t found = FindNode(0, sortedEnd, start);
+
+  if(found != sortedEnd && !IsTombstoneAt(found))
   {
-    uint32_t nx, ny, nz;
-    vox::decodeMK(lb->start, nx, ny, nz);
-    elog::LogInfo(core::string::format("Removed node at: [{}, {}, {}]", nx, ny, nz));
-    lb->size = -1;
+    // Only the voxel itself goes, the rest of a span stays.
+    SplitSpanAt(start);
+    SplitSpanAt(start + 1);
+    const size_t splitEnd = std::min(m_sortedCount, m_nodes.size());
+    const size_t i = LowerBound(0, splitEnd, start);
+    if (i == splitEnd || m_nodes.Key(i) != start)
+      return false;
+
+    elog::LogInfo(core::string::format("Removed node at: [{}, {}, {}]", x, y, z));
+    MarkRemoved(i);
+    CompactIfNeeded();
     return true;
   }
 
   return false;
 }
-}
\ No newline at end of file
+
+template class BasicMortonOctree<uint32_t, AosNodeStorage<uint32_t>>;
+template class BasicMortonOctree<uint64_t, AosNodeStorage<uint64_t>>;
+template class BasicMortonOctree<uint32_t, SoaNodeStorage<uint32_t>>;
+template class BasicMortonOctree<uint64_t, SoaNodeStorage<uint64_t>>;
+}
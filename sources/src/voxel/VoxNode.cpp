@@ -2,7 +2,8 @@
 #include "voxel/Morton.h"
 
 namespace vox {
-VoxNode::VoxNode(VoxNode &&n) noexcept
+template <class TKey>
+BasicVoxNode<TKey>::BasicVoxNode(BasicVoxNode &&n) noexcept
     : start(n.start), size(n.size), r(n.r), g(n.g), b(n.b) {}
 
 /*MNode& MNode::operator=(MNode&& x) noexcept //fixme
@@ -15,21 +16,25 @@ VoxNode::VoxNode(VoxNode &&n) noexcept
     return *this;
 }*/
 
-VoxNode::VoxNode(uint32_t x, uint32_t y, uint32_t z, uint32_t nodeSize) {
-  start = encodeMK(x, y, z);
+template <class TKey>
+BasicVoxNode<TKey>::BasicVoxNode(uint32_t x, uint32_t y, uint32_t z, uint32_t nodeSize) {
+  start = MortonTraits<TKey>::Encode(x, y, z);
   size = nodeSize;
   r = g = b = 255;
 }
 
-VoxNode::VoxNode(core::pod::Vec3<uint32_t> pos, core::pod::Vec3<uint8_t> color, uint32_t nodeSize){
-  start = encodeMK(pos.x, pos.y, pos.z);
+template <class TKey>
+BasicVoxNode<TKey>::BasicVoxNode(core::pod::Vec3<uint32_t> pos, core::pod::Vec3<uint8_t> color,
+                                 uint32_t nodeSize) {
+  start = MortonTraits<TKey>::Encode(pos.x, pos.y, pos.z);
   r = color.r;
   g = color.g;
   b = color.b;
   size = nodeSize;
 }
 
-VoxNode::VoxNode(uint32_t morton, uint32_t nodeSize, uint8_t red, uint8_t green,
+template <class TKey>
+BasicVoxNode<TKey>::BasicVoxNode(TKey morton, uint32_t nodeSize, uint8_t red, uint8_t green,
              uint8_t blue) {
   start = morton;
   size = nodeSize;
@@ -38,33 +43,37 @@ VoxNode::VoxNode(uint32_t morton, uint32_t nodeSize, uint8_t red, uint8_t green,
   b = blue;
 }
 
-VoxNode::VoxNode(uint32_t morton, uint32_t nodeSize) {
+template <class TKey> BasicVoxNode<TKey>::BasicVoxNode(TKey morton, uint32_t nodeSize) {
   start = morton;
   size = nodeSize;
   r = g = b = 255;
 }
 
-VoxNode::VoxNode() {
+template <class TKey> BasicVoxNode<TKey>::BasicVoxNode() {
   start = 0;
   size = 0;
   r = g = b = 255;
 }
 
-bool VoxNode::operator<(const VoxNode &other)
+template <class TKey>
+bool BasicVoxNode<TKey>::operator<(const BasicVoxNode &other)
     const /// ordering: z order, plus on equal sizes largest first
 {
   return start == other.start ? size > other.size : start < other.start;
 }
 
-bool VoxNode::operator==(const VoxNode &other) const {
+template <class TKey> bool BasicVoxNode<TKey>::operator==(const BasicVoxNode &other) const {
   return start == other.start && size == other.size;
 }
 
-void VoxNode::Assign(const VoxNode &node) {
+template <class TKey> void BasicVoxNode<TKey>::Assign(const BasicVoxNode &node) {
   size = node.size;
   start = node.start;
   r = node.r;
   g = node.g;
   b = node.b;
 }
-}
\ No newline at end of file
+
+template struct BasicVoxNode<uint32_t>;
+template struct BasicVoxNode<uint64_t>;
+}
@@ -3,8 +3,8 @@
 #include "render/IGpuBufferObject.h"
 
 namespace vox {
-VoxelMesh::VoxelMesh(core::UniquePtr<render::IGpuBufferArrayObject> vao)
-: m_vao(core::Move(vao)), m_isReady(false) {
+VoxelMesh::VoxelMesh(core::UniquePtr<render::IGpuBufferArrayObject> vao, EVertexFormat format)
+: m_vao(core::Move(vao)), m_format(format), m_isReady(false) {
 
 }
 VoxelMesh::~VoxelMesh()
@@ -14,7 +14,27 @@ VoxelMesh::~VoxelMesh()
 void VoxelMesh::Upload() {
 
   if_debug{
-    elog::LogInfo(core::string::format("Uploading voxel mesh. Num indices <{}>, Num UVs <{}>, Num vertices <{}>, Num normals: <{}>", Indices.size(), UVs.size(), Vertices.size(), Normals.size()));
+    elog::LogInfo(core::string::format("Uploading voxel mesh. Num indices <{}>, Num UVs <{}>, Num vertices <{}>, Num normals: <{}>, Num packed vertices: <{}>", Indices.size(), UVs.size(), Vertices.size(), Normals.size(), PackedVertices.size()));
+  }
+
+  if (m_format == EVertexFormat::Packed) {
+    // The index pattern only changes size, so it is uploaded again only when the mesh outgrows
+    // it, or shrinks to less than half of it and would hold on to the GPU memory.
+    const size_t quadCount = PackedVertices.size() / 4;
+    const size_t capacity = GetQuadIndexCapacity(quadCount);
+    if (quadCount > m_uploadedQuadCapacity || 2 * capacity < m_uploadedQuadCapacity) {
+      m_uploadedQuadCapacity = capacity;
+      const auto &indices = GetQuadIndices(m_uploadedQuadCapacity);
+      m_vao->GetBufferObject(0)->UpdateBuffer(m_uploadedQuadCapacity * 6, indices.data());
+    }
+    // Converted into one buffer reused by every mesh, Upload runs on the main thread only.
+    static core::Vector<glm::vec2> gpuVertices;
+    gpuVertices.resize(PackedVertices.size());
+    for (size_t i = 0; i < PackedVertices.size(); i++)
+      gpuVertices[i] = PackedVertices[i].ToFloat32();
+    m_vao->GetBufferObject(1)->UpdateBuffer(gpuVertices.size(), gpuVertices.data());
+    m_isReady = true;
+    return;
   }
 
   m_vao->GetBufferObject(0)->UpdateBuffer(Indices.size(), Indices.data());
@@ -28,7 +48,84 @@ void VoxelMesh::Render() {
   ASSERT(m_vao != nullptr, "VAO is empty");
   ASSERT(Vertices.size() == Normals.size(), core::string::format("Num vertices <{}>, Num normals <{}>", Vertices.size(), Normals.size()));
   ASSERT(m_isReady);
-  m_vao->Render(Indices.size());
+  if (m_format == EVertexFormat::Packed)
+    m_vao->Render(PackedVertices.size() / 4 * 6);
+  else
+    m_vao->Render(Indices.size());
+}
+
+template <class T> static void AssignExact(core::Vector<T> &to, const core::Vector<T> &from) {
+  if (to.capacity() > 2 * from.size())
+    core::Vector<T>().swap(to);
+  to.assign(from.begin(), from.end());
+}
+
+void VoxelMesh::AssignGeometry(const VoxelMesh &other) {
+  m_isReady = false;
+
+  AssignExact(Indices, other.Indices);
+  AssignExact(Vertices, other.Vertices);
+  AssignExact(UVs, other.UVs);
+  AssignExact(Normals, other.Normals);
+  AssignExact(PackedVertices, other.PackedVertices);
+  std::copy(other.SliceQuadStart, other.SliceQuadStart + SliceCount + 1, SliceQuadStart);
+}
+
+/// Replaces count elements of to starting at first with the elements of from.
+template <class T>
+static void SpliceRange(core::Vector<T> &to, size_t first, size_t count,
+                        const core::Vector<T> &from) {
+  const size_t common = std::min(count, from.size());
+  std::copy(from.begin(), from.begin() + common, to.begin() + first);
+  if (count > common)
+    to.erase(to.begin() + first + common, to.begin() + first + count);
+  else
+    to.insert(to.begin() + first + common, from.begin() + common, from.end());
+}
+
+void VoxelMesh::ReplaceSliceQuads(uint32_t slice, const VoxelMesh &patch) {
+  ASSERT(slice < SliceCount && patch.m_format == m_format);
+
+  const uint32_t firstQuad = SliceQuadStart[slice];
+  const uint32_t oldQuads = SliceQuadStart[slice + 1] - firstQuad;
+  const uint32_t newQuads = patch.GetQuadCount();
+
+  if (m_format == EVertexFormat::Packed) {
+    SpliceRange(PackedVertices, firstQuad * 4, oldQuads * 4, patch.PackedVertices);
+  } else {
+    // Indices are absolute: the patch ones start at the slice, later ones move with their quads.
+    const int64_t shift = (int64_t(newQuads) - int64_t(oldQuads)) * 4;
+    for (size_t i = (firstQuad + oldQuads) * 6; i < Indices.size(); i++)
+      Indices[i] = uint32_t(Indices[i] + shift);
+
+    core::Vector<uint32_t> patchIndices(patch.Indices);
+    for (uint32_t &index : patchIndices)
+      index += firstQuad * 4;
+
+    SpliceRange(Indices, firstQuad * 6, oldQuads * 6, patchIndices);
+    SpliceRange(Vertices, firstQuad * 4, oldQuads * 4, patch.Vertices);
+    SpliceRange(UVs, firstQuad * 4, oldQuads * 4, patch.UVs);
+    SpliceRange(Normals, firstQuad * 4, oldQuads * 4, patch.Normals);
+  }
+
+  for (uint32_t s = slice + 1; s <= SliceCount; s++)
+    SliceQuadStart[s] = SliceQuadStart[s] + newQuads - oldQuads;
+}
+
+const core::Vector<uint32_t> &VoxelMesh::GetQuadIndices(size_t quadCount) {
+  static core::Vector<uint32_t> indices;
+
+  for (size_t quad = indices.size() / 6; quad < quadCount; quad++) {
+    const uint32_t first = uint32_t(quad * 4);
+    for (uint32_t offset : {0u, 2u, 3u, 0u, 1u, 2u})
+      indices.push_back(first + offset);
+  }
+  return indices;
+}
+
+size_t VoxelMesh::GetQuadIndexCapacity(size_t quadCount) {
+  // Close to the quad count, an empty mesh uploads no indices at all.
+  return (quadCount + QuadCapacityStep - 1) / QuadCapacityStep * QuadCapacityStep;
 }
 
 void VoxelMesh::Clear() {
@@ -38,5 +135,7 @@ void VoxelMesh::Clear() {
   UVs.clear();
   Vertices.clear();
   Normals.clear();
+  PackedVertices.clear();
+  std::fill(SliceQuadStart, SliceQuadStart + SliceCount + 1, 0u);
 }
 }
\ No newline at end of file
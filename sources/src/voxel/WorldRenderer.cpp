@@ -13,16 +13,59 @@
 #include <render/IRenderer.h>
 #include <render/debug/DebugRenderer.h>
 
+#include <atomic>
+
 #include "gui/IGui.h"
 
 namespace vox {
+namespace {
+/// Mesher and output buffers of one worker thread. Meshing into buffers that already grew to the
+/// largest chunk seen avoids reallocating while quads are appended, the result is then copied
+/// into the sub-chunk mesh at its final size.
+struct MesherScratch
+{
+  explicit MesherScratch(VoxelMesh::EVertexFormat format)
+      : Output(nullptr, format)
+  {
+  }
+
+  ChunkMesher Mesher;
+  VoxelMesh   Output;
+};
+
+thread_local core::UniquePtr<MesherScratch> t_mesherScratch;
+} // namespace
+
+void MesherBackgroundJob::Run()
+{
+  static std::atomic<int> chunkCount{ 0 };
+
+  VoxelMesh* target = m_subChunk->GetBufferForUpdates();
+  if (!t_mesherScratch || t_mesherScratch->Output.GetVertexFormat() != target->GetVertexFormat())
+  {
+    t_mesherScratch = core::MakeUnique<MesherScratch>(target->GetVertexFormat());
+  }
+
+  VoxelMesh& output = t_mesherScratch->Output;
+  output.Clear();
+  t_mesherScratch->Mesher.BuildChunk(m_nodesToMesh.begin(), m_nodesToMesh.end(), &output, m_apron);
+  target->AssignGeometry(output);
+
+  elog::LogInfo(core::string::format("Chunk counter {}", chunkCount++));
+}
+
 WorldRenderer::WorldRenderer(render::IRenderer* renderer, render::DebugRenderer* debugRenderer,
                              gw::World* world, vox::EWorldRenderDistance renderDistanceInChunks)
     : m_renderer(renderer)
     , m_world(world)
     , m_renderDistanceInChunks(renderDistanceInChunks)
     , m_playerOrigin(0, 0, 0)
+    , m_playerViewDirection(0, 0, 0)
+    , m_prioritizedSubChunk(0, 0, 0)
+    , m_editMesher(core::MakeUnique<ChunkMesher>())
 {
+  m_meshUploadBudget.Time  = std::chrono::microseconds(2000);
+  m_meshUploadBudget.Bytes = 8 * 1024 * 1024;
 
   m_worldMat = Game->GetResourceManager()->LoadMaterial("resources/shaders/voxel");
   m_worldAtlas =
@@ -36,21 +79,17 @@ WorldRenderer::~WorldRenderer() {}
 
 core::UniquePtr<vox::VoxelMesh> WorldRenderer::CreateEmptyMesh()
 {
+  // One attribute of two words per vertex, uploaded as float32, see PackedVoxelVertex::ToFloat32.
   core::Vector<render::BufferDescriptor> bufferDescriptors = {
     render::BufferDescriptor{ 1, render::BufferObjectType::index,
                               render::BufferComponentDataType::uint32, 0 },
 
-    render::BufferDescriptor{ 3, render::BufferObjectType::vertex,
+    render::BufferDescriptor{ 2, render::BufferObjectType::vertex,
                               render::BufferComponentDataType::float32, 0 },
-
-    render::BufferDescriptor{ 3, render::BufferObjectType::vertex,
-                              render::BufferComponentDataType::float32, 1 },
-    render::BufferDescriptor{ 3, render::BufferObjectType::vertex,
-                              render::BufferComponentDataType::float32, 2 },
   };
 
   auto vao = m_renderer->CreateBufferArrayObject(bufferDescriptors);
-  return core::MakeUnique<vox::VoxelMesh>(core::Move(vao));
+  return core::MakeUnique<vox::VoxelMesh>(core::Move(vao), vox::VoxelMesh::EVertexFormat::Packed);
 }
 
 void WorldRenderer::BuildChunkV2(const gw::WorldSuperChunk& chunkData)
@@ -60,15 +99,24 @@ void WorldRenderer::BuildChunkV2(const gw::WorldSuperChunk& chunkData)
     return;
   }
 
+  // The directory sorts pending nodes on first use, take iterators after that.
+  auto subChunkCount    = chunkData.GetSubChunkCount();
   auto superChunkOffset = chunkData.WorldPos;
-
-  auto firstVoxelInChunkIt = chunkData.GetFirstSubChunk();
-  auto lastVoxelInChunkIt  = chunkData.GetChunkEnd(firstVoxelInChunkIt);
+  auto nodesBegin       = chunkData.GetFirstSubChunk();
 
   elog::LogInfo("\nBuildChunkV2 start\n");
 
-  while (true)
+  for (size_t subChunk = 0; subChunk < subChunkCount; subChunk++)
   {
+    const auto range = chunkData.GetSubChunkRange(subChunk);
+    if (range.liveCount == 0)
+    {
+      continue;
+    }
+
+    auto firstVoxelInChunkIt = nodesBegin + range.begin;
+    auto lastVoxelInChunkIt  = nodesBegin + range.end;
+
     auto [x, y, z] = vox::utils::Decode(vox::utils::GetChunk(firstVoxelInChunkIt->start));
     elog::LogInfo(core::string::format("subchunk offset: [{},{},{}], superchunk: [{},{},{}]", x, y,
                                        z, superChunkOffset.x, superChunkOffset.y,
@@ -79,24 +127,207 @@ void WorldRenderer::BuildChunkV2(const gw::WorldSuperChunk& chunkData)
 
     if (worldSubChunk->m_isDirty && worldSubChunk->m_isGenerating == false)
     {
-      worldSubChunk->m_isGenerating = true;
+      EnqueueMeshing(chunkData, vox::utils::GetChunk(firstVoxelInChunkIt->start), worldSubChunk);
+    }
+  }
+  elog::LogInfo("\nBuildChunkV2 end\n");
+}
 
-      core::Vector<vox::VoxNode> chunkNodes(firstVoxelInChunkIt, lastVoxelInChunkIt);
+void WorldRenderer::EnqueueMeshing(const gw::WorldSuperChunk& chunkData, uint32_t chunkMK,
+                                   WorldSubChunk* subChunk)
+{
+  const auto range = chunkData.GetSubChunkRange(vox::utils::GetChunkIndex(chunkMK));
+  auto       begin = chunkData.GetFirstSubChunk();
 
-      m_backgroundMesher.EnqueueBackgroundJob(
-          new MesherBackgroundJob(worldSubChunk, firstVoxelInChunkIt, lastVoxelInChunkIt));
+  auto [cx, cy, cz] = vox::utils::Decode(chunkMK);
+  const auto subChunkPos =
+      chunkData.WorldPos * glm::ivec3(vox::WorldConfig::OctreeSize) + glm::ivec3(cx, cy, cz);
+
+  subChunk->m_isDirty      = false;
+  subChunk->m_isGenerating = true;
+  m_backgroundMesher.EnqueueBackgroundJob(
+      new MesherBackgroundJob(subChunk, subChunkPos, begin + range.begin, begin + range.end,
+                              GetChunkApron(chunkData, chunkMK)),
+      GetMeshingPriority(subChunkPos));
+}
+
+float WorldRenderer::GetMeshingPriority(glm::ivec3 subChunkPos) const
+{
+  const glm::vec3 center   = glm::vec3(subChunkPos) + glm::vec3(RenderableChunkSize / 2.f);
+  const glm::vec3 toChunk  = center - glm::vec3(m_playerOrigin);
+  const float     distance = glm::length(toChunk);
+  if (distance < 1.f)
+  {
+    return distance;
+  }
+
+  // 1 in front of the camera, -1 behind it, 0 without a view direction yet.
+  const float facing = glm::dot(toChunk / distance, m_playerViewDirection);
+  return distance * (2.f - facing);
+}
+
+int32_t WorldRenderer::GetRenderDistanceInSuperChunks() const
+{
+  const auto renderDistanceInVoxels = uint32_t(m_renderDistanceInChunks) * RenderableChunkSize;
+  return int32_t(renderDistanceInVoxels / gw::World::SuperChunkSize) + 1;
+}
+
+bool WorldRenderer::IsInRenderRange(glm::ivec3 subChunkPos) const
+{
+  // Same superchunk box as GetChunksAroundPlayer.
+  const auto renderDistanceInSuperChunks = GetRenderDistanceInSuperChunks();
+  const auto offset =
+      gw::World::GetSuperChunkPos(subChunkPos) - gw::World::GetSuperChunkPos(m_playerOrigin);
+  return std::abs(offset.x) <= renderDistanceInSuperChunks &&
+         std::abs(offset.y) <= renderDistanceInSuperChunks &&
+         std::abs(offset.z) <= renderDistanceInSuperChunks;
+}
+
+void WorldRenderer::UpdateMeshingPriorities()
+{
+  for (auto& [pos, subChunk] : m_map)
+  {
+    if (subChunk.m_isGenerating && IsInRenderRange(pos) == false)
+    {
+      QueueRemesh(pos, subChunk);
     }
+  }
 
-    if (lastVoxelInChunkIt == chunkData.Octree->GetNodes().end())
+  // m_backgroundMesher only runs mesher jobs.
+  m_backgroundMesher.Reprioritize([this](const threading::BackgroundJob& job) {
+    return GetMeshingPriority(static_cast<const MesherBackgroundJob&>(job).GetSubChunkPos());
+  });
+}
+
+void WorldRenderer::UpdateVoxel(glm::ivec3 voxel)
+{
+  VoxNode    node;
+  const bool solid       = m_world->GetVoxel(voxel, node);
+  const auto subChunkPos = glm::ivec3(voxel.x & ~31, voxel.y & ~31, voxel.z & ~31);
+
+  // A sub-chunk that never had voxels has no entry yet. Its new empty mesh is a valid mesh of
+  // the empty chunk, so it is patched like any other.
+  if (solid && m_map.find(subChunkPos) == m_map.end())
+  {
+    const auto superChunkPos = gw::World::GetSuperChunkPos(voxel);
+    const auto chunk         = subChunkPos - superChunkPos * gw::World::SuperChunkSize;
+    GetSubChunk(vox::utils::Encode(chunk.x, chunk.y, chunk.z), superChunkPos)->m_isDirty = false;
+  }
+
+  UpdateSubChunkVoxel(subChunkPos, voxel, solid ? &node : nullptr);
+
+  // Voxels on a border are also in the apron of the sub-chunk across it.
+  for (uint32_t axis = 0; axis < 3; axis++)
+  {
+    const int32_t local = voxel[axis] - subChunkPos[axis];
+    if (local == 0 || local == 31)
     {
-      break;
+      glm::ivec3 neighborPos = subChunkPos;
+      neighborPos[axis] += local == 0 ? -32 : 32;
+      UpdateSubChunkVoxel(neighborPos, voxel, solid ? &node : nullptr);
     }
+  }
+}
 
-    firstVoxelInChunkIt = lastVoxelInChunkIt + 1;
+void WorldRenderer::QueueRemesh(glm::ivec3 subChunkPos, WorldSubChunk& subChunk)
+{
+  subChunk.m_isDirty = true;
+  if (subChunk.m_isRemeshQueued)
+  {
+    return;
+  }
 
-    lastVoxelInChunkIt = chunkData.GetChunkEnd(firstVoxelInChunkIt);
+  // Only once per job: a cancelled job stays generating until it is finalized, and bumping the
+  // generation again on every priority update would not cancel it any further.
+  if (subChunk.m_isGenerating)
+  {
+    subChunk.m_meshGeneration++;
   }
-  elog::LogInfo("\nBuildChunkV2 end\n");
+  subChunk.m_isRemeshQueued = true;
+  m_pendingRemesh.push_back(subChunkPos);
+}
+
+void WorldRenderer::UpdateSubChunkVoxel(glm::ivec3 subChunkPos, glm::ivec3 voxel,
+                                        const VoxNode* node)
+{
+  auto it = m_map.find(subChunkPos);
+  if (it == m_map.end())
+  {
+    return;
+  }
+
+  WorldSubChunk& subChunk = it->second;
+  if (subChunk.m_isGenerating || subChunk.m_isDirty)
+  {
+    // The active mesh is not the mesh of the current nodes, patching it would not make it one.
+    // A running job meshes the nodes from before the edit: cancel it, so it is dropped if it did
+    // not start yet, and remesh once it is finalized.
+    if (m_editSubChunk == &subChunk)
+    {
+      m_editSubChunk = nullptr;
+    }
+    QueueRemesh(subChunkPos, subChunk);
+    return;
+  }
+
+  if (m_editSubChunk != &subChunk)
+  {
+    const auto superChunkPos = gw::World::GetSuperChunkPos(subChunkPos);
+    const auto chunkData     = m_world->GetChunk(superChunkPos);
+    if (chunkData == nullptr)
+    {
+      return;
+    }
+
+    const auto range = chunkData->GetSubChunkRange(vox::utils::GetChunkIndex(subChunk.m_chunkMK));
+    auto       begin = chunkData->GetFirstSubChunk();
+    m_editMesher->LoadChunk(begin + range.begin, begin + range.end,
+                            GetChunkApron(*chunkData, subChunk.m_chunkMK));
+    m_editSubChunk = &subChunk;
+  }
+
+  VoxelMesh* mesh = subChunk.GetActiveMesh();
+  m_editMesher->UpdateVoxel(mesh, voxel - subChunkPos, node);
+  mesh->Upload();
+}
+
+ChunkApron WorldRenderer::GetChunkApron(const gw::WorldSuperChunk& chunkData, uint32_t chunkMK)
+{
+  static constexpr int32_t Size = gw::World::SuperChunkSize;
+  static const glm::ivec3  SideDirections[] = { { -1, 0, 0 }, { 1, 0, 0 },  { 0, -1, 0 },
+                                                { 0, 1, 0 },  { 0, 0, -1 }, { 0, 0, 1 } };
+
+  ChunkApron apron;
+  auto [cx, cy, cz] = vox::utils::Decode(chunkMK);
+
+  for (uint8_t side = 0; side < 6; side++)
+  {
+    glm::ivec3 neighbor   = glm::ivec3(cx, cy, cz) + SideDirections[side] * 32;
+    glm::ivec3 superChunk = chunkData.WorldPos;
+    for (uint32_t axis = 0; axis < 3; axis++)
+    {
+      if (neighbor[axis] < 0 || neighbor[axis] >= Size)
+      {
+        superChunk[axis] += SideDirections[side][axis];
+        neighbor[axis] = (neighbor[axis] + Size) % Size;
+      }
+    }
+
+    const gw::WorldSuperChunk* neighborData =
+        superChunk == chunkData.WorldPos ? &chunkData : m_world->GetChunk(superChunk);
+    if (neighborData == nullptr)
+    {
+      continue;
+    }
+
+    const auto chunk =
+        vox::utils::GetChunkIndex(vox::utils::Encode(neighbor.x, neighbor.y, neighbor.z));
+    if (const ChunkOccupancy* occupancy = neighborData->Octree->GetChunkOccupancy(chunk))
+    {
+      apron.SetSide(ChunkApron::ESide(side), *occupancy);
+    }
+  }
+  return apron;
 }
 
 float     g_LightPower    = 640000;
@@ -108,6 +339,13 @@ void WorldRenderer::RenderWorldGui()
   ImGui::DragFloat("Light power", &g_LightPower, 25);
   ImGui::DragFloat3("Light position", &g_LightPosition.x, 25);
   ImGui::End();
+
+  ImGui::Begin("Mesh uploads");
+  ImGui::Text("Finalized: %u, pending: %u", m_lastMeshUploadStats.JobsFinalized,
+              m_lastMeshUploadStats.JobsPending);
+  ImGui::Text("Uploaded: %zu KiB in %lld us", m_lastMeshUploadStats.BytesFinalized / 1024,
+              (long long)m_lastMeshUploadStats.TimeSpent.count());
+  ImGui::End();
 }
 
 void WorldRenderer::RenderAllMeshes()
@@ -148,6 +386,13 @@ void WorldRenderer::RenderAllMeshes()
 void WorldRenderer::SetPlayerOriginInWorld(glm::ivec3 origin)
 {
   m_playerOrigin = origin;
+
+  const auto subChunk = glm::ivec3(origin.x & ~31, origin.y & ~31, origin.z & ~31);
+  if (subChunk != m_prioritizedSubChunk)
+  {
+    m_prioritizedSubChunk = subChunk;
+    UpdateMeshingPriorities();
+  }
 }
 
 void WorldRenderer::GenerateVisibleChunks()
@@ -162,20 +407,50 @@ void WorldRenderer::GenerateVisibleChunks()
 
 core::Vector<std::tuple<int32_t, gw::WorldSuperChunk*>> WorldRenderer::GetChunksAroundPlayer()
 {
-  glm::ivec3 playerSuperChunk = glm::ivec3(m_playerOrigin.x / gw::World::SuperChunkSize,
-                                           m_playerOrigin.y / gw::World::SuperChunkSize,
-                                           m_playerOrigin.z / gw::World::SuperChunkSize);
-
-  auto renderDistanceInVoxels      = uint32_t(m_renderDistanceInChunks) * RenderableChunkSize;
-  auto renderDistanceInSuperChunks = (renderDistanceInVoxels / gw::World::SuperChunkSize) + 1;
-
-  return m_world->GetChunksAroundOrigin(m_playerOrigin, renderDistanceInSuperChunks);
+  return m_world->GetChunksAroundOrigin(m_playerOrigin, GetRenderDistanceInSuperChunks());
 }
 
 void WorldRenderer::Update(float microsecondsElapsed)
 {
-  m_backgroundMesher.Run();
+  if (auto cam = m_renderer->GetRenderContext()->GetCurrentCamera())
+  {
+    // The third row of the view matrix is the camera back vector in world space.
+    const auto& view    = cam->GetView();
+    const auto  forward = -glm::normalize(glm::vec3(view[0][2], view[1][2], view[2][2]));
+
+    // Turning by more than about 25 degrees changes which sub-chunks are in view.
+    if (glm::dot(forward, m_playerViewDirection) < 0.9f)
+    {
+      m_playerViewDirection = forward;
+      UpdateMeshingPriorities();
+    }
+  }
+
+  m_lastMeshUploadStats = m_backgroundMesher.Run(m_meshUploadBudget);
   // GenerateVisibleChunks();
+
+  for (size_t i = 0; i < m_pendingRemesh.size();)
+  {
+    // Sub-chunks whose job was cancelled out of range wait here until they are back in range.
+    WorldSubChunk& subChunk = m_map.at(m_pendingRemesh[i]);
+    if (subChunk.m_isGenerating || (subChunk.m_isDirty && !IsInRenderRange(m_pendingRemesh[i])))
+    {
+      i++;
+      continue;
+    }
+
+    if (subChunk.m_isDirty)
+    {
+      const auto superChunkPos = gw::World::GetSuperChunkPos(m_pendingRemesh[i]);
+      if (const auto chunkData = m_world->GetChunk(superChunkPos))
+      {
+        EnqueueMeshing(*chunkData, subChunk.m_chunkMK, &subChunk);
+      }
+    }
+    subChunk.m_isRemeshQueued = false;
+    m_pendingRemesh[i]        = m_pendingRemesh.back();
+    m_pendingRemesh.pop_back();
+  }
 }
 
 
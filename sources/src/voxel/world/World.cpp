@@ -11,14 +11,45 @@ WorldSuperChunk* World::CreateChunk(glm::ivec3 chunk)
   return &res.first->second;
 }
 
+bool World::GetVoxel(glm::ivec3 voxel, vox::VoxNode& node)
+{
+  const glm::ivec3 superChunkPos = GetSuperChunkPos(voxel);
+  auto             superChunk    = GetChunk(superChunkPos);
+  if (superChunk == nullptr)
+  {
+    return false;
+  }
+
+  const glm::uvec3 local(voxel - superChunkPos * SuperChunkSize);
+  bool             found = false;
+  superChunk->Octree->ForEachNodeInBox(local, local, [&](const vox::VoxNode& covering) {
+    node.Assign(covering);
+    found = true;
+    return false;
+  });
+  return found;
+}
+
+bool World::RemoveVoxel(glm::ivec3 voxel)
+{
+  const glm::ivec3 superChunkPos = GetSuperChunkPos(voxel);
+  auto             superChunk    = GetChunk(superChunkPos);
+  if (superChunk == nullptr)
+  {
+    return false;
+  }
+
+  const glm::uvec3 local(voxel - superChunkPos * SuperChunkSize);
+  return superChunk->Octree->RemoveNode(local.x, local.y, local.z);
+}
+
 core::Vector<std::tuple<int32_t, WorldSuperChunk*>> World::GetChunksAroundOrigin(
     glm::ivec3 originInVoxels, int32_t distanceInSuperChunks)
 {
   core::Vector<std::tuple<int32_t, WorldSuperChunk*>> superChunks;
 
-  glm::ivec3 playerSuperChunk =
-      glm::ivec3(originInVoxels.x / SuperChunkSize, originInVoxels.y / SuperChunkSize,
-                 originInVoxels.z / SuperChunkSize);
+  // Rounds down for negative positions, the same box as WorldRenderer::IsInRenderRange.
+  glm::ivec3 playerSuperChunk = GetSuperChunkPos(originInVoxels);
 
 
   glm::ivec3 renderMinChunk = playerSuperChunk - glm::ivec3(distanceInSuperChunks);
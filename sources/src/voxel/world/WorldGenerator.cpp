@@ -5,6 +5,7 @@
 #include "util/Profiler.h"
 #include "util/Timer.h"
 #include "util/noise/NoiseGenerator.h"
+#include "voxel/MortonBatch.h"
 #include "voxel/MortonOctree.h"
 #include "voxel/VoxelUtils.h"
 #include "voxel/world/World.h"
@@ -96,42 +97,55 @@ void WorldGenerator::Generate(World* world)
       profiler.Start("Add nodes to octree");
 
       const uint32_t maxNode = vox::utils::MaxNode(World::SuperChunkSize) + 1;
-      int32_t        start = -1, end = -1;
-      uint8_t        texture;
-
-      for (int32_t i = 0; i < maxNode; i++)
+      int32_t        start = -1;
+      uint8_t        texture = 0;
+
+      // solid voxels with the same texture become one node per run of keys, runs end at chunk
+      // borders so every node stays inside one mesher chunk
+      auto flushRun = [&](uint32_t end) {
+        if (start == -1)
+          return;
+        chunk->Octree->AddOrphanNode(vox::VoxNode(start, end - start, texture, texture, texture));
+        totalNodesAdded++;
+        start = -1;
+      };
+
+      // keys are walked in order, so whole blocks of coordinates are decoded at once
+      static constexpr uint32_t DecodeBlockSize = 1024;
+      uint32_t blockX[DecodeBlockSize], blockY[DecodeBlockSize], blockZ[DecodeBlockSize];
+
+      for (uint32_t blockStart = 0; blockStart < maxNode; blockStart += DecodeBlockSize)
       {
-        auto [x, y, z] = vox::utils::Decode(i);
-        auto nval      = (int)nl.NoiseGenerator->GetNoise(x, z, 0);
+        const uint32_t blockSize = std::min(DecodeBlockSize, maxNode - blockStart);
+        vox::morton::DecodeRange(blockStart, blockX, blockY, blockZ, blockSize);
 
-        if (y <= nval)
+        for (uint32_t j = 0; j < blockSize; j++)
         {
+          const uint32_t i = blockStart + j;
+          const uint32_t x = blockX[j], y = blockY[j], z = blockZ[j];
+          auto           nval = (int)nl.NoiseGenerator->GetNoise(x, z, 0);
+
+          if (i % vox::VOXELS_IN_CHUNK == 0)
+            flushRun(i);
+
+          const bool solid = y <= nval;
+          if (!solid)
+          {
+            flushRun(i);
+            continue;
+          }
+
           auto t = GetTexture(y / 256.0);
-          chunk->Octree->AddOrphanNode(vox::VoxNode(i, 1, t, t, t));
+          if (start != -1 && t != texture)
+            flushRun(i);
+          if (start == -1)
+          {
+            start   = i;
+            texture = t;
+          }
         }
-        // this does not work as intended, probably due to mesher issues with bigger size voxels.
-        //        if (y <= nval)
-        //        {
-        //          auto t = GetTexture(y / 256.0);
-        //
-        //          if (start == -1)
-        //          {
-        //            start   = i;
-        //            texture = t;
-        //            continue;
-        //          }
-        //          else if (t != texture)
-        //          {
-        //            chunk->Octree->AddOrphanNode(vox::VoxNode(start, i - start, texture, texture,
-        //            texture)); start = -1;
-        //          }
-        //        }
-        //        else if (start != -1)
-        //        {
-        //          chunk->Octree->AddOrphanNode(vox::VoxNode(start, i - start, texture, texture,
-        //          texture)); start = -1;
-        //        }
       }
+      flushRun(maxNode);
 
       profiler.Stop();
 
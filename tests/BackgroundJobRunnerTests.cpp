@@ -0,0 +1,384 @@
+#include "threading/BackgroundJobRunner.h"
+#include "gtest/gtest.h"
+#include <chrono>
+#include <thread>
+
+namespace {
+class CountingJob : public threading::BackgroundJob
+{
+  public:
+  CountingJob(std::atomic<uint32_t>& runs, uint32_t& finalized)
+      : m_runs(runs)
+      , m_finalized(finalized)
+  {
+  }
+
+  void Run() final
+  {
+    m_runs++;
+  }
+
+  void FinalizeInMainThread() final
+  {
+    m_finalized++;
+  }
+
+  private:
+  std::atomic<uint32_t>& m_runs;
+  uint32_t&              m_finalized;
+};
+
+/// Spins in Run() until released.
+class BlockingJob : public threading::BackgroundJob
+{
+  public:
+  BlockingJob(std::atomic<bool>& started, std::atomic<bool>& release, std::atomic<bool>& finished)
+      : m_started(started)
+      , m_release(release)
+      , m_finished(finished)
+  {
+  }
+
+  void Run() final
+  {
+    m_started = true;
+    while (m_release == false)
+    {
+      std::this_thread::yield();
+    }
+    m_finished = true;
+  }
+
+  void FinalizeInMainThread() final {}
+
+  private:
+  std::atomic<bool>& m_started;
+  std::atomic<bool>& m_release;
+  std::atomic<bool>& m_finished;
+};
+
+/// Finalizes slowly and reports a fixed upload size.
+class UploadJob : public threading::BackgroundJob
+{
+  public:
+  UploadJob(std::atomic<uint32_t>& runs, std::chrono::microseconds finalizeTime, size_t bytes)
+      : m_runs(runs)
+      , m_finalizeTime(finalizeTime)
+      , m_bytes(bytes)
+  {
+  }
+
+  void Run() final
+  {
+    m_runs++;
+  }
+
+  void FinalizeInMainThread() final
+  {
+    std::this_thread::sleep_for(m_finalizeTime);
+  }
+
+  size_t GetFinalizationBytes() const final
+  {
+    return m_bytes;
+  }
+
+  private:
+  std::atomic<uint32_t>&    m_runs;
+  std::chrono::microseconds m_finalizeTime;
+  size_t                    m_bytes;
+};
+
+/// Appends its id to a shared list when it runs, unless it was cancelled.
+class OrderedJob : public threading::BackgroundJob
+{
+  public:
+  OrderedJob(uint32_t id, std::mutex& mutex, core::Vector<uint32_t>& order,
+             const std::atomic<bool>* cancelled = nullptr)
+      : m_id(id)
+      , m_mutex(mutex)
+      , m_order(order)
+      , m_cancelled(cancelled)
+  {
+  }
+
+  void Run() final
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_order.push_back(m_id);
+  }
+
+  void FinalizeInMainThread() final {}
+
+  bool IsCancelled() const final
+  {
+    return m_cancelled && m_cancelled->load();
+  }
+
+  uint32_t GetId() const
+  {
+    return m_id;
+  }
+
+  private:
+  uint32_t                 m_id;
+  std::mutex&              m_mutex;
+  core::Vector<uint32_t>&  m_order;
+  const std::atomic<bool>* m_cancelled;
+};
+
+/// Waits until count jobs are ready to be finalized, without finalizing any.
+void WaitForFinishedJobs(const threading::BackgroundJobRunner& runner, uint32_t count)
+{
+  const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+  while (runner.GetFinishedJobCount() < count && std::chrono::steady_clock::now() < deadline)
+  {
+    std::this_thread::yield();
+  }
+  EXPECT_EQ(count, runner.GetFinishedJobCount());
+}
+
+/// Occupies the only worker of a scheduler, so jobs queued meanwhile stay queued.
+struct BusyWorker
+{
+  explicit BusyWorker(threading::BackgroundJobRunner& runner)
+  {
+    runner.EnqueueBackgroundJob(new BlockingJob(Started, Release, Finished));
+    while (Started == false)
+    {
+      std::this_thread::yield();
+    }
+  }
+
+  std::atomic<bool> Started{ false }, Release{ false }, Finished{ false };
+};
+
+/// Releases the worker and finalizes until every job queued on runner came back.
+void DrainRunner(threading::BackgroundJobRunner& runner, BusyWorker& busy, uint32_t jobCount)
+{
+  busy.Release = true;
+
+  uint32_t   finalized = 0;
+  const auto deadline  = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+  while (finalized < jobCount && std::chrono::steady_clock::now() < deadline)
+  {
+    finalized += runner.Run().JobsFinalized;
+  }
+  EXPECT_EQ(jobCount, finalized);
+}
+} // namespace
+
+TEST(BackgroundJobRunnerTests, RunsAndFinalizesEveryJob)
+{
+  static constexpr uint32_t JobCount = 500;
+
+  std::atomic<uint32_t> runs{ 0 };
+  uint32_t              finalized = 0;
+  {
+    threading::JobScheduler        scheduler(4);
+    threading::BackgroundJobRunner runner(scheduler);
+    for (uint32_t i = 0; i < JobCount; i++)
+    {
+      runner.EnqueueBackgroundJob(new CountingJob(runs, finalized));
+    }
+
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (finalized < JobCount && std::chrono::steady_clock::now() < deadline)
+    {
+      runner.Run();
+    }
+  }
+
+  EXPECT_EQ(JobCount, runs.load());
+  EXPECT_EQ(JobCount, finalized);
+}
+
+TEST(BackgroundJobRunnerTests, RunnersShareOneScheduler)
+{
+  static constexpr uint32_t JobCount = 200;
+
+  std::atomic<uint32_t> runs{ 0 };
+  uint32_t              finalizedFirst = 0, finalizedSecond = 0;
+  {
+    threading::JobScheduler        scheduler(2);
+    threading::BackgroundJobRunner first(scheduler), second(scheduler);
+    for (uint32_t i = 0; i < JobCount; i++)
+    {
+      first.EnqueueBackgroundJob(new CountingJob(runs, finalizedFirst));
+      second.EnqueueBackgroundJob(new CountingJob(runs, finalizedSecond));
+    }
+
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while ((finalizedFirst < JobCount || finalizedSecond < JobCount) &&
+           std::chrono::steady_clock::now() < deadline)
+    {
+      first.Run();
+      second.Run();
+    }
+  }
+
+  EXPECT_EQ(2 * JobCount, runs.load());
+  EXPECT_EQ(JobCount, finalizedFirst);
+  EXPECT_EQ(JobCount, finalizedSecond);
+}
+
+TEST(BackgroundJobRunnerTests, DestructorWaitsForRunningJobsAndDropsQueuedOnes)
+{
+  threading::JobScheduler scheduler(1);
+  std::atomic<bool>       started{ false }, release{ false }, finished{ false };
+  std::atomic<uint32_t>   runs{ 0 };
+  uint32_t                finalized = 0;
+
+  std::thread releaser;
+  {
+    threading::BackgroundJobRunner runner(scheduler);
+    runner.EnqueueBackgroundJob(new BlockingJob(started, release, finished));
+    while (started == false)
+    {
+      std::this_thread::yield();
+    }
+    // The only worker is busy, so this one is still queued when the runner goes away.
+    runner.EnqueueBackgroundJob(new CountingJob(runs, finalized));
+
+    releaser = std::thread([&release]() {
+      std::this_thread::sleep_for(std::chrono::milliseconds(20));
+      release = true;
+    });
+  }
+
+  EXPECT_TRUE(finished.load());
+  releaser.join();
+
+  // Let the worker reach the dropped job.
+  threading::BackgroundJobRunner flush(scheduler);
+  uint32_t                       flushed = 0;
+  flush.EnqueueBackgroundJob(new CountingJob(runs, flushed));
+  const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+  while (flushed == 0 && std::chrono::steady_clock::now() < deadline)
+  {
+    flush.Run();
+  }
+
+  EXPECT_EQ(1u, runs.load());
+  EXPECT_EQ(0u, finalized);
+}
+
+TEST(BackgroundJobRunnerTests, FinalizesUntilTimeBudgetIsUsedUp)
+{
+  static constexpr uint32_t JobCount = 20;
+
+  threading::JobScheduler        scheduler(2);
+  threading::BackgroundJobRunner runner(scheduler);
+  std::atomic<uint32_t>          runs{ 0 };
+  for (uint32_t i = 0; i < JobCount; i++)
+  {
+    runner.EnqueueBackgroundJob(new UploadJob(runs, std::chrono::microseconds(1000), 0));
+  }
+  WaitForFinishedJobs(runner, JobCount);
+
+  threading::FinalizationBudget budget;
+  budget.Time = std::chrono::microseconds(3000);
+
+  const auto first = runner.Run(budget);
+  EXPECT_GE(first.JobsFinalized, 1u);
+  EXPECT_LT(first.JobsFinalized, JobCount);
+  EXPECT_EQ(JobCount, first.JobsFinalized + first.JobsPending);
+  EXPECT_GE(first.TimeSpent, budget.Time);
+
+  uint32_t finalized = first.JobsFinalized;
+  while (finalized < JobCount)
+  {
+    finalized += runner.Run(budget).JobsFinalized;
+  }
+  EXPECT_EQ(JobCount, finalized);
+  EXPECT_EQ(0u, runner.Run(budget).JobsFinalized);
+}
+
+TEST(BackgroundJobRunnerTests, StopsAtByteBudgetButFinalizesAtLeastOneJob)
+{
+  static constexpr uint32_t JobCount = 10;
+
+  threading::JobScheduler        scheduler(2);
+  threading::BackgroundJobRunner runner(scheduler);
+  std::atomic<uint32_t>          runs{ 0 };
+  for (uint32_t i = 0; i < JobCount; i++)
+  {
+    runner.EnqueueBackgroundJob(new UploadJob(runs, std::chrono::microseconds(0), 100));
+  }
+  WaitForFinishedJobs(runner, JobCount);
+
+  threading::FinalizationBudget budget;
+  budget.Bytes = 250;
+
+  const auto stats = runner.Run(budget);
+  EXPECT_EQ(2u, stats.JobsFinalized);
+  EXPECT_EQ(200u, stats.BytesFinalized);
+  EXPECT_EQ(JobCount - 2, stats.JobsPending);
+
+  // A single job over the budget still goes through, or it would never be finalized.
+  budget.Bytes = 50;
+  EXPECT_EQ(1u, runner.Run(budget).JobsFinalized);
+}
+
+TEST(BackgroundJobRunnerTests, RunsLowestPriorityValueFirst)
+{
+  threading::JobScheduler        scheduler(1);
+  threading::BackgroundJobRunner runner(scheduler);
+  std::mutex                     mutex;
+  core::Vector<uint32_t>         order;
+
+  BusyWorker busy(runner);
+  runner.EnqueueBackgroundJob(new OrderedJob(0, mutex, order), 5.f);
+  runner.EnqueueBackgroundJob(new OrderedJob(1, mutex, order), 1.f);
+  runner.EnqueueBackgroundJob(new OrderedJob(2, mutex, order), 3.f);
+  runner.EnqueueBackgroundJob(new OrderedJob(3, mutex, order), 1.f);
+  EXPECT_EQ(4u, runner.GetPendingJobCount());
+  DrainRunner(runner, busy, 5);
+
+  // Equal priorities keep their queue order.
+  EXPECT_EQ((core::Vector<uint32_t>{ 1, 3, 2, 0 }), order);
+}
+
+TEST(BackgroundJobRunnerTests, ReprioritizesQueuedJobs)
+{
+  threading::JobScheduler        scheduler(1);
+  threading::BackgroundJobRunner runner(scheduler);
+  std::mutex                     mutex;
+  core::Vector<uint32_t>         order;
+
+  BusyWorker busy(runner);
+  for (uint32_t id = 0; id < 4; id++)
+  {
+    runner.EnqueueBackgroundJob(new OrderedJob(id, mutex, order), float(id));
+  }
+  runner.Reprioritize([](const threading::BackgroundJob& job) {
+    return -float(static_cast<const OrderedJob&>(job).GetId());
+  });
+  DrainRunner(runner, busy, 5);
+
+  EXPECT_EQ((core::Vector<uint32_t>{ 3, 2, 1, 0 }), order);
+}
+
+TEST(BackgroundJobRunnerTests, DropsCancelledJobsBeforeTheyRun)
+{
+  threading::JobScheduler        scheduler(1);
+  threading::BackgroundJobRunner runner(scheduler);
+  std::mutex                     mutex;
+  core::Vector<uint32_t>         order;
+  std::atomic<bool>              cancelledEarly{ false }, cancelledLate{ false };
+
+  BusyWorker busy(runner);
+  runner.EnqueueBackgroundJob(new OrderedJob(0, mutex, order, &cancelledEarly));
+  runner.EnqueueBackgroundJob(new OrderedJob(1, mutex, order));
+  runner.EnqueueBackgroundJob(new OrderedJob(2, mutex, order, &cancelledLate));
+
+  // Reprioritize moves the first one out of the queue, the worker skips the last one.
+  cancelledEarly = true;
+  runner.Reprioritize([](const threading::BackgroundJob&) { return 0.f; });
+  EXPECT_EQ(2u, runner.GetPendingJobCount());
+  cancelledLate = true;
+
+  // Cancelled jobs are still finalized.
+  DrainRunner(runner, busy, 4);
+  EXPECT_EQ((core::Vector<uint32_t>{ 1 }), order);
+}
@@ -0,0 +1,325 @@
+#include "voxel/ChunkMesher.h"
+#include "voxel/Morton.h"
+#include "voxel/VoxelMesh.h"
+#include "gtest/gtest.h"
+#include <random>
+
+namespace {
+void ExpectSameMesh(const vox::VoxelMesh& expected, const vox::VoxelMesh& actual)
+{
+  ASSERT_EQ(expected.Vertices.size(), actual.Vertices.size());
+  ASSERT_EQ(expected.Indices, actual.Indices);
+  for (size_t i = 0; i < expected.Vertices.size(); i++)
+  {
+    ASSERT_EQ(expected.Vertices[i], actual.Vertices[i]) << i;
+    ASSERT_EQ(expected.UVs[i], actual.UVs[i]) << i;
+    ASSERT_EQ(expected.Normals[i], actual.Normals[i]) << i;
+  }
+}
+} // namespace
+
+TEST(ChunkMesherTests, BinaryGreedyMatchesGreedy)
+{
+  using EMode = vox::ChunkMesher::EMode;
+
+  auto greedy = std::make_unique<vox::ChunkMesher>(EMode::Greedy);
+  auto binary = std::make_unique<vox::ChunkMesher>(EMode::BinaryGreedy);
+
+  std::mt19937 rng(3);
+  for (uint32_t chunk = 0; chunk < 6; chunk++)
+  {
+    // Noise, terrain runs and a checkerboard, in a few colors.
+    core::Vector<vox::VoxNode> nodes;
+    for (uint32_t key = 0; key < 32 * 32 * 32; key++)
+    {
+      uint32_t x, y, z;
+      vox::decodeMK(key, x, y, z);
+
+      bool solid = rng() % 3 == 0;
+      if (chunk % 3 == 1)
+        solid = y < 10 + (x * 7 + z * 3) % 12;
+      else if (chunk % 3 == 2)
+        solid = (x + y + z) % 2 == 0;
+      if (!solid)
+        continue;
+
+      const uint8_t color = chunk % 3 == 1 ? (y < 15 ? 1 : 2) : uint8_t(rng() % 3);
+      const uint32_t start = chunk << 15 | key;
+      if (!nodes.empty() && nodes.back().start + nodes.back().size == start &&
+          nodes.back().r == color)
+        nodes.back().size++;
+      else
+        nodes.emplace_back(start, 1, color, color, color);
+    }
+
+    vox::VoxelMesh expected(nullptr), actual(nullptr);
+    greedy->BuildChunk(nodes.begin(), nodes.end(), &expected);
+    binary->BuildChunk(nodes.begin(), nodes.end(), &actual);
+    ExpectSameMesh(expected, actual);
+  }
+}
+
+TEST(ChunkMesherTests, ApronCullsFacesAcrossChunkBorders)
+{
+  using EMode = vox::ChunkMesher::EMode;
+
+  core::Vector<vox::VoxNode> solid{ vox::VoxNode(0, 32 * 32 * 32, 1, 1, 1) };
+  auto                       mesher = std::make_unique<vox::ChunkMesher>(EMode::BinaryGreedy);
+
+  // A full chunk is one quad per side, buried between full neighbors it has none.
+  vox::VoxelMesh open(nullptr), buried(nullptr), partly(nullptr);
+  mesher->BuildChunk(solid.begin(), solid.end(), &open);
+  EXPECT_EQ(6u * 4, open.Vertices.size());
+
+  vox::ChunkOccupancy full;
+  for (uint32_t x = 0; x < 32; x++)
+    for (uint32_t z = 0; z < 32; z++)
+      full.Columns[x][z] = ~0u;
+
+  vox::ChunkApron apron;
+  for (uint8_t side = 0; side < 6; side++)
+    apron.SetSide(vox::ChunkApron::ESide(side), full);
+  mesher->BuildChunk(solid.begin(), solid.end(), &buried, apron);
+  EXPECT_TRUE(buried.Vertices.empty());
+
+  // Only the upper half of the chunk above is solid, so only its lower layer counts.
+  vox::ChunkOccupancy upperHalf;
+  for (uint32_t x = 0; x < 32; x++)
+    for (uint32_t z = 0; z < 32; z++)
+      upperHalf.Columns[x][z] = 0xffff0000u;
+  apron.SetSide(vox::ChunkApron::PosY, upperHalf);
+  mesher->BuildChunk(solid.begin(), solid.end(), &partly, apron);
+  EXPECT_EQ(4u, partly.Vertices.size());
+
+  // Rows hold the neighbor layer touching the chunk, in the documented layout.
+  vox::ChunkOccupancy neighbor;
+  neighbor.Set(3, 5, 0);
+  neighbor.Set(3, 31, 7);
+  neighbor.Set(31, 9, 2);
+  apron.SetSide(vox::ChunkApron::PosZ, neighbor);
+  apron.SetSide(vox::ChunkApron::NegY, neighbor);
+  apron.SetSide(vox::ChunkApron::NegX, neighbor);
+  EXPECT_EQ(1u << 3, apron.Rows[vox::ChunkApron::PosZ][5]);
+  EXPECT_EQ(1u << 3, apron.Rows[vox::ChunkApron::NegY][7]);
+  EXPECT_EQ(1u << 9, apron.Rows[vox::ChunkApron::NegX][2]);
+
+  // Both modes read the apron the same way.
+  std::mt19937 rng(5);
+  for (auto& rows : apron.Rows)
+    for (auto& row : rows)
+      row = rng();
+
+  core::Vector<vox::VoxNode> noise;
+  for (uint32_t key = 0; key < 32 * 32 * 32; key++)
+    if (rng() % 2)
+      noise.emplace_back(key, 1, 1, 1, 1);
+
+  vox::VoxelMesh expected(nullptr), actual(nullptr);
+  std::make_unique<vox::ChunkMesher>(EMode::Greedy)->BuildChunk(noise.begin(), noise.end(),
+                                                                &expected, apron);
+  mesher->BuildChunk(noise.begin(), noise.end(), &actual, apron);
+  ExpectSameMesh(expected, actual);
+}
+
+TEST(ChunkMesherTests, PackedVerticesMatchFloatVertices)
+{
+  core::Vector<vox::VoxNode> nodes;
+  std::mt19937               rng(9);
+  for (uint32_t key = 0; key < 32 * 32 * 32; key++)
+    if (rng() % 4 == 0)
+      nodes.emplace_back(key, 1, uint8_t(rng() % 200), uint8_t(rng() % 200), uint8_t(rng() % 200));
+
+  auto           mesher = std::make_unique<vox::ChunkMesher>();
+  vox::VoxelMesh floats(nullptr), packed(nullptr, vox::VoxelMesh::EVertexFormat::Packed);
+  mesher->BuildChunk(nodes.begin(), nodes.end(), &floats);
+  mesher->BuildChunk(nodes.begin(), nodes.end(), &packed);
+
+  ASSERT_EQ(floats.Vertices.size(), packed.PackedVertices.size());
+  EXPECT_TRUE(packed.Vertices.empty());
+  EXPECT_TRUE(packed.Indices.empty());
+
+  // The GPU gets the words as float32, voxel.vert converts them back.
+  for (const auto& vertex : packed.PackedVertices)
+  {
+    const glm::vec2 gpu = vertex.ToFloat32();
+    ASSERT_EQ(vertex.PositionNormal, uint32_t(gpu.x));
+    ASSERT_EQ(vertex.UVTexture, uint32_t(gpu.y));
+  }
+
+  // Vertices as comparable tuples, triangles rotated to start at their smallest vertex.
+  using Vertex = std::tuple<float, float, float, float, float, float, float, float, float>;
+  auto floatVertex = [&](uint32_t i) {
+    const auto &p = floats.Vertices[i], &uv = floats.UVs[i], &n = floats.Normals[i];
+    return Vertex(p.x, p.y, p.z, uv.x, uv.y, uv.z, n.x, n.y, n.z);
+  };
+  const glm::vec3 normals[] = { { 1, 0, 0 },  { -1, 0, 0 }, { 0, 1, 0 },
+                                { 0, -1, 0 }, { 0, 0, 1 },  { 0, 0, -1 } };
+  auto packedVertex = [&](uint32_t i) {
+    const auto&     vertex = packed.PackedVertices[i];
+    const glm::vec3 n      = normals[(vertex.PositionNormal >> 18) & 7u];
+    return Vertex(vertex.PositionNormal & 63u, (vertex.PositionNormal >> 6) & 63u,
+                  (vertex.PositionNormal >> 12) & 63u, vertex.UVTexture & 63u,
+                  (vertex.UVTexture >> 6) & 63u, (vertex.UVTexture >> 16) & 255u, n.x, n.y, n.z);
+  };
+  auto triangle = [](Vertex a, Vertex b, Vertex c) {
+    while (a > b || a > c)
+    {
+      std::swap(a, b);
+      std::swap(b, c);
+    }
+    return std::make_tuple(a, b, c);
+  };
+
+  const size_t quadCount = packed.PackedVertices.size() / 4;
+  const auto&  indices   = vox::VoxelMesh::GetQuadIndices(quadCount);
+  ASSERT_GE(indices.size(), quadCount * 6);
+  ASSERT_EQ(floats.Indices.size(), quadCount * 6);
+  for (size_t i = 0; i < quadCount * 6; i += 3)
+  {
+    const uint32_t* f = &floats.Indices[i];
+    const uint32_t* p = &indices[i];
+    ASSERT_EQ(triangle(floatVertex(f[0]), floatVertex(f[1]), floatVertex(f[2])),
+              triangle(packedVertex(p[0]), packedVertex(p[1]), packedVertex(p[2])))
+        << i;
+  }
+
+  // The GPU index buffer stays within one capacity step of the quads it draws.
+  const size_t capacity = vox::VoxelMesh::GetQuadIndexCapacity(quadCount);
+  EXPECT_GE(capacity, quadCount);
+  EXPECT_LT(capacity, quadCount + 256);
+  EXPECT_EQ(0u, vox::VoxelMesh::GetQuadIndexCapacity(0));
+}
+
+TEST(ChunkMesherTests, UpdateVoxelMatchesRebuild)
+{
+  using EMode   = vox::ChunkMesher::EMode;
+  using EFormat = vox::VoxelMesh::EVertexFormat;
+
+  std::mt19937 rng(11);
+  for (EMode mode : { EMode::Greedy, EMode::BinaryGreedy })
+    for (EFormat format : { EFormat::Float, EFormat::Packed })
+    {
+      // Colors of the solid cells, 0 is empty.
+      core::Vector<uint8_t> colors(32 * 32 * 32);
+      for (auto& color : colors)
+        color = rng() % 2 ? uint8_t(1 + rng() % 2) : 0;
+
+      vox::ChunkApron apron;
+      for (auto& rows : apron.Rows)
+        for (auto& row : rows)
+          row = rng();
+
+      auto nodesOf = [&colors]() {
+        core::Vector<vox::VoxNode> nodes;
+        for (uint32_t key = 0; key < colors.size(); key++)
+          if (colors[key])
+            nodes.emplace_back(key, 1, colors[key], colors[key], colors[key]);
+        return nodes;
+      };
+
+      auto           mesher    = std::make_unique<vox::ChunkMesher>(mode);
+      auto           rebuilder = std::make_unique<vox::ChunkMesher>(mode);
+      vox::VoxelMesh mesh(nullptr, format);
+      auto           nodes = nodesOf();
+      mesher->BuildChunk(nodes.begin(), nodes.end(), &mesh, apron);
+
+      for (uint32_t edit = 0; edit < 40; edit++)
+      {
+        // Mostly cells of the chunk, some on the apron: one axis just outside the chunk.
+        glm::ivec3 cell(rng() % 32, rng() % 32, rng() % 32);
+        const bool onApron = rng() % 4 == 0;
+        const uint32_t axis = rng() % 3;
+        if (onApron)
+          cell[axis] = rng() % 2 ? -1 : 32;
+
+        const bool    solid = rng() % 2;
+        const uint8_t color = uint8_t(1 + rng() % 2);
+        vox::VoxNode  node(0, 1, color, color, color);
+        mesher->UpdateVoxel(&mesh, cell, solid ? &node : nullptr);
+
+        if (!onApron)
+        {
+          colors[vox::encodeMK(cell.x, cell.y, cell.z)] = solid ? color : 0;
+        }
+        else
+        {
+          // The x sides hold rows along y indexed by z, the others rows along x.
+          const auto side = vox::ChunkApron::ESide(2 * axis + (cell[axis] < 0 ? 0 : 1));
+          const uint32_t row = axis == 2 ? cell.y : cell.z;
+          const uint32_t bit = axis == 0 ? cell.y : cell.x;
+          if (solid)
+            apron.Rows[side][row] |= 1u << bit;
+          else
+            apron.Rows[side][row] &= ~(1u << bit);
+        }
+
+        vox::VoxelMesh rebuilt(nullptr, format);
+        nodes = nodesOf();
+        rebuilder->BuildChunk(nodes.begin(), nodes.end(), &rebuilt, apron);
+
+        ExpectSameMesh(rebuilt, mesh);
+        ASSERT_EQ(rebuilt.PackedVertices.size(), mesh.PackedVertices.size());
+        for (size_t i = 0; i < mesh.PackedVertices.size(); i++)
+        {
+          const auto &expected = rebuilt.PackedVertices[i], &actual = mesh.PackedVertices[i];
+          ASSERT_EQ(expected.PositionNormal, actual.PositionNormal) << i;
+          ASSERT_EQ(expected.UVTexture, actual.UVTexture) << i;
+        }
+        ASSERT_TRUE(std::equal(rebuilt.SliceQuadStart, std::end(rebuilt.SliceQuadStart),
+                               mesh.SliceQuadStart));
+      }
+    }
+}
+
+TEST(ChunkMesherTests, AmbientOcclusionDarkensCornersNextToBlocks)
+{
+  // A floor one voxel thick with a single block on top of it at (5, 1, 5).
+  core::Vector<vox::VoxNode> nodes;
+  for (uint32_t key = 0; key < 32 * 32 * 32; key++)
+  {
+    uint32_t x, y, z;
+    vox::decodeMK(key, x, y, z);
+    if (y == 0 || (x == 5 && y == 1 && z == 5))
+      nodes.emplace_back(key, 1, 1, 1, 1);
+  }
+
+  auto           mesher = std::make_unique<vox::ChunkMesher>();
+  vox::VoxelMesh mesh(nullptr, vox::VoxelMesh::EVertexFormat::Packed);
+  mesher->BuildChunk(nodes.begin(), nodes.end(), &mesh);
+
+  uint32_t darkFloorCorners = 0;
+  for (const auto& vertex : mesh.PackedVertices)
+  {
+    const uint32_t x = vertex.PositionNormal & 63u, y = (vertex.PositionNormal >> 6) & 63u,
+                   z = (vertex.PositionNormal >> 12) & 63u;
+    const uint32_t normal = (vertex.PositionNormal >> 18) & 7u;
+    const uint32_t ao     = (vertex.PositionNormal >> 21) & 3u;
+    const bool     onBlock = x >= 5 && x <= 6 && z >= 5 && z <= 6;
+
+    if (normal == vox::PackedVoxelVertex::PosY && y == 1)
+    {
+      // The floor corners under the block see it on one side only.
+      EXPECT_EQ(onBlock ? 2u : 3u, ao) << x << " " << z;
+      darkFloorCorners += onBlock;
+    }
+    else if (normal != vox::PackedVoxelVertex::PosY && normal != vox::PackedVoxelVertex::NegY &&
+             y == 1 && onBlock)
+    {
+      // The sides of the block meet the floor along their bottom edge.
+      EXPECT_EQ(1u, ao) << x << " " << z;
+    }
+    else
+    {
+      EXPECT_EQ(3u, ao) << x << " " << y << " " << z;
+    }
+  }
+  // Two corners of each of the four floor cells beside the block, one of each diagonal cell.
+  EXPECT_EQ(12u, darkFloorCorners);
+
+  vox::VoxelMesh flat(nullptr, vox::VoxelMesh::EVertexFormat::Packed);
+  mesher->SetAmbientOcclusion(false);
+  mesher->BuildChunk(nodes.begin(), nodes.end(), &flat);
+  EXPECT_LT(flat.PackedVertices.size(), mesh.PackedVertices.size());
+  for (const auto& vertex : flat.PackedVertices)
+    EXPECT_EQ(3u, (vertex.PositionNormal >> 21) & 3u);
+}
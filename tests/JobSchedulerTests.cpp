@@ -0,0 +1,129 @@
+#include "threading/JobScheduler.h"
+#include "threading/WorkStealingDeque.h"
+#include "gtest/gtest.h"
+#include <chrono>
+#include <functional>
+#include <thread>
+
+TEST(JobSchedulerTests, DequeOwnerPopsNewestAndThievesStealOldest)
+{
+  threading::WorkStealingDeque<int> deque(2);
+  int                               items[5] = { 0, 1, 2, 3, 4 };
+
+  // Pushes past the initial capacity, so the deque has to grow.
+  for (int& item : items)
+  {
+    deque.Push(&item);
+  }
+
+  EXPECT_EQ(&items[0], deque.Steal());
+  EXPECT_EQ(&items[4], deque.Pop());
+  EXPECT_EQ(&items[1], deque.Steal());
+  EXPECT_EQ(&items[3], deque.Pop());
+  EXPECT_EQ(&items[2], deque.Pop());
+  EXPECT_EQ(nullptr, deque.Pop());
+  EXPECT_EQ(nullptr, deque.Steal());
+  EXPECT_TRUE(deque.IsEmpty());
+}
+
+TEST(JobSchedulerTests, DequeHandsOutEveryItemOnceUnderContention)
+{
+  static constexpr int ItemCount   = 100000;
+  static constexpr int ThiefCount = 3;
+
+  threading::WorkStealingDeque<int> deque(64);
+  core::Vector<int>                 items(ItemCount);
+  core::Vector<std::atomic<int>>    taken(ItemCount);
+  std::atomic<bool>                 done{ false };
+
+  auto take = [&](int* item) { taken[item - items.data()]++; };
+
+  core::Vector<std::thread> thieves;
+  for (int i = 0; i < ThiefCount; i++)
+  {
+    thieves.emplace_back([&]() {
+      while (done == false || deque.IsEmpty() == false)
+      {
+        if (int* item = deque.Steal())
+        {
+          take(item);
+        }
+      }
+    });
+  }
+
+  for (int i = 0; i < ItemCount; i++)
+  {
+    deque.Push(&items[i]);
+    if (i % 3 == 0)
+    {
+      if (int* item = deque.Pop())
+      {
+        take(item);
+      }
+    }
+  }
+  while (int* item = deque.Pop())
+  {
+    take(item);
+  }
+  done = true;
+
+  for (auto& thief : thieves)
+  {
+    thief.join();
+  }
+
+  for (int i = 0; i < ItemCount; i++)
+  {
+    ASSERT_EQ(1, taken[i].load()) << "item " << i;
+  }
+}
+
+TEST(JobSchedulerTests, RunsTasksSubmittedFromWorkers)
+{
+  static constexpr uint32_t Depth = 12;
+
+  std::atomic<uint32_t> leaves{ 0 };
+  {
+    threading::JobScheduler scheduler(4);
+
+    // Every task below Depth submits two more from its worker thread.
+    std::function<void(uint32_t)> spawn = [&](uint32_t depth) {
+      if (depth == Depth)
+      {
+        leaves++;
+        return;
+      }
+      scheduler.SubmitFunction([&spawn, depth]() { spawn(depth + 1); });
+      scheduler.SubmitFunction([&spawn, depth]() { spawn(depth + 1); });
+    };
+    scheduler.SubmitFunction([&spawn]() { spawn(0); });
+
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (leaves < (1u << Depth) && std::chrono::steady_clock::now() < deadline)
+    {
+      std::this_thread::yield();
+    }
+  }
+
+  EXPECT_EQ(1u << Depth, leaves.load());
+}
+
+TEST(JobSchedulerTests, ShutsDownIdleWorkersRightAway)
+{
+  // Idle workers block until woken. A missed wakeup would hang the destructor, the generous
+  // bound only keeps a loaded machine from failing the test.
+  const auto start = std::chrono::steady_clock::now();
+  {
+    threading::JobScheduler scheduler(4);
+  }
+  EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::seconds(1));
+}
+
+TEST(JobSchedulerTests, SizesDefaultSchedulerFromHardware)
+{
+  EXPECT_GE(threading::JobScheduler::GetDefaultWorkerCount(), 1u);
+  EXPECT_EQ(threading::JobScheduler::GetDefaultWorkerCount(),
+            threading::JobScheduler::Get().GetWorkerCount());
+}
@@ -0,0 +1,649 @@
+#include "core/AxisAlignedBoundingBox.h"
+#include "voxel/VoxelInc.h"
+#include "gtest/gtest.h"
+#include <map>
+#include <random>
+#include <set>
+
+namespace {
+template <class TOctree> core::Vector<uint32_t> Keys(TOctree& octree)
+{
+  core::Vector<uint32_t> keys;
+  for (const auto& node : octree.GetNodes())
+    keys.push_back(node.start);
+  return keys;
+}
+
+void ExpectChunkDirectoryMatchesNodes(vox::MortonOctree& octree)
+{
+  const size_t chunkCount = octree.GetChunkCount();
+  const auto&  nodes      = octree.GetNodes();
+
+  size_t node = 0;
+  for (size_t chunk = 0; chunk < chunkCount + 2; chunk++)
+  {
+    const size_t begin = node;
+    uint32_t     live  = 0;
+    for (; node < nodes.size() && vox::utils::GetChunkIndex(nodes[node].start) == chunk; node++)
+      live += !nodes[node].IsTombstone();
+
+    const auto range = octree.GetChunkRange(chunk);
+    EXPECT_EQ(begin, range.begin);
+    EXPECT_EQ(node, range.end);
+    EXPECT_EQ(live, range.liveCount);
+  }
+  EXPECT_EQ(nodes.size(), node);
+}
+} // namespace
+
+TEST(MortonOctreeTests, ApplyEditsMatchesPerNodeEdits)
+{
+  std::mt19937                            rng(7);
+  std::uniform_int_distribution<uint32_t> coord(0, 31);
+
+  vox::MortonOctree          batched, reference;
+  core::Vector<vox::VoxNode> nodes;
+  for (uint32_t i = 0; i < 2000; i++)
+  {
+    vox::VoxNode node(coord(rng), coord(rng), coord(rng));
+    reference.AddNode(node);
+    nodes.push_back(node);
+  }
+  batched.AddNodes(core::Move(nodes));
+  batched.ApplyEdits({});
+  EXPECT_EQ(Keys(reference), Keys(batched));
+
+  auto                         referenceKeys = Keys(reference);
+  std::set<uint32_t>           expected(referenceKeys.begin(), referenceKeys.end());
+  vox::MortonOctree::EditBatch batch;
+  for (uint32_t i = 0; i < 3000; i++)
+  {
+    uint32_t x = coord(rng), y = coord(rng), z = coord(rng);
+    if (rng() % 3 == 0)
+    {
+      batch.Remove(x, y, z);
+      expected.erase(vox::encodeMK(x, y, z));
+    }
+    else
+    {
+      batch.Add(vox::VoxNode(x, y, z));
+      expected.insert(vox::encodeMK(x, y, z));
+    }
+  }
+  batched.ApplyEdits(core::Move(batch));
+
+  EXPECT_TRUE(batched.IsSorted());
+  EXPECT_EQ(core::Vector<uint32_t>(expected.begin(), expected.end()), Keys(batched));
+}
+
+TEST(MortonOctreeTests, LastEditOfAKeyWins)
+{
+  vox::MortonOctree octree;
+  octree.AddNodes({ vox::VoxNode(1, 1, 1), vox::VoxNode(2, 2, 2) });
+
+  vox::MortonOctree::EditBatch batch;
+  batch.Remove(1, 1, 1);
+  batch.Add(vox::VoxNode(vox::encodeMK(1, 1, 1), 1, 10, 20, 30));
+  batch.Add(vox::VoxNode(3, 3, 3));
+  batch.Remove(2, 2, 2);
+  batch.Add(vox::VoxNode(2, 2, 2));
+  batch.Remove(2, 2, 2);
+  octree.ApplyEdits(core::Move(batch));
+
+  ASSERT_EQ(2u, octree.GetNodes().size());
+  EXPECT_TRUE(octree.CheckNode(1, 1, 1));
+  EXPECT_FALSE(octree.CheckNode(2, 2, 2));
+  EXPECT_TRUE(octree.CheckNode(3, 3, 3));
+  EXPECT_EQ(10, octree.GetNodes()[0].r);
+}
+
+TEST(MortonOctreeTests, SortLeafNodesMergesAppendedTail)
+{
+  vox::MortonOctree octree;
+  for (uint32_t x = 0; x < 64; x += 2)
+    octree.AddOrphanNode(vox::VoxNode(x, 0, 0));
+  octree.SortLeafNodes();
+
+  for (uint32_t x = 63; x < 64; x -= 2)
+    octree.AddOrphanNode(vox::VoxNode(x, 0, 0));
+  octree.SortLeafNodes();
+
+  EXPECT_TRUE(octree.IsSorted());
+  EXPECT_EQ(64u, octree.GetNodes().size());
+}
+
+TEST(MortonOctreeTests, RemovedNodesAreDeadUntilCompacted)
+{
+  vox::MortonOctree octree;
+  for (uint32_t x = 0; x < 64; x++)
+    octree.AddOrphanNode(vox::VoxNode(x, 0, 0));
+  octree.SortLeafNodes();
+
+  EXPECT_TRUE(octree.RemoveNode(5, 0, 0));
+  EXPECT_FALSE(octree.RemoveNode(5, 0, 0));
+  EXPECT_FALSE(octree.CheckNode(5, 0, 0));
+  EXPECT_FALSE(octree.AnyNodeInBox(glm::uvec3(5, 0, 0), glm::uvec3(5, 0, 0)));
+  EXPECT_EQ(1u, octree.GetTombstoneCount());
+  EXPECT_EQ(64u, octree.GetNodes().size());
+
+  // Re-adding a removed key revives the tombstone in place.
+  octree.AddNode(vox::VoxNode(5, 0, 0));
+  EXPECT_TRUE(octree.CheckNode(5, 0, 0));
+  EXPECT_EQ(0u, octree.GetTombstoneCount());
+
+  for (uint32_t x = 0; x < 8; x++)
+    octree.RemoveNode(x, 0, 0);
+  EXPECT_EQ(8u, octree.GetTombstoneCount());
+  EXPECT_EQ(64u, octree.GetNodes().size());
+
+  // The ninth removal crosses the 1/8 threshold.
+  octree.RemoveNode(8, 0, 0);
+  EXPECT_EQ(0u, octree.GetTombstoneCount());
+  EXPECT_EQ(55u, octree.GetNodes().size());
+  EXPECT_TRUE(octree.IsSorted());
+  EXPECT_TRUE(octree.CheckNode(9, 0, 0));
+}
+
+TEST(MortonOctreeTests, RemoveNodeIgnoresUnsortedTail)
+{
+  vox::MortonOctree octree;
+  for (uint32_t x = 10; x < 64; x++)
+    octree.AddOrphanNode(vox::VoxNode(x, 0, 0));
+  octree.SortLeafNodes();
+  for (uint32_t x = 0; x < 10; x++)
+    octree.AddOrphanNode(vox::VoxNode(x, 0, 0));
+
+  EXPECT_TRUE(octree.RemoveNode(40, 0, 0));
+  EXPECT_EQ(1u, octree.GetTombstoneCount());
+
+  octree.SortLeafNodes();
+  EXPECT_FALSE(octree.CheckNode(40, 0, 0));
+  for (uint32_t x = 0; x < 10; x++)
+    EXPECT_TRUE(octree.CheckNode(x, 0, 0)) << x;
+}
+
+TEST(MortonOctreeTests, RemoveDuplicateNodesKeepsNewestNode)
+{
+  vox::MortonOctree octree;
+  octree.AddOrphanNode(vox::VoxNode(vox::encodeMK(1, 0, 0), 1, 1, 1, 1));
+  octree.AddOrphanNode(vox::VoxNode(vox::encodeMK(2, 0, 0), 1, 1, 1, 1));
+  octree.AddOrphanNode(vox::VoxNode(vox::encodeMK(1, 0, 0), 1, 2, 2, 2));
+  octree.AddOrphanNode(vox::VoxNode(vox::encodeMK(1, 0, 0), 1, 3, 3, 3));
+  octree.RemoveDuplicateNodes();
+
+  ASSERT_EQ(2u, octree.GetNodes().size());
+  EXPECT_EQ(vox::encodeMK(1, 0, 0), octree.GetNodes()[0].start);
+  EXPECT_EQ(3, octree.GetNodes()[0].r);
+  EXPECT_EQ(vox::encodeMK(2, 0, 0), octree.GetNodes()[1].start);
+}
+
+TEST(MortonOctreeTests, SoaStorageMatchesAosStorage)
+{
+  std::mt19937                            rng(11);
+  std::uniform_int_distribution<uint32_t> coord(0, 63);
+
+  vox::MortonOctree    aos;
+  vox::MortonOctreeSoa soa;
+  for (uint32_t i = 0; i < 5000; i++)
+  {
+    vox::VoxNode node(vox::encodeMK(coord(rng), coord(rng), coord(rng)), 1, i, i >> 8, 7);
+    aos.AddOrphanNode(node);
+    soa.AddOrphanNode(node);
+  }
+  aos.RemoveDuplicateNodes();
+  soa.RemoveDuplicateNodes();
+
+  vox::MortonOctree::EditBatch    aosBatch;
+  vox::MortonOctreeSoa::EditBatch soaBatch;
+  for (uint32_t i = 0; i < 500; i++)
+  {
+    uint32_t x = coord(rng), y = coord(rng), z = coord(rng);
+    aosBatch.Remove(x, y, z);
+    soaBatch.Remove(x, y, z);
+    aos.AddNode(vox::VoxNode(y, z, x));
+    soa.AddNode(vox::VoxNode(y, z, x));
+    aos.RemoveNode(z, x, y);
+    soa.RemoveNode(z, x, y);
+  }
+  aos.ApplyEdits(core::Move(aosBatch));
+  soa.ApplyEdits(core::Move(soaBatch));
+
+  ASSERT_EQ(Keys(aos), Keys(soa));
+  for (size_t i = 0; i < aos.GetNodes().size(); i++)
+  {
+    EXPECT_EQ(aos.GetNodes()[i].r, soa.GetNodes()[i].r);
+    EXPECT_EQ(aos.GetNodes()[i].g, soa.GetNodes()[i].g);
+  }
+
+  for (uint32_t i = 0; i < 1000; i++)
+  {
+    uint32_t x = coord(rng), y = coord(rng), z = coord(rng);
+    EXPECT_EQ(aos.CheckNode(x, y, z), soa.CheckNode(x, y, z));
+  }
+
+  const glm::uvec3 min(10, 20, 30), max(30, 40, 50);
+  uint32_t         aosCount = 0, soaCount = 0;
+  aos.ForEachNodeInBox(min, max, [&](const vox::VoxNode&) { return ++aosCount; });
+  soa.ForEachNodeInBox(min, max, [&](const vox::VoxNode&) { return ++soaCount; });
+  EXPECT_EQ(aosCount, soaCount);
+  EXPECT_GT(aosCount, 0u);
+}
+
+template <class TKey> void ExpectSearchIndexMatchesBinarySearch(uint32_t count, uint32_t seed)
+{
+  std::mt19937_64                   rng(seed);
+  vox::AosNodeStorage<TKey>         nodes;
+  vox::MortonSearchIndex<TKey>      index;
+  const TKey                        maxKey = vox::MortonTraits<TKey>::MaxKey;
+  std::uniform_int_distribution<TKey> keyDist(0, maxKey - 1);
+
+  core::Vector<TKey> keys;
+  for (uint32_t i = 0; i < count; i++)
+    keys.push_back(keyDist(rng) & ~TKey(3));
+  std::sort(keys.begin(), keys.end());
+  for (TKey key : keys)
+    nodes.PushBack(vox::BasicVoxNode<TKey>(key));
+
+  index.Build(nodes);
+  for (uint32_t i = 0; i < 4 * count + 64; i++)
+  {
+    TKey key = i < count ? keys[i] + TKey(i % 3) : keyDist(rng);
+    ASSERT_EQ(nodes.LowerBound(0, nodes.size(), key), index.LowerBound(key)) << key;
+  }
+  EXPECT_EQ(nodes.size(), index.LowerBound(maxKey));
+}
+
+TEST(MortonOctreeTests, SearchIndexMatchesBinarySearch)
+{
+  for (uint32_t count : { 0u, 1u, 15u, 16u, 17u, 289u, 1000u, 5000u })
+  {
+    ExpectSearchIndexMatchesBinarySearch<uint32_t>(count, count);
+    ExpectSearchIndexMatchesBinarySearch<uint64_t>(count, count + 1);
+  }
+}
+
+TEST(MortonOctreeTests, SearchIndexRebuildsAfterEdits)
+{
+  vox::MortonOctree octree;
+  octree.EnableSearchIndex(true);
+  for (uint32_t x = 0; x < 32; x++)
+    for (uint32_t z = 0; z < 32; z++)
+      octree.AddOrphanNode(vox::VoxNode(x, 0, z));
+  octree.SortLeafNodes();
+
+  for (uint32_t i = 0; i < 200; i++)
+    EXPECT_TRUE(octree.CheckNode(i % 32, 0, i / 32));
+
+  octree.AddNode(vox::VoxNode(3, 1, 3));
+  octree.RemoveNode(4, 0, 4);
+  for (uint32_t i = 0; i < 200; i++)
+  {
+    EXPECT_TRUE(octree.CheckNode(3, 1, 3));
+    EXPECT_FALSE(octree.CheckNode(4, 0, 4));
+    EXPECT_FALSE(octree.CheckNode(3, 2, 3));
+  }
+
+  auto& nodes = octree.GetNodes();
+  auto  self  = std::find_if(nodes.begin(), nodes.end(), [](const vox::VoxNode& node) {
+    return node.start == vox::encodeMK(3, 0, 3);
+  });
+  EXPECT_EQ(vox::BOTTOM, octree.GetVisibleSides(3, 0, 3, self));
+}
+
+TEST(MortonOctreeTests, ChunkDirectoryTracksEdits)
+{
+  std::mt19937                            rng(17);
+  std::uniform_int_distribution<uint32_t> coord(0, 127);
+
+  vox::MortonOctree octree;
+  for (uint32_t i = 0; i < 2000; i++)
+    octree.AddOrphanNode(vox::VoxNode(coord(rng), coord(rng) / 2, coord(rng)));
+  octree.RemoveDuplicateNodes();
+  ExpectChunkDirectoryMatchesNodes(octree);
+
+  for (uint32_t i = 0; i < 400; i++)
+  {
+    if (i % 3 == 0)
+      octree.RemoveNode(coord(rng), coord(rng) / 2, coord(rng));
+    else
+      octree.AddNode(vox::VoxNode(coord(rng), coord(rng), coord(rng)));
+    ExpectChunkDirectoryMatchesNodes(octree);
+  }
+
+  // A key just below a tombstone of a later chunk revives it in place and moves it across chunks.
+  vox::MortonOctree sparse;
+  sparse.AddNode(vox::VoxNode(0, 0, 0));
+  sparse.AddNode(vox::VoxNode(96, 96, 96));
+  sparse.AddNode(vox::VoxNode(100, 100, 100));
+  ExpectChunkDirectoryMatchesNodes(sparse);
+  sparse.RemoveNode(96, 96, 96);
+  sparse.AddNode(vox::VoxNode(40, 0, 0));
+  ExpectChunkDirectoryMatchesNodes(sparse);
+  EXPECT_EQ(1u, sparse.GetChunkRange(vox::utils::GetChunkIndex(vox::encodeMK(40, 0, 0))).liveCount);
+  EXPECT_EQ(1u, sparse.GetChunkRange(vox::utils::GetChunkIndex(vox::encodeMK(96, 96, 96))).liveCount);
+
+  octree.AddNodes({ vox::VoxNode(127, 127, 127) });
+  octree.Compact();
+  ExpectChunkDirectoryMatchesNodes(octree);
+}
+
+namespace {
+/// Live voxels of an octree with spans expanded, key -> red channel.
+std::map<uint32_t, uint8_t> Voxels(vox::MortonOctree& octree)
+{
+  std::map<uint32_t, uint8_t> voxels;
+  for (const auto& node : octree.GetNodes())
+    if (!node.IsTombstone())
+      for (uint32_t key = node.start; key < node.start + node.size; key++)
+        voxels[key] = node.r;
+  return voxels;
+}
+
+/// 32^3 terrain as runs of keys: solid below a height field, two materials.
+void AddTerrainRuns(vox::MortonOctree& spans, vox::MortonOctree& voxels)
+{
+  int32_t start = -1;
+  uint8_t color = 0;
+  auto    flush = [&](uint32_t end) {
+    if (start != -1)
+      spans.AddOrphanNode(vox::VoxNode(start, end - start, color, color, color));
+    start = -1;
+  };
+
+  for (uint32_t key = 0; key < 32 * 32 * 32; key++)
+  {
+    uint32_t x, y, z;
+    vox::decodeMK(key, x, y, z);
+    if (y > 8 + (x * 7 + z * 3) % 11)
+    {
+      flush(key);
+      continue;
+    }
+
+    const uint8_t c = y < 6 ? 1 : 2;
+    voxels.AddOrphanNode(vox::VoxNode(key, 1, c, c, c));
+    if (start != -1 && c != color)
+      flush(key);
+    if (start == -1)
+    {
+      start = key;
+      color = c;
+    }
+  }
+  flush(32 * 32 * 32);
+  spans.SortLeafNodes();
+  voxels.SortLeafNodes();
+}
+} // namespace
+
+TEST(MortonOctreeTests, SpanNodesAnswerQueriesLikeVoxels)
+{
+  vox::MortonOctree spans, voxels;
+  AddTerrainRuns(spans, voxels);
+  EXPECT_LT(spans.GetNodes().size() * 4, voxels.GetNodes().size());
+
+  for (uint32_t key = 0; key < 32 * 32 * 32; key++)
+    ASSERT_EQ(voxels.CheckNode(key), spans.CheckNode(key)) << key;
+
+  auto& spanNodes = spans.GetNodes();
+  for (auto it = voxels.GetNodes().begin(); it != voxels.GetNodes().end(); ++it)
+  {
+    uint32_t x, y, z;
+    vox::decodeMK(it->start, x, y, z);
+    auto span = std::upper_bound(spanNodes.begin(), spanNodes.end(), it->start,
+                                 [](uint32_t key, const vox::VoxNode& n) { return key < n.start; });
+    --span;
+    ASSERT_EQ(voxels.GetVisibleSides(x, y, z, it), spans.GetVisibleSides(x, y, z, span))
+        << it->start;
+  }
+
+  std::mt19937                            rng(5);
+  std::uniform_int_distribution<uint32_t> coord(0, 35);
+  for (uint32_t i = 0; i < 500; i++)
+  {
+    glm::uvec3 a(coord(rng), coord(rng), coord(rng)), b(coord(rng), coord(rng), coord(rng));
+    glm::uvec3 min = glm::min(a, b), max = glm::max(a, b);
+
+    std::set<uint32_t> expected, found;
+    voxels.ForEachNodeInBox(min, max, [&](const vox::VoxNode& node) {
+      expected.insert(node.start);
+      return true;
+    });
+    spans.ForEachNodeInBox(min, max, [&](const vox::VoxNode& node) {
+      for (uint32_t key = node.start; key < node.start + node.size; key++)
+      {
+        uint32_t x, y, z;
+        vox::decodeMK(key, x, y, z);
+        if (x >= min.x && y >= min.y && z >= min.z && x <= max.x && y <= max.y && z <= max.z)
+          found.insert(key);
+      }
+      return true;
+    });
+    ASSERT_EQ(expected, found);
+  }
+}
+
+TEST(MortonOctreeTests, SpanNodesCollideLikeVoxels)
+{
+  auto spans  = core::MakeShared<vox::MortonOctree>();
+  auto voxels = core::MakeShared<vox::MortonOctree>();
+  AddTerrainRuns(*spans, *voxels);
+  vox::CollisionManager spanCollision(spans), voxelCollision(voxels);
+
+  // The run holding (1, 9, 1) starts outside a box around that voxel alone.
+  const core::AxisAlignedBoundingBox voxel(glm::vec3(1.5f, 9.5f, 1.5f), glm::vec3(0.25f));
+  ASSERT_TRUE(voxels->CheckNode(1, 9, 1));
+  EXPECT_TRUE(spanCollision.CheckCollision(voxel));
+
+  std::mt19937                          rng(13);
+  std::uniform_real_distribution<float> coord(0.f, 34.f), extent(0.1f, 3.f);
+  for (uint32_t i = 0; i < 1000; i++)
+  {
+    const core::AxisAlignedBoundingBox box(glm::vec3(coord(rng), coord(rng), coord(rng)),
+                                           glm::vec3(extent(rng), extent(rng), extent(rng)));
+    ASSERT_EQ(voxelCollision.CheckCollision(box), spanCollision.CheckCollision(box)) << i;
+  }
+}
+
+TEST(MortonOctreeTests, EditsSplitSpanNodes)
+{
+  vox::MortonOctree spans, voxels;
+  AddTerrainRuns(spans, voxels);
+  spans.GetChunkCount();
+
+  std::mt19937                            rng(9);
+  std::uniform_int_distribution<uint32_t> coord(0, 31);
+  for (uint32_t i = 0; i < 300; i++)
+  {
+    const uint32_t x = coord(rng), y = coord(rng) / 2, z = coord(rng);
+    if (i % 2)
+    {
+      EXPECT_EQ(voxels.RemoveNode(x, y, z), spans.RemoveNode(x, y, z));
+    }
+    else
+    {
+      const uint8_t c = uint8_t(3 + i % 5);
+      voxels.AddNode(vox::VoxNode(vox::encodeMK(x, y, z), 1, c, c, c));
+      spans.AddNode(vox::VoxNode(vox::encodeMK(x, y, z), 1, c, c, c));
+    }
+  }
+  EXPECT_EQ(Voxels(voxels), Voxels(spans));
+  EXPECT_TRUE(spans.IsSorted());
+  ExpectChunkDirectoryMatchesNodes(spans);
+
+  // A span added over existing voxels replaces them.
+  spans.AddNode(vox::VoxNode(vox::encodeMK(4, 4, 4), 64, 9, 9, 9));
+  for (uint32_t key = vox::encodeMK(4, 4, 4); key < vox::encodeMK(4, 4, 4) + 64; key++)
+    voxels.AddNode(vox::VoxNode(key, 1, 9, 9, 9));
+  EXPECT_EQ(Voxels(voxels), Voxels(spans));
+  ExpectChunkDirectoryMatchesNodes(spans);
+
+  // Keys that were voxels before the span must behave like any other key of the span.
+  for (uint32_t key = vox::encodeMK(4, 4, 4); key < vox::encodeMK(4, 4, 4) + 64; key++)
+    ASSERT_TRUE(spans.CheckNode(key)) << key;
+  for (uint32_t key = vox::encodeMK(4, 4, 4) + 1; key < vox::encodeMK(4, 4, 4) + 64; key += 9)
+  {
+    uint32_t x, y, z;
+    vox::decodeMK(key, x, y, z);
+    EXPECT_EQ(voxels.RemoveNode(x, y, z), spans.RemoveNode(x, y, z)) << key;
+    EXPECT_FALSE(spans.CheckNode(key));
+  }
+  spans.AddNode(vox::VoxNode(vox::encodeMK(4, 4, 4) + 10, 1, 8, 8, 8));
+  voxels.AddNode(vox::VoxNode(vox::encodeMK(4, 4, 4) + 10, 1, 8, 8, 8));
+  EXPECT_EQ(Voxels(voxels), Voxels(spans));
+  ExpectChunkDirectoryMatchesNodes(spans);
+
+  vox::MortonOctree::EditBatch spanBatch, voxelBatch;
+  for (uint32_t i = 0; i < 200; i++)
+  {
+    const uint32_t x = coord(rng), y = coord(rng) / 2, z = coord(rng);
+    if (i % 3)
+    {
+      spanBatch.Remove(x, y, z);
+      voxelBatch.Remove(x, y, z);
+    }
+    else
+    {
+      spanBatch.Add(vox::VoxNode(vox::encodeMK(x, y, z), 1, 7, 7, 7));
+      voxelBatch.Add(vox::VoxNode(vox::encodeMK(x, y, z), 1, 7, 7, 7));
+    }
+  }
+  spans.ApplyEdits(core::Move(spanBatch));
+  voxels.ApplyEdits(core::Move(voxelBatch));
+  EXPECT_EQ(Voxels(voxels), Voxels(spans));
+  EXPECT_TRUE(spans.IsSorted());
+}
+
+TEST(MortonOctreeTests, OccupancyMatchesCoveredKeys)
+{
+  using EState = vox::MortonOccupancy<uint32_t>::EState;
+
+  vox::MortonOctree spans, voxels;
+  AddTerrainRuns(spans, voxels);
+  spans.RemoveNode(3, 2, 1);
+  spans.AddNode(vox::VoxNode(vox::encodeMK(40, 40, 40), 1, 1, 1, 1));
+  const auto solid = Voxels(spans);
+
+  for (uint32_t level = 0; level <= 6; level++)
+  {
+    const uint32_t cellKeys = 1u << (3 * level);
+    for (uint32_t cell = 0; cell < (64u * 64 * 64) >> (3 * level); cell++)
+    {
+      const uint32_t first = cell * cellKeys;
+      const size_t count = std::distance(solid.lower_bound(first), solid.lower_bound(first + cellKeys));
+
+      EState expected = EState::Partial;
+      if (count == 0)
+        expected = EState::Empty;
+      else if (count == cellKeys)
+        expected = EState::Full;
+      ASSERT_EQ(expected, spans.GetOccupancy().GetState(level, first)) << level << " " << cell;
+    }
+  }
+
+  std::mt19937                            rng(11);
+  std::uniform_int_distribution<uint32_t> coord(0, 45);
+  for (uint32_t i = 0; i < 500; i++)
+  {
+    glm::uvec3 a(coord(rng), coord(rng), coord(rng)), b(coord(rng), coord(rng), coord(rng));
+    glm::uvec3 min = glm::min(a, b), max = glm::max(a, b);
+
+    bool expected = false;
+    voxels.ForEachNodeInBox(min, max, [&](const vox::VoxNode& node) {
+      expected = node.start != vox::encodeMK(3, 2, 1);
+      return !expected;
+    });
+    const bool addedInBox = min.x <= 40 && max.x >= 40 && min.y <= 40 && max.y >= 40 &&
+                            min.z <= 40 && max.z >= 40;
+    expected = expected || addedInBox;
+    ASSERT_EQ(expected, spans.AnyNodeInBox(min, max));
+  }
+
+  vox::MortonOctree64 sparse;
+  EXPECT_EQ(vox::MortonOccupancy<uint64_t>::EState::Empty, sparse.GetOccupancy().Root().state);
+  sparse.AddNode(vox::VoxNode64(1u << 20, 5, 1u << 19));
+  EXPECT_TRUE(sparse.AnyNodeInBox(glm::uvec3(0), glm::uvec3((1u << 21) - 1)));
+  EXPECT_TRUE(sparse.AnyNodeInBox(glm::uvec3(1u << 20, 0, 0), glm::uvec3(1u << 20, 5, 1u << 19)));
+  EXPECT_FALSE(sparse.AnyNodeInBox(glm::uvec3(0), glm::uvec3(1u << 19)));
+}
+
+TEST(MortonOctreeTests, OccupancyOfFullKeySpaceIsFull)
+{
+  using Occupancy       = vox::MortonOccupancy<uint32_t>;
+  const uint32_t maxKey = vox::MortonTraits<uint32_t>::MaxKey;
+
+  vox::AosNodeStorage<uint32_t> halves;
+  halves.PushBack(vox::VoxNode(0, maxKey / 2));
+  halves.PushBack(vox::VoxNode(maxKey / 2, maxKey / 2));
+  Occupancy full;
+  full.Build(halves);
+  EXPECT_EQ(Occupancy::EState::Full, full.Root().state);
+  EXPECT_TRUE(full.AnyInBox(glm::uvec3(1023), glm::uvec3(1023)));
+
+  vox::AosNodeStorage<uint32_t> allButLast;
+  allButLast.PushBack(vox::VoxNode(0, maxKey - 1));
+  Occupancy partial;
+  partial.Build(allButLast);
+  EXPECT_EQ(Occupancy::EState::Partial, partial.Root().state);
+  EXPECT_EQ(Occupancy::EState::Full, partial.GetState(0, maxKey - 2));
+  EXPECT_EQ(Occupancy::EState::Empty, partial.GetState(0, maxKey - 1));
+}
+
+namespace {
+void ExpectChunkOccupancyMatchesNodes(vox::MortonOctree& octree, size_t chunkCount)
+{
+  for (size_t chunk = 0; chunk < chunkCount; chunk++)
+  {
+    const vox::ChunkOccupancy* occupancy = octree.GetChunkOccupancy(chunk);
+    for (uint32_t local = 0; local < vox::VOXELS_IN_CHUNK; local++)
+    {
+      const uint32_t key = uint32_t(chunk << vox::CHUNK_SHIFT) | local;
+      uint32_t       x, y, z;
+      vox::decodeMK(key, x, y, z);
+      const bool solid = occupancy && occupancy->Get(x & 31, y & 31, z & 31);
+      ASSERT_EQ(octree.CheckNode(key), solid) << chunk << " " << local;
+    }
+  }
+}
+} // namespace
+
+TEST(MortonOctreeTests, ChunkOccupancyTracksEdits)
+{
+  vox::MortonOctree spans, voxels;
+  AddTerrainRuns(spans, voxels);
+  EXPECT_EQ(nullptr, spans.GetChunkOccupancy(1));
+  ExpectChunkOccupancyMatchesNodes(spans, 2);
+
+  // Incremental updates: a span across the chunk border, a hole in a span and an empty node.
+  spans.AddNode(vox::VoxNode(vox::VOXELS_IN_CHUNK - 10, 20, 3, 3, 3));
+  spans.RemoveNode(3, 2, 1);
+  spans.AddNode(vox::VoxNode(vox::encodeMK(5, 1, 5), 0));
+  ExpectChunkOccupancyMatchesNodes(spans, 3);
+  EXPECT_EQ(nullptr, spans.GetChunkOccupancy(2));
+
+  // A span written over voxels keeps the bits of every key it covers.
+  const uint32_t cube = vox::encodeMK(10, 10, 10);
+  for (uint32_t key = cube; key < cube + 8; key++)
+    spans.AddNode(vox::VoxNode(key, 1, 4, 4, 4));
+  spans.AddNode(vox::VoxNode(cube, 8, 5, 5, 5));
+  ExpectChunkOccupancyMatchesNodes(spans, 3);
+  for (uint32_t key = cube; key < cube + 8; key++)
+  {
+    uint32_t x, y, z;
+    vox::decodeMK(key, x, y, z);
+    EXPECT_TRUE(spans.GetChunkOccupancy(0)->Get(x, y, z)) << key;
+  }
+
+  const vox::ChunkOccupancy* occupancy = spans.GetChunkOccupancy(1);
+  ASSERT_NE(nullptr, occupancy);
+  EXPECT_EQ(1u, occupancy->Column(0, 0) & 1u);
+
+  // Batches rebuild the bitsets on next use.
+  vox::MortonOctree::EditBatch batch;
+  batch.Add(vox::VoxNode(vox::encodeMK(4, 20, 4), 8, 1, 1, 1));
+  batch.Remove(0, 0, 0);
+  spans.ApplyEdits(core::Move(batch));
+  ExpectChunkOccupancyMatchesNodes(spans, 3);
+  EXPECT_EQ(vox::ChunkOccupancy::RangeMask(0, 31), ~0u);
+  EXPECT_EQ(vox::ChunkOccupancy::RangeMask(4, 6), 0x70u);
+}
@@ -0,0 +1,270 @@
+#include "voxel/VoxelInc.h"
+#include "gtest/gtest.h"
+
+namespace {
+/// Restores the codec that was active when it was created, also when an assertion returns early.
+struct RestoreCodec
+{
+  ~RestoreCodec()
+  {
+    vox::morton::SetCodec(Previous);
+  }
+
+  const vox::morton::ECodec Previous = vox::morton::GetCodec();
+};
+
+void ExpectCodecRoundTrip(vox::morton::ECodec codec)
+{
+  if (!vox::morton::IsCodecSupported(codec))
+  {
+    GTEST_SKIP() << vox::morton::GetCodecName(codec) << " is not supported on this CPU";
+  }
+
+  RestoreCodec restore;
+  ASSERT_TRUE(vox::morton::SetCodec(codec));
+
+  for (uint32_t i = 0; i < vox::MaxMortonKey; i += 977)
+  {
+    uint32_t x, y, z;
+    vox::decodeMK(i, x, y, z);
+
+    ASSERT_EQ(vox::morton::EncodeLUT(x, y, z), vox::encodeMK(x, y, z));
+    ASSERT_EQ(i, vox::encodeMK(x, y, z)) << vox::morton::GetCodecName(codec);
+  }
+}
+} // namespace
+
+TEST(MortonTests, LookupTableRoundTrip)
+{
+  ExpectCodecRoundTrip(vox::morton::ECodec::LookupTable);
+}
+
+TEST(MortonTests, MagicBitsRoundTrip)
+{
+  ExpectCodecRoundTrip(vox::morton::ECodec::MagicBits);
+}
+
+TEST(MortonTests, BMI2RoundTrip)
+{
+  ExpectCodecRoundTrip(vox::morton::ECodec::BMI2);
+}
+
+TEST(MortonTests, CodecsAgreeOnAxisLimits)
+{
+  const uint32_t coords[] = { 0, 1, 2, 127, 128, 511, 512, 1022, 1023 };
+
+  for (auto x : coords)
+    for (auto y : coords)
+      for (auto z : coords)
+      {
+        const uint32_t expected = vox::morton::EncodeLUT(x, y, z);
+        EXPECT_EQ(expected, vox::morton::EncodeMagicBits(x, y, z));
+#if VOX_MORTON_HAS_BMI2
+        if (vox::morton::IsCodecSupported(vox::morton::ECodec::BMI2))
+        {
+          EXPECT_EQ(expected, vox::morton::EncodeBMI2(x, y, z));
+        }
+#endif
+      }
+}
+
+TEST(MortonTests, BatchKernelsMatchScalarCodec)
+{
+  // odd count so the scalar tail after the 8/4-wide blocks is exercised as well
+  const size_t           count = 4099;
+  core::Vector<uint32_t> x(count), y(count), z(count), keys(count);
+  core::Vector<uint32_t> dx(count), dy(count), dz(count);
+
+  for (size_t i = 0; i < count; i++)
+  {
+    x[i] = (i * 7) % 1024;
+    y[i] = (i * 13 + 5) % 1024;
+    z[i] = (i * 31 + 11) % 1024;
+  }
+
+  vox::morton::EncodeMany(x.data(), y.data(), z.data(), keys.data(), count);
+  vox::morton::DecodeMany(keys.data(), dx.data(), dy.data(), dz.data(), count);
+
+  for (size_t i = 0; i < count; i++)
+  {
+    ASSERT_EQ(vox::morton::EncodeLUT(x[i], y[i], z[i]), keys[i]);
+    ASSERT_EQ(x[i], dx[i]);
+    ASSERT_EQ(y[i], dy[i]);
+    ASSERT_EQ(z[i], dz[i]);
+  }
+
+  const uint32_t firstKey = 123457;
+  vox::morton::DecodeRange(firstKey, dx.data(), dy.data(), dz.data(), count);
+
+  for (size_t i = 0; i < count; i++)
+  {
+    auto [ex, ey, ez] = vox::utils::Decode(firstKey + i);
+    ASSERT_EQ(ex, dx[i]);
+    ASSERT_EQ(ey, dy[i]);
+    ASSERT_EQ(ez, dz[i]);
+  }
+}
+
+TEST(MortonTests, NeighborStepsMatchReencoding)
+{
+  const uint32_t coords[] = { 0, 1, 7, 8, 31, 32, 127, 128, 511, 1022, 1023 };
+
+  for (auto x : coords)
+    for (auto y : coords)
+      for (auto z : coords)
+      {
+        const uint32_t key = vox::encodeMK(x, y, z);
+
+        EXPECT_EQ(vox::encodeMK((x + 1) % 1024, y, z), vox::MortonAddX(key));
+        EXPECT_EQ(vox::encodeMK(x, (y + 1) % 1024, z), vox::MortonAddY(key));
+        EXPECT_EQ(vox::encodeMK(x, y, (z + 1) % 1024), vox::MortonAddZ(key));
+        EXPECT_EQ(vox::encodeMK((x + 1023) % 1024, y, z), vox::MortonSubX(key));
+        EXPECT_EQ(vox::encodeMK(x, (y + 1023) % 1024, z), vox::MortonSubY(key));
+        EXPECT_EQ(vox::encodeMK(x, y, (z + 1023) % 1024), vox::MortonSubZ(key));
+        EXPECT_EQ(vox::encodeMK((x + 5) % 1024, (y + 3) % 1024, (z + 1000) % 1024),
+                  vox::MortonAdd(key, vox::encodeMK(5, 3, 1000)));
+        EXPECT_EQ(vox::encodeMK((x + 1019) % 1024, y, (z + 1) % 1024),
+                  vox::MortonSub(key, vox::encodeMK(5, 0, 1023)));
+      }
+}
+
+TEST(MortonTests, NeighborEnumeratorsSkipOutOfRangeCells)
+{
+  uint32_t neighbors[vox::FaceCount];
+  auto     validFaces = vox::MortonFaceNeighbors(vox::encodeMK(0, 5, 1023), neighbors);
+
+  EXPECT_EQ(validFaces, (1u << vox::PositiveX) | (1u << vox::PositiveY) |
+                            (1u << vox::NegativeY) | (1u << vox::NegativeZ));
+  EXPECT_EQ(vox::encodeMK(1, 5, 1023), neighbors[vox::PositiveX]);
+  EXPECT_EQ(vox::encodeMK(0, 4, 1023), neighbors[vox::NegativeY]);
+
+  uint32_t count = 0;
+  vox::ForEachMortonNeighbor26(vox::encodeMK(10, 20, 30), [&](uint32_t key, int dx, int dy, int dz) {
+    EXPECT_EQ(vox::encodeMK(10 + dx, 20 + dy, 30 + dz), key);
+    count++;
+  });
+  EXPECT_EQ(26u, count);
+
+  count = 0;
+  vox::ForEachMortonNeighbor26(vox::encodeMK(0, 0, 0), [&](uint32_t, int, int, int) { count++; });
+  EXPECT_EQ(7u, count);
+}
+
+TEST(MortonTests, WideKeysRoundTrip)
+{
+  using Traits = vox::MortonTraits<vox::MortonKey64>;
+  const uint32_t coords[] = { 0, 1, 1023, 1024, 65535, 1u << 20, Traits::MaxCoordinate };
+
+  for (uint32_t x : coords)
+    for (uint32_t y : coords)
+      for (uint32_t z : coords)
+      {
+        uint64_t key = vox::morton::EncodeMagicBits64(x, y, z);
+        uint32_t dx, dy, dz;
+        vox::morton::DecodeMagicBits64(key, dx, dy, dz);
+        EXPECT_EQ(x, dx);
+        EXPECT_EQ(y, dy);
+        EXPECT_EQ(z, dz);
+        EXPECT_LT(key, Traits::MaxKey);
+        EXPECT_EQ(key, Traits::Encode(x, y, z));
+
+        if (x < 1024 && y < 1024 && z < 1024)
+        {
+          EXPECT_EQ(uint64_t(vox::encodeMK(x, y, z)), key);
+        }
+      }
+}
+
+TEST(MortonTests, WideNeighborStepsAtAxisLimits)
+{
+  using Traits   = vox::MortonTraits<vox::MortonKey64>;
+  const auto max = Traits::MaxCoordinate;
+
+  uint64_t key = Traits::Encode(max - 1, 1024, max);
+  EXPECT_EQ(Traits::Encode(max, 1024, max), vox::MortonAddX(key));
+  EXPECT_EQ(Traits::Encode(max - 1, 1023, max), vox::MortonSubY(key));
+  EXPECT_EQ(Traits::Encode(max - 1, 1025, max), vox::MortonAddY(key));
+  EXPECT_TRUE(vox::MortonIsMaxZ(key));
+  EXPECT_FALSE(vox::MortonIsMaxX(key));
+  EXPECT_TRUE(vox::MortonIsMaxX(vox::MortonAddX(key)));
+
+  uint64_t neighbors[vox::FaceCount];
+  auto validFaces = vox::MortonFaceNeighbors(key, neighbors);
+  EXPECT_EQ(0u, validFaces & (1u << vox::PositiveZ));
+  EXPECT_EQ(Traits::Encode(max - 1, 1024, max - 1), neighbors[vox::NegativeZ]);
+}
+
+TEST(MortonTests, WideOctreeAddressesBeyond1024)
+{
+  vox::MortonOctree64 octree;
+  octree.AddOrphanNode(vox::VoxNode64(5000, 3, 1u << 20));
+  octree.AddOrphanNode(vox::VoxNode64(2, 2, 2));
+  octree.SortLeafNodes();
+
+  EXPECT_TRUE(octree.CheckNode(5000, 3, 1u << 20));
+  EXPECT_TRUE(octree.CheckNode(2, 2, 2));
+  EXPECT_FALSE(octree.CheckNode(5000 & 1023, 3, 0));
+  EXPECT_EQ(sizeof(vox::VoxNode), 12u);
+}
+
+TEST(MortonTests, BigMinAndLitMaxMatchBruteForce)
+{
+  const uint32_t min[3] = { 3, 5, 2 }, max[3] = { 9, 6, 12 };
+  const uint32_t minKey = vox::encodeMK(min[0], min[1], min[2]);
+  const uint32_t maxKey = vox::encodeMK(max[0], max[1], max[2]);
+
+  core::Vector<uint32_t> inside;
+  for (uint32_t key = minKey; key <= maxKey; key++)
+    if (vox::MortonInBox(key, minKey, maxKey))
+      inside.push_back(key);
+
+  for (uint32_t key = minKey; key <= maxKey; key++)
+  {
+    if (vox::MortonInBox(key, minKey, maxKey))
+      continue;
+
+    auto next = std::upper_bound(inside.begin(), inside.end(), key);
+    auto prev = std::lower_bound(inside.begin(), inside.end(), key) - 1;
+    EXPECT_EQ(*next, vox::MortonBigMin(key, minKey, maxKey));
+    EXPECT_EQ(*prev, vox::MortonLitMax(key, minKey, maxKey));
+  }
+
+  core::Vector<vox::MortonInterval<uint32_t>> intervals;
+  vox::MortonBoxIntervals(min, max, intervals);
+
+  core::Vector<uint32_t> expanded;
+  for (size_t i = 0; i < intervals.size(); i++)
+  {
+    if (i > 0)
+    {
+      EXPECT_LT(intervals[i - 1].last + 1, intervals[i].first);
+    }
+    for (uint32_t key = intervals[i].first; key <= intervals[i].last; key++)
+      expanded.push_back(key);
+  }
+  EXPECT_EQ(inside, expanded);
+}
+
+TEST(MortonTests, OctreeBoxQueryVisitsOnlyBoxNodes)
+{
+  vox::MortonOctree octree;
+  for (uint32_t z = 0; z < 32; z++)
+    for (uint32_t y = 0; y < 32; y += 2)
+      for (uint32_t x = 0; x < 32; x++)
+        octree.AddOrphanNode(vox::VoxNode(x, y, z));
+  octree.SortLeafNodes();
+
+  const glm::uvec3 min(4, 6, 10), max(12, 9, 11);
+  uint32_t visited = 0;
+  auto examined = octree.ForEachNodeInBox(min, max, [&](const vox::VoxNode& node) {
+    auto [x, y, z] = vox::utils::Decode(node.start);
+    EXPECT_TRUE(x >= min.x && x <= max.x && y >= min.y && y <= max.y && z >= min.z && z <= max.z);
+    visited++;
+    return true;
+  });
+
+  EXPECT_EQ(9u * 2u * 2u, visited);
+  EXPECT_LE(examined, 2 * visited);
+  EXPECT_TRUE(octree.AnyNodeInBox(min, max));
+  EXPECT_FALSE(octree.AnyNodeInBox(glm::uvec3(0, 1, 0), glm::uvec3(31, 1, 31)));
+}
@@ -0,0 +1,148 @@
+#include "threading/TaskGraph.h"
+#include "gtest/gtest.h"
+#include <chrono>
+#include <thread>
+
+namespace {
+/// Records that it was finalized.
+class UploadJob : public threading::BackgroundJob
+{
+  public:
+  explicit UploadJob(bool& finalized)
+      : m_finalized(finalized)
+  {
+  }
+
+  void Run() final {}
+
+  void FinalizeInMainThread() final
+  {
+    m_finalized = true;
+  }
+
+  private:
+  bool& m_finalized;
+};
+} // namespace
+
+TEST(TaskGraphTests, RunsContinuationsInOrder)
+{
+  threading::JobScheduler scheduler(4);
+  threading::TaskGraph    graph(scheduler);
+  std::mutex              mutex;
+  core::Vector<uint32_t>  order;
+
+  auto record = [&](uint32_t step) {
+    return [&mutex, &order, step]() {
+      std::lock_guard<std::mutex> lock(mutex);
+      order.push_back(step);
+    };
+  };
+
+  auto first  = graph.Run(record(0));
+  auto second = graph.Then(first, record(1));
+  auto third  = graph.Then(second, record(2));
+  third->Wait();
+
+  EXPECT_TRUE(first->IsDone());
+  EXPECT_TRUE(second->IsDone());
+  EXPECT_EQ((core::Vector<uint32_t>{ 0, 1, 2 }), order);
+}
+
+TEST(TaskGraphTests, FansInAfterEveryDependency)
+{
+  static constexpr uint32_t NeighborCount = 7;
+
+  threading::JobScheduler scheduler(4);
+  threading::TaskGraph    graph(scheduler);
+  std::atomic<uint32_t>   generated{ 0 };
+  uint32_t                generatedWhenMeshing = 0;
+
+  // A chunk and its six neighbors are generated before the chunk is meshed.
+  core::Vector<threading::TaskHandle> generation;
+  for (uint32_t i = 0; i < NeighborCount; i++)
+  {
+    generation.push_back(graph.Run([&generated]() {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      generated++;
+    }));
+  }
+  auto meshing = graph.RunAfter(generation, [&]() { generatedWhenMeshing = generated; });
+  meshing->Wait();
+
+  EXPECT_EQ(NeighborCount, generatedWhenMeshing);
+}
+
+TEST(TaskGraphTests, WhenAllCompletesWithItsDependencies)
+{
+  threading::JobScheduler scheduler(2);
+  threading::TaskGraph    graph(scheduler);
+  std::atomic<bool>       release{ false };
+
+  auto blocked = graph.Run([&release]() {
+    while (release == false)
+    {
+      std::this_thread::yield();
+    }
+  });
+  auto done = graph.Run([]() {});
+  done->Wait();
+
+  auto all = graph.WhenAll({ blocked, done });
+  EXPECT_FALSE(all->IsDone());
+
+  release = true;
+  all->Wait();
+  EXPECT_TRUE(blocked->IsDone());
+
+  // Without dependencies, or on tasks that are already done, it is done right away.
+  EXPECT_TRUE(graph.WhenAll({})->IsDone());
+  EXPECT_TRUE(graph.WhenAll({ blocked, done })->IsDone());
+}
+
+TEST(TaskGraphTests, AddsTasksFromInsideTasks)
+{
+  threading::JobScheduler scheduler(4);
+  threading::TaskGraph    graph(scheduler);
+  std::atomic<uint32_t>   leaves{ 0 };
+  threading::TaskHandle   inner;
+  std::mutex              innerMutex;
+
+  auto outer = graph.Run([&]() {
+    core::Vector<threading::TaskHandle> children;
+    for (uint32_t i = 0; i < 16; i++)
+    {
+      children.push_back(graph.Run([&leaves]() { leaves++; }));
+    }
+    std::lock_guard<std::mutex> lock(innerMutex);
+    inner = graph.WhenAll(children);
+  });
+  outer->Wait();
+
+  std::lock_guard<std::mutex> lock(innerMutex);
+  inner->Wait();
+  EXPECT_EQ(16u, leaves.load());
+}
+
+TEST(TaskGraphTests, EnqueuesBackgroundJobsAfterDependencies)
+{
+  threading::JobScheduler        scheduler(2);
+  threading::BackgroundJobRunner runner(scheduler);
+  threading::TaskGraph           graph(scheduler);
+  std::atomic<bool>              meshed{ false };
+  bool                           finalized = false;
+
+  // Generate, then mesh on the workers, then upload in the main thread.
+  auto generate = graph.Run([]() {});
+  auto mesh     = graph.Then(generate, [&meshed]() { meshed = true; });
+  graph.EnqueueAfter({ mesh }, runner, new UploadJob(finalized));
+
+  const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+  while (finalized == false && std::chrono::steady_clock::now() < deadline)
+  {
+    runner.Run();
+  }
+
+  EXPECT_TRUE(meshed.load());
+  EXPECT_TRUE(finalized);
+}